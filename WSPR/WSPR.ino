@@ -20,9 +20,30 @@
 
         This program consists of these files all located in the same directory
             WSPR.ino
+            band.cpp and band.h
+            boot.cpp and boot.h
+            calib.cpp and calib.h
+            clock.cpp and clock.h
             commands.cpp and commands.h
             config.cpp and config.h
+            encoder.h
+            fmt.cpp and fmt.h
             global.cpp and glocal.h
+            i2cbus.cpp and i2cbus.h
+            journal.cpp and journal.h
+            message.cpp and message.h
+            mode.cpp and mode.h
+            profiler.cpp and profiler.h
+            profiles.h
+            qrss.cpp and qrss.h
+            schedule.cpp and schedule.h
+            selftest.cpp and selftest.h
+            tasks.cpp and tasks.h
+            telemetry.cpp and telemetry.h
+            tones.cpp and tones.h
+            txengine.cpp and txengine.h
+            txframe.cpp and txframe.h
+            wspr.cpp and wspr.h
 
     Version
         0.9.3
@@ -37,11 +58,15 @@
 // Arduino includes
 #include <Arduino.h>
 
+// Build profile, selects what is compiled in. See profiles.h
+#include "profiles.h"
 
 // Include the I2C LCD library
 #include <Wire.h>
+#if FEATURE_LCD
 #include <LiquidCrystal_I2C.h>
 LiquidCrystal_I2C LCD(0x27, 20, 4); // LCD I2C addr. is 0x27, 20 chars and 4 lines and connected to D8 (SDA) and D9 (SCL)
+#endif
 
 #include <RTCZero.h>                           // Must be included for RTC use
 RTCZero rtc;                                   // Create the rtc object
@@ -55,66 +80,61 @@ RTCZero rtc;                                   // Create the rtc object
 #include "global.h"
 #include "config.h"
 #include "commands.h"
+#include "fmt.h"
+#include "profiler.h"
+#include "band.h"
+#include "boot.h"
+#include "calib.h"
+#include "clock.h"
+#include "journal.h"
+#include "message.h"
+#include "schedule.h"
+#include "telemetry.h"
+#include "i2cbus.h"
+#include "tasks.h"
+#include "txengine.h"
 
 #define pinPA 7            // PA on pin
 
-#define encA A0
-#define encB A1
-#define encP A2  // Rotary encoder push pin
+#define USB_TASK_US 2000UL // Longest USB receive per yield()
+#define SLOT_EARLY_US (TX_SEQUENCE_MAX_US + 20000UL) // Slot start found this early, so the PA and RF sequence ends on the edge
+#define SLOT_EARLY_S  ((SLOT_EARLY_US + 999999UL) / 1000000UL) // The same in whole RTC seconds
+#define CAL_BUDGET_US 1500000UL // The reference count takes about a second
+#define CAL_GUARD_US  (SLOT_EARLY_US + CAL_BUDGET_US) // No calibration this close to a slot edge
 
-volatile int encState = 0;
+#if FEATURE_LCD
+#include "encoder.h"
 
-const uint8_t encTableHalfStep[6][4] =
-{
-    {0x3, 0x2, 0x1, 0x0},
-    {0x23, 0x0, 0x1, 0x0},
-    {0x13, 0x2, 0x0, 0x0},
-    {0x3, 0x5, 0x4, 0x0},
-    {0x3, 0x3, 0x4, 0x10},
-    {0x3, 0x5, 0x3, 0x20},
-};
-
-const uint8_t encTableFullStep[7][4] =
-{
-    {0x0, 0x2, 0x4,  0x0},
-    {0x3, 0x0, 0x1, 0x10},
-    {0x3, 0x2, 0x0,  0x0},
-    {0x3, 0x2, 0x1,  0x0},
-    {0x6, 0x0, 0x4,  0x0},
-    {0x6, 0x5, 0x0, 0x20},
-    {0x6, 0x5, 0x4,  0x0},
-};
+volatile int encState = 0;         // State tables in encoder.h
+#endif // FEATURE_LCD
 
 
 // Local variables
 bool firstCalibationSaved = false;
+int qrssSlots = 0;                             // Slots since the last QRSS frame
+uint32_t lastSlot = 0;                         // RTC epoch minute of the last slot handled
+uint32_t telemetrySlot = 0;                    // RTC epoch minute of the slot the telemetry frame is for, 0: none
 
 struct gpsData gpsInfo;
 
-// LCD update function triggered by GPS data parsed
-void Display_Update()
+// RTC from GPS and the start up hold off, triggered by GPS data parsed. Runs with or without a display
+void Time_Update()
 {
-    static int lastFreq = -1;
-    static int lastSeconds = -1;
     static int lastMinutes = -1;
-    static int lastSatellites = -1;
-
     static int trust = 0;
     struct gpsData gpsInfo;          // Create local object with all parameters
-    static int txseconds = 0;
 
-    int hh = rtc.getHours();
     int mm = rtc.getMinutes();
-    int ss = rtc.getSeconds();
-    
+
     if (lastMinutes != mm) {   // Even or odd minute
-      if (digitalRead(pinPA) == LOW) TXflag--; // Do not count interval if we are transmitting
+      if (txState == TX_IDLE) TXflag--; // Start up hold off, the slot calendar does the rest
       gpsNMEA.getFrameData(&gpsInfo);
       // EVEN Minutes event
       if (mm % 2) {
         // Every ODD minute, Sync GPS to RTC
         if (gpsInfo.valid) {
           rtc.setTime(gpsInfo.utcHours, gpsInfo.utcMinutes, gpsInfo.utcSeconds);
+          rtc.setYear(BOOT_SYNCED_YEAR);   // Marks the RTC as GPS set for a resume after a reset
           goodRTC = 1;
           trust = 30; // We trust to RTC for the next 30*2 minutes (hour)
         } else {
@@ -124,16 +144,36 @@ void Display_Update()
       }
       lastMinutes = mm;
     }
+}
+
+#if FEATURE_LCD
+// LCD update function triggered by GPS data parsed
+void Display_Update()
+{
+    PROF_SCOPE(PROF_DISPLAY);
+
+    static int lastFreq = -1;
+    static int lastSeconds = -1;
+    static int lastSatellites = -1;
+
+    struct gpsData gpsInfo;          // Create local object with all parameters
+    static int txseconds = 0;
+
+    int hh = rtc.getHours();
+    int mm = rtc.getMinutes();
+    int ss = rtc.getSeconds();
+
+    gpsNMEA.getFrameData(&gpsInfo);
 
     // Display UTC time hh:mm:ss
     if (lastSeconds != ss) {  // Even or odd minute
       lastSeconds = ss;
       LCD.setCursor(12, 0);
-      if(digitalRead(pinPA) == LOW) {
-        sprintf(esc, "%02d:%02d:%02d", hh, mm, ss);
+      if(txState == TX_IDLE) {
+        FmtTime(esc, hh, mm, ss);
         txseconds = 0;
       } else
-        sprintf(esc, "TX: %03d ", txseconds++);
+        FmtStr(FmtUint(FmtStr(esc, "TX: "), txseconds++, 3, '0'), " ");
         
       LCD.print(esc);
     }
@@ -141,18 +181,18 @@ void Display_Update()
     // Print Frequency
     if (lastFreq != frequency) {
       LCD.setCursor(5, 2); // String 3, Position 6. Freq
-      float z = frequency/1000.0;
-      LCD.print(z, 2);
-      LCD.print(" kHz");
+      FmtStr(FmtKhz(esc, (uint32_t) frequency, 2), " kHz");
+      LCD.print(esc);
       lastFreq = frequency;
     }
     
     // Print string number 3
-    if (gpsInfo.valid || digitalRead(pinPA) == HIGH) {
-      if(lastSatellites != gpsInfo.satellites || digitalRead(pinPA) == HIGH) {
+    if (gpsInfo.valid || txState != TX_IDLE) {
+      if(lastSatellites != gpsInfo.satellites || txState != TX_IDLE) {
         if(gpsInfo.satellites<99) {
           LCD.setCursor(0, 3);
-          sprintf(esc, "GPS:OK,SAT:%02d,SEQ:%02d", gpsInfo.satellites, seqn); // GPS:OK,SAT:99,SEQ:00
+          char *p = FmtUint(FmtStr(esc, "GPS:OK,SAT:"), gpsInfo.satellites, 2, '0');   // GPS:OK,SAT:99,SEQ:00
+          FmtUint(FmtStr(p, ",SEQ:"), seqn, 2, '0');
           LCD.print(esc);
         }
         lastSatellites = gpsInfo.satellites;
@@ -165,78 +205,177 @@ void Display_Update()
     }  
     
 }
+#endif // FEATURE_LCD
 
-// USB and GPS receivers woven into standard Arduino function. Always include in "slow" loops
-void yield()
-{
-    static unsigned int usbBufCount = 0;
-    static char usbBuf[100];
+static unsigned int usbBufCount = 0;
+static char usbBuf[100];
+static bool lineReady = false;                // A command line waits for the TX to end, see CommandTxSafe()
 
-    bool keep_going ;
+// Command line job for the I2C arbiter, most commands read or write the EEPROM
+void RunCommand()
+{
+    ParseCommand(usbBuf);
 
-    // USB receiver
-    do {
-        keep_going = false ;
+    usbBufCount = 0;   // Clear buffer
+    usbBuf[0] = 0;
+}
 
-        if (SerialUSB.available())
-        {
-            char ch = (char) SerialUSB.read();
+// USB receiver task. No new input until the last command line has run, and at most
+// USB_TASK_US of it per pass so a paste does not hold up the GPS
+void UsbTask()
+{
+    unsigned long start = micros();
 
-            if (usbBufCount < sizeof(usbBuf) - 1)
-            {
-                if (ch == '\n')
-                {   // End of line found so parse the buffer
-                    ParseCommand(usbBuf);
+    while (!lineReady && !I2cBusPending(I2C_EEPROM) && SerialUSB.available() && (micros() - start < USB_TASK_US))
+    {
+        char ch = (char) SerialUSB.read();
 
-                    usbBufCount = 0;   // Clear buffer
-                    usbBuf[0] = 0;
-                }
-                else
-                {   // Pad buffer with latest char
-                    usbBuf[usbBufCount] = ch;
-                    usbBufCount++;
-                    usbBuf[usbBufCount] = 0;
-                }
+        if (usbBufCount < sizeof(usbBuf) - 1)
+        {
+            if (ch == '\n')
+            {   // End of line found so parse the buffer when the TX and the bus allow
+                lineReady = true;
+                TaskSignal(TASK_CMD);
             }
             else
-            {   // Overflow so reset buffer
-                usbBufCount = 0;
-                usbBuf[0] = 0;
+            {   // Pad buffer with latest char
+                usbBuf[usbBufCount] = ch;
+                usbBufCount++;
+                usbBuf[usbBufCount] = 0;
             }
-            keep_going = true ;
         }
+        else
+        {   // Overflow so reset buffer
+            usbBufCount = 0;
+            usbBuf[0] = 0;
+        }
+    }
+}
 
-        // GPS receiver, also initiates the display updating if relevant
-        if (gps.autoParse()) {
-            //gpsNMEA.getFrameData(&gpsdata) ;
+// Command line task, signalled by the USB receiver. The command runs as an I2C job
+void CommandTask()
+{
+    I2cBusPost(I2C_EEPROM, RunCommand);
+    lineReady = false;
+}
 
-            if (gpsEcho) {
-                const char* frame = gpsNMEA.getLastFrame() ;
-                SerialUSB.println(frame);
-            }
+// Gate of the command line task: the reading commands run during a frame, the rest after it
+bool CommandReady()
+{
+    return (txState == TX_IDLE) || CommandTxSafe(usbBuf);
+}
 
-            if (displayMode & displayAutoUpdate) {
-                Display_Update();
-            }
+// Gate of the tasks that change what the TX engine sends
+bool TxIdle()
+{
+    return txState == TX_IDLE;
+}
+
+// Gate of the calibration task: TX idle and the count done before the next slot must be
+// found, so a slot is never started late. Otherwise it waits until the slot's frame is sent
+bool CalibReady()
+{
+    uint32_t seconds, us;
+    uint32_t period = TxEngineMode()->periodMinutes * 60UL;
+
+    if (!TxIdle())
+        return false;
+    if (!ClockToUtc(ClockNow(), &seconds, &us))
+    {
+        seconds = rtc.getEpoch();
+        us = 0;
+    }
+    return (uint64_t) (period - seconds % period) * 1000000ULL - us > CAL_GUARD_US;
+}
+
+// GPS receiver task, also initiates the time keeping and the display updating
+void GpsTask()
+{
+    bool parsed ;
+
+    PROF_CALL(PROF_GPS, parsed = gps.autoParse());
+    if (parsed) {
+        ClockGps();                   // First, the parse time less the NMEA delay is the anchor
+
+        if (gpsEcho) {
+            const char* frame = gpsNMEA.getLastFrame() ;
+            SerialUSB.println(frame);
         }
+        if (TelemetryOn())
+            TelemetryNmea(gpsNMEA.getLastFrame());
+
+        TaskSignal(TASK_TIME);
+        TaskSignal(TASK_LCD);
+    }
+}
 
-    } while (keep_going) ;
+#if FEATURE_LCD
+// Display task. The refresh itself is an I2C job so it only runs if it fits before the next symbol edge
+void LcdTask()
+{
+    if (displayMode & displayAutoUpdate) {
+        I2cBusPost(I2C_LCD, Display_Update);
+    }
+}
+#endif
+
+// Calibration task, signalled by loop() every calibInterval passes and run while TX is idle
+// and no slot is due
+void CalibTask()
+{
+    I2cBusBegin(I2C_CAL);
+    PROF_CALL(PROF_REFCAL, si5351a.refreshRefFrequency());
+
+    // Already saved first measured reference frequency to EEPROM?
+    if (!firstCalibationSaved)
+    {
+        RFzero.saveReferenceStartFreq();
+        firstCalibationSaved = true;
+    }
+    CalibSample(freqCount.getReferenceFrequency());
+    I2cBusEnd(I2C_CAL);
+    PROF_CALL(PROF_TONES, BandRefresh());
+}
+
+// Foreground tasks woven into standard Arduino function. Always include in "slow" loops
+void yield()
+{
+    PROF_SCOPE(PROF_YIELD);
+
+    ClockNow();                       // Keeps the 64 bit clock across the micros() wrap
+    TaskRun();
 }
 
 void setup()
 {
     // Initialize RFzero for the specific application (must always be present)
     RFzero.Init(EEPROM_TYPE_24LC08B);                // EEPROM types: http://www.rfzero.net/documentation/eeprom-data/
+    I2cBusInit();                                    // 100 kHz until a client needs more
+    BootStart();                                     // Reset cause and RTC state, before rtc.begin() changes it
+
+    // Foreground tasks run by yield(), in the priority order of tasks.h. Before anything yields
+    TaskAdd(TASK_GPS, GpsTask, TASK_EVERY_PASS, 2000UL);
+    TaskAdd(TASK_TIME, Time_Update, TASK_ON_SIGNAL, 1000UL);
+    TaskAdd(TASK_USB, UsbTask, TASK_EVERY_PASS, USB_TASK_US + 1000UL);
+    TaskAdd(TASK_CMD, CommandTask, TASK_ON_SIGNAL, 100UL, CommandReady);   // Configuration changes wait for the frame to end
+#if FEATURE_LCD
+    TaskAdd(TASK_LCD, LcdTask, TASK_ON_SIGNAL, 100UL);
+#endif
+    TaskAdd(TASK_I2C, I2cBusRun, TASK_EVERY_PASS, 30000UL);        // Jobs are fitted to the TX edge by the arbiter itself
+    TaskAdd(TASK_CAL, CalibTask, TASK_ON_SIGNAL, CAL_BUDGET_US, CalibReady);  // Counts the reference for about a second
+    TaskAdd(TASK_STATS, TaskStats, 1000, 100UL);
+    TaskReset();
 
     // Heat up
     si5351a.rfOff();
     si5351a.setFrequency(200000000.0);
 
-    // Setup USB
+    // Setup USB. Wait for the host, but at most 2 s as "while (!(SerialUSB));" halts if not connected to USB. Checks show up to 1 s
     SerialUSB.begin(9600);
-    delay(2000);  // Delay used instead of "while (!(SerialUSB));" because it halts if not connected to USB. Checks show up to 1 s so 2 s to be on the safe side
+    while (!SerialUSB && (millis() < 2000))
+        yield();
 
-    // Initialize the RTC
+    // Initialize the RTC. Keeps the time after a watchdog, software or external reset
     rtc.begin();
 
     // Load configuration
@@ -254,12 +393,12 @@ void setup()
         SerialUSB.println("Enter   ?   for help");
         SerialUSB.println("RFzero>");
     }
+    CalibLoad();                                          // Predicted reference until the first measurement
+    JournalLoad();                                        // Continue the TX journal
     LoadConfiguration();                                  // Load defaults incl. default xtal frequency
+    bool resume = BootResume();                           // GPS set RTC and same configuration as before the reset
 
-    // Setup PA control
-    pinMode(0, OUTPUT);                                   // D0 is PA control
-    digitalWrite(0, LOW);
-
+#if FEATURE_LCD
     // Rotary Encoder
     pinMode(encA, INPUT); // Setup pins for encoder
     pinMode(encB, INPUT);
@@ -287,61 +426,96 @@ void setup()
         LCD.noCursor();
         LCD.clear();
         
-        // Print S/W versions
-        LCD.print("RFzero library");
-        LCD.setCursor(0, 1);
-        LCD.print("version: ");
-        LCD.print(RFZERO_LIBRARY_VERSION);
-        delay(3000);
-
-        LCD.clear();
-        sprintf(esc, "%.16s", swPackage);
-        LCD.print(esc);
-        LCD.setCursor(0, 1);
-        LCD.print("version: ");
-        LCD.print(swVersion);
-        delay(3000);
-
-        manageFreq();
+        if (!resume)
+        {
+            // Print S/W versions. delay() calls yield() so the GPS is acquired meanwhile
+            LCD.print("RFzero library");
+            LCD.setCursor(0, 1);
+            LCD.print("version: ");
+            LCD.print(RFZERO_LIBRARY_VERSION);
+            delay(3000);
+
+            LCD.clear();
+            sprintf(esc, "%.16s", swPackage);
+            LCD.print(esc);
+            LCD.setCursor(0, 1);
+            LCD.print("version: ");
+            LCD.print(swVersion);
+            delay(3000);
+
+            manageFreq();
+            BandRefresh();                                // The beacon frequency may have been changed
+        }
         displayAutoUpdate = 1;
         ScreenSet();
     }
-    
+#endif // FEATURE_LCD
 
-
-    // Warm up?
-    if (warmUp)
+    // Warm up and wait for the GPS to be valid at the same time. The warm up counts from the
+    // reset, so the splash and the frequency dialog are part of it. A resume needs neither as
+    // the Si5351 kept running and the RTC kept the time
+    if (!resume)
     {
         char buf[40];
-        sprintf(buf, "Warming up for %d s. Please wait", warmUp);
-        SerialUSB.print(buf);
-        for (int i = 0; i < warmUp; i++)
+        int dots = 0;
+
+        if (warmUp)
         {
-            SerialUSB.print(".");
-            for (int j = 0; j < 5; j++)
+            sprintf(buf, "Warming up for %d s. Please wait", warmUp);
+            SerialUSB.print(buf);
+        }
+        while ((millis() < warmUp * 1000UL) || !gpsNMEA.getValid())
+        {
+            if (millis() < warmUp * 1000UL)
             {
-                hardware.txLed(ON);
-                delay(100);
-                hardware.txLed(OFF);
-                delay(100);
+                hardware.txLed((millis() / 100) & 1);
+                if (dots < (int) (millis() / 1000))
+                {
+                    SerialUSB.print(".");
+                    dots++;
+                }
             }
+            else
+                hardware.txLed(OFF);
+            yield();
+        }
+        hardware.txLed(OFF);
+        if (warmUp)
+        {
+            if (configMode)
+                SerialUSB.println("\nRFzero config>");
+            else
+                SerialUSB.println("\nRFzero>");
         }
-        if (configMode)
-            SerialUSB.println("\nRFzero config>");
-        else
-            SerialUSB.println("\nRFzero>");
+    }
+    else
+    {
+        goodRTC = 1;                                          // Trust the kept RTC until the next GPS sync
+        TXflag = 0;                                           // and transmit in the next slot
+        SerialUSB.println("Resumed after reset, RTC kept");
     }
 
-    // Always wait for GPS to be valid
-    while (!gpsNMEA.getValid())
-        yield();
+    BootSaveConfig();
+    TxEnginePaPin(pinPA);                                     // PA pin off, switched by the TX engine's sequencer
+    BootReady(resume);
+}
 
-    pinMode(pinPA, OUTPUT);                                   // Set PA pin mode
-    digitalWrite(pinPA, LOW);                                 // Turn PA pin off
-    
-    // Center the PLL
-    Modes.setCWCarrierTone(true);
-    
+// True ahead of the start of the mode's T/R period, with the ClockNow() time it starts. Early
+// enough for the TX engine to run the PA lead and RF ramp before the edge, on the GPS
+// anchored clock, or on the RTC second tick without an anchor
+bool SlotStart(uint64_t *start)
+{
+    uint32_t seconds, us;
+    uint32_t period = TxEngineMode()->periodMinutes;
+
+    if (ClockToUtc(ClockNow() + SLOT_EARLY_US, &seconds, &us))
+        *start = ClockFromUtc(seconds);
+    else
+    {
+        seconds = rtc.getEpoch() + SLOT_EARLY_S;              // The second that starts SLOT_EARLY_S after the last tick
+        *start = ClockNow() + SLOT_EARLY_S * 1000000ULL;
+    }
+    return !(((seconds / 60) % 60) % period) && !(seconds % 60);
 }
 
 void loop()
@@ -349,49 +523,84 @@ void loop()
     // Took-took GPS
     struct gpsData gpsInfo;          // Create local object with all parameters
     
-    // Calibrate if required and save first time
+    // Calibrate if required and save first time. Run by the calibration task, now, before the slot check
     if (--calibIntervalCounter < 1)
     {
         calibIntervalCounter = calibInterval;
-        si5351a.refreshRefFrequency();
-
-        // Already saved first measured reference frequency to EEPROM?
-        if (!firstCalibationSaved)
-        {
-            RFzero.saveReferenceStartFreq();
-            firstCalibationSaved = true;
-        }
-        Modes.calculateTones(frequency);
+        TaskSignal(TASK_CAL);
+        yield();
     }
 
     //Get Time From RTC, validate it, validate minutes/seconds, starte the transmission
+    uint64_t slotStart;
     if(TXflag<=0 && goodRTC) {
-      if (!(rtc.getMinutes() % 2) && !rtc.getSeconds()) {
+      if (SlotStart(&slotStart)) {   // Start of the mode's T/R period
 
-        digitalWrite(pinPA, HIGH);                    // Turn PA pin on
-        
-        TXflag = Interval; // NOTE: 110.6 seconds - is WSPR time to transmit the payload                
-        
-        si5351a.rfOn();
-        Modes.sendMGM();
-        si5351a.rfOff();                              // Send "no signal"
+        uint32_t slot = (rtc.getEpoch() + 30) / 60;   // The RTC second may lag the GPS anchored one
+        if (slot == lastSlot)
+            return;                                   // Already handled
+        if (slot == telemetrySlot)
+        {
+            lastSlot = slot;
+            telemetrySlot = 0;
+            JournalStart(slotStart);
+            TxEngineStartAt((unsigned long) slotStart);
+            JournalWrite(JOURNAL_TELEMETRY, 0, TxEngineSendTelemetry() ? JOURNAL_SENT : JOURNAL_FAILED);   // Encoded in the gap after the regular frame
+            return;
+        }
+        if (!SchedSlot(slot))
+            return;                                   // Not in the slot calendar
+        lastSlot = slot;
+
+        bool qrss = qrssEvery && (qrssSlots + 1 >= qrssEvery);   // QRSS instead of WSPR in every qrssEvery'th slot
+        int band = qrss ? TX_TABLE_QRSS : BandForSlot((slot / 60) % 24, slot % 60);
+        if (band == BAND_NONE)
+            return;                                   // Nothing scheduled in this slot, try the next one
+        JournalStart(slotStart);
+        int msg = 0;
+        if (!qrss)
+        {
+            msg = MessageNext();                      // Next message of the table, from the precomputed rotations
+            if (MessageTable(msg) != BAND_NONE)
+                band = MessageTable(msg);             // The message has its own frequency
+            if (!TxEngineMessage(msg) || !TxEngineSelect(band))
+            {
+                JournalWrite(JOURNAL_WSPR, msg, TxEngineFrames(msg) ? JOURNAL_NO_TABLE : JOURNAL_NO_FRAME);
+                return;
+            }
+        }
 
-        hardware.txLed(OFF);
-        
-        digitalWrite(pinPA, LOW);                     // Turn PA pin off
+        qrssSlots = qrss ? 0 : qrssSlots + 1;
+        TxEngineStartAt((unsigned long) slotStart);   // On the UTC edge
+
+        BootFirstTx();                                // Report the time to the first TX once
+        if (qrss)
+        {
+            bool sent = TxEngineSendQrss();           // The call in QRSS, FSKCW or DFCW, PA sequenced by the TX engine
+            JournalWrite(JOURNAL_QRSS, 0, sent ? JOURNAL_SENT : JOURNAL_FAILED);
+        }
+        else
+        {
+            TxEngineOffset(SchedOffset(slot));        // Place in the WSPR window
+            bool sent = TxEngineSend();               // Next frame of the type 1/2/3 rotation, PA sequenced by the TX engine
+            JournalWrite(JOURNAL_WSPR, msg, sent ? JOURNAL_SENT : JOURNAL_FAILED);
+            if (TelemetryPrepare())                   // Balloon telemetry in the next slot
+                telemetrySlot = slot + TxEngineMode()->periodMinutes;
+        }
         
         if(++seqn > 99) seqn = 1;                     // just calculate number of seuences we sent out
       }
     }        
 }
 
+#if FEATURE_LCD
 void RotEncHalfStep()
 {
   encState = encTableHalfStep[encState & 0xF][(digitalRead(encB) << 1) | digitalRead(encA)];
-  int result = encState & 0x30;
-  if (result == 0x20)
+  int result = encState & ENC_DIRECTION;
+  if (result == ENC_LEFT)
     REdec = 1;
-  if (result == 0x10)
+  if (result == ENC_RIGHT)
     REinc = 1;  
   //if (result)
   //  SerialUSB.println(result == 0x20 ? "Left" : "Right");  // 0x20 = Left, 0x10 = Right
@@ -400,10 +609,10 @@ void RotEncHalfStep()
 void RotEncFullStep()
 {
   encState = encTableFullStep[encState & 0xF][(digitalRead(encB) << 1) | digitalRead(encA)];
-  int result = encState & 0x30;
-  if (result == 0x20)
+  int result = encState & ENC_DIRECTION;
+  if (result == ENC_LEFT)
     REdec = 1;
-  if (result == 0x10)
+  if (result == ENC_RIGHT)
     REinc = 1; 
   //if (result)   
   //SerialUSB.println(result == 0x20 ? "Left" : "Right");  // 0x20 = Left, 0x10 = Right
@@ -443,31 +652,31 @@ void manageFreq(void)
     switch(REbutton) {
       case 1:
         mult = 1.0;
-        sprintf(esc,"RANK: 1Hz   ");
+        FmtStr(esc, "RANK: 1Hz   ");
         break;
       case 2:
         mult = 10.0;
-        sprintf(esc,"RANK: 10Hz  ");
+        FmtStr(esc, "RANK: 10Hz  ");
         break;
       case 3:
         mult = 100.0;
-        sprintf(esc,"RANK: 100Hz ");
+        FmtStr(esc, "RANK: 100Hz ");
         break;
       case 4:
         mult = 1000.0;
-        sprintf(esc,"RANK: 1KHz  ");
+        FmtStr(esc, "RANK: 1KHz  ");
         break;
       case 5:
         mult = 10000.0;
-        sprintf(esc,"RANK: 10KHz ");
+        FmtStr(esc, "RANK: 10KHz ");
         break;
       case 6:
         mult = 100000.0;
-        sprintf(esc,"RANK: 100KHz");
+        FmtStr(esc, "RANK: 100KHz");
         break;
       case 7:
         mult = 1000000.0;
-        sprintf(esc,"RANK: 1MHz  ");
+        FmtStr(esc, "RANK: 1MHz  ");
         break;
       default:
         mult = 0.0;
@@ -501,7 +710,8 @@ void manageFreq(void)
       flag = 0;
       prevfreq = frequency;
       LCD.setCursor(6, 3);
-      LCD.print(frequency, 0);
+      FmtUint(esc, (uint32_t) lround(frequency));
+      LCD.print(esc);
     }   
   }
 }
@@ -515,18 +725,20 @@ void ScreenSet(void)
 
   // Second string
   LCD.setCursor(0, 1);
-  sprintf(esc, "MSG: %s %s", call, locator);
+  char *p = FmtStr(esc, "MSG: ");
+  p = FmtStr(p, call);
+  p = FmtStr(p, " ");
+  FmtStr(p, locator);
   LCD.print(esc); 
         
   // Third string
   LCD.setCursor(0, 2);
-  LCD.print("QRG: ");
-  float z = frequency/1000.0;
-  LCD.print(z, 2);
-  LCD.print(" kHz");
+  FmtStr(FmtKhz(FmtStr(esc, "QRG: "), (uint32_t) frequency, 2), " kHz");
+  LCD.print(esc);
         
   // Fourth string
   LCD.setCursor(0, 3);
   LCD.print("STABILIZING...");        
 }
+#endif // FEATURE_LCD
 // ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,136 @@
+// Own include
+#include "band.h"
+
+// RFzero includes
+#include <RFzero.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "global.h"
+#include "config.h"
+#include "settings.h"
+#include "txengine.h"
+
+// Band table and hopping schedule. Every enabled band has its own precalculated tone
+// table in the TX engine, so the schedule only picks which table the next frame uses
+
+static uint32_t bandFreq[BANDS_MAX];       // Centre frequency in Hz
+static uint16_t bandEnable = 0;            // Bit n set: band n is enabled
+static uint8_t bandHour[24];               // HOP_HOURLY: band + 1 per UTC hour, 0: beacon frequency
+static uint8_t hopMode = HOP_OFF;
+static int hopNext = 0;                    // HOP_ROTATE: band to try next
+
+// Read the band table and schedule, and calculate the tone tables of all enabled bands
+void BandLoad()
+{
+    hopMode = eeprom.readByte(EEPROM_BAND_HopMode, HOP_OFF);
+    if (hopMode >= HOP_MODES)
+        hopMode = HOP_OFF;
+
+    bandEnable = (eeprom.readByte(EEPROM_BAND_Enable + 1, 0) << 8) | eeprom.readByte(EEPROM_BAND_Enable, 0);
+    bandEnable &= (1 << BANDS_MAX) - 1;
+
+    for (int i = 0; i < BANDS_MAX; i++)
+    {
+        bandFreq[i] = eeprom.readInteger(EEPROM_BAND_Freq + 4 * i, SettingBandDefault(i));
+        if ((bandFreq[i] < 100000) || (bandFreq[i] > 298765432))       // Same range as the beacon frequency
+            bandFreq[i] = SettingBandDefault(i);
+    }
+
+    for (int h = 0; h < 24; h++)
+    {
+        bandHour[h] = (eeprom.readByte(EEPROM_BAND_Hour + h / 2, 0) >> (4 * (h % 2))) & 0x0F;
+        if (bandHour[h] > BANDS_MAX)
+            bandHour[h] = 0;
+    }
+
+    hopNext = 0;
+    BandRefresh();
+}
+
+// Recalculate the tone tables, e.g. after a new reference measurement. Tables with
+// unchanged frequency and reference are skipped by the TX engine
+void BandRefresh()
+{
+    TxEngineTones(TX_TABLE_BEACON, frequency);
+    if (qrssEvery)
+        TxEngineQrssTones(qrssFrequency, qrssShift / 10.0);
+    if (dualEnable)
+        TxEngineTones(TX_TABLE_DUAL, dualFrequency);
+    MessageRefresh();
+    if (hopMode == HOP_OFF)
+        return;
+
+    for (int i = 0; i < BANDS_MAX; i++)
+        if (bandEnable & (1 << i))
+            TxEngineTones(i, bandFreq[i]);
+}
+
+// The tone table to use for the slot starting at hour:minute UTC, or BAND_NONE if the
+// schedule has nothing to send in it
+int BandForSlot(const int hour, const int minute)
+{
+    return BandPreview(hour, minute, &hopNext);
+}
+
+// As BandForSlot(), but the rotation is taken from and advanced in *next, which starts
+// at BandRotation(). Lists the plan without changing it
+int BandPreview(const int hour, const int minute, int *next)
+{
+    switch (hopMode)
+    {
+        case HOP_ROTATE:
+            for (int i = 0; i < BANDS_MAX; i++)
+            {
+                int band = (*next + i) % BANDS_MAX;
+                if (bandEnable & (1 << band))
+                {
+                    *next = (band + 1) % BANDS_MAX;
+                    return band;
+                }
+            }
+            return TX_TABLE_BEACON;                            // Nothing enabled
+
+        case HOP_PLAN:
+        {
+            int band = (minute % 20) / 2;
+            return (bandEnable & (1 << band)) ? band : BAND_NONE;
+        }
+
+        case HOP_HOURLY:
+            if (!bandHour[hour % 24])
+                return TX_TABLE_BEACON;
+            return (bandEnable & (1 << (bandHour[hour % 24] - 1))) ? bandHour[hour % 24] - 1 : BAND_NONE;
+
+        default:
+            return TX_TABLE_BEACON;
+    }
+}
+
+double BandFrequency(const int band)
+{
+    return ((band >= 0) && (band < BANDS_MAX)) ? bandFreq[band] : frequency;
+}
+
+bool BandEnabled(const int band)
+{
+    return (band >= 0) && (band < BANDS_MAX) && (bandEnable & (1 << band));
+}
+
+// Band + 1 for the UTC hour, 0: beacon frequency
+int BandHourly(const int hour)
+{
+    return bandHour[hour % 24];
+}
+
+int BandHopMode()
+{
+    return hopMode;
+}
+
+// HOP_ROTATE: the band to try next
+int BandRotation()
+{
+    return hopNext;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,31 @@
+#ifndef _BAND_H
+#define _BAND_H
+
+// Arduino includes
+#include <Arduino.h>
+
+#define BANDS_MAX        10                // 160 m to 10 m, the bands of the WSPR hopping plan
+#define BAND_NONE        -1                // No transmission in this slot
+
+// Hopping modes
+#define HOP_OFF           0                // Beacon frequency only
+#define HOP_ROTATE        1                // Next enabled band on every transmission
+#define HOP_PLAN          2                // Band given by the slot in the 20 min WSPR hopping plan
+#define HOP_HOURLY        3                // Band given by the UTC hour
+
+#define HOP_MODES         4
+
+// Function prototypes
+void BandLoad();
+void BandRefresh();
+int BandForSlot(const int hour, const int minute);
+int BandPreview(const int hour, const int minute, int *next);
+double BandFrequency(const int band);
+bool BandEnabled(const int band);
+int BandHourly(const int hour);
+int BandHopMode();
+int BandRotation();
+
+#endif // _BAND_H
+
+// ----------------- EOF -------------------------------------------------------------------
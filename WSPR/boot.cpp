@@ -0,0 +1,101 @@
+// Own include
+#include "boot.h"
+
+// RFzero includes
+#include <RFzero.h>
+#include <RTCZero.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "global.h"
+#include "config.h"
+#include "settings.h"
+
+// Boot bookkeeping. After a watchdog, software or external reset RTCZero keeps the clock
+// running, and if that clock had been set from GPS and the configuration is the one that
+// was running, setup() can skip the splash, the frequency dialog and the GPS wait and go
+// straight back into the schedule. A power-on or brown-out reset always boots in full, as
+// RTCZero restarts the clock then.
+//
+// The running configuration is identified by its signature, see settings.cpp, stored in
+// the EEPROM whenever it changes
+
+extern RTCZero rtc;
+
+static uint32_t resetCause = 0;          // PM->RCAUSE at start up
+static bool rtcKept = false;             // The RTC was running in clock mode through the reset
+static bool resumed = false;
+static unsigned long readyMs = 0;        // millis() when setup() finished
+static unsigned long firstTxMs = 0;      // millis() of the first transmission, 0: none yet
+
+// Must run before rtc.begin(), which reconfigures the RTC
+void BootStart()
+{
+    resetCause = PM->RCAUSE.reg;
+    rtcKept = (resetCause & (PM_RCAUSE_SYST | PM_RCAUSE_WDT | PM_RCAUSE_EXT)) &&
+              ((RTC->MODE2.CTRL.reg & RTC_MODE2_CTRL_MODE_Msk) == RTC_MODE2_CTRL_MODE_CLOCK);
+}
+
+// True if the clock survived the reset with a GPS set time and the configuration is
+// unchanged. Call after rtc.begin() and LoadConfiguration()
+bool BootResume()
+{
+    uint16_t stored = (eeprom.readByte(EEPROM_BOOT_Signature + 1, 0xFF) << 8) | eeprom.readByte(EEPROM_BOOT_Signature, 0xFF);
+
+    return rtcKept && (rtc.getYear() == BOOT_SYNCED_YEAR) && (stored == SettingSignature(ConfigRead));
+}
+
+// Store the signature of the running configuration if it changed
+void BootSaveConfig()
+{
+    uint16_t crc = SettingSignature(ConfigRead);
+
+    if ((eeprom.readByte(EEPROM_BOOT_Signature, 0xFF) != (crc & 0xFF)) || (eeprom.readByte(EEPROM_BOOT_Signature + 1, 0xFF) != (crc >> 8)))
+    {
+        eeprom.writeByte(EEPROM_BOOT_Signature, crc & 0xFF);
+        eeprom.writeByte(EEPROM_BOOT_Signature + 1, crc >> 8);
+    }
+}
+
+void BootReady(const bool resume)
+{
+    resumed = resume;
+    readyMs = millis();
+}
+
+// Report the time from reset to the first transmission, once
+void BootFirstTx()
+{
+    char buf[60];
+
+    if (firstTxMs)
+        return;
+    firstTxMs = millis();
+    sprintf(buf, "First TX %lu s after reset", (firstTxMs + 500) / 1000);
+    SerialUSB.println(buf);
+}
+
+void BootDump()
+{
+    static const char* const causeName[8] = { "POR", "BOD12", "BOD33", "?", "EXT", "WDT", "SYST", "?" };
+    char buf[60];
+
+    SerialUSB.print("Reset cause:");
+    for (int i = 0; i < 8; i++)
+        if (resetCause & (1 << i))
+        {
+            SerialUSB.print(" ");
+            SerialUSB.print(causeName[i]);
+        }
+    SerialUSB.println();
+    sprintf(buf, "Boot: %s, RTC %s", resumed ? "resumed into the schedule" : "full", rtcKept ? "kept" : "restarted");
+    SerialUSB.println(buf);
+    sprintf(buf, "Setup done after %lu ms", readyMs);
+    SerialUSB.println(buf);
+    if (firstTxMs)
+        sprintf(buf, "First TX %lu s after reset", (firstTxMs + 500) / 1000);
+    else
+        sprintf(buf, "No TX yet");
+    SerialUSB.println(buf);
+}
+
+// ----------------- EOF -------------------------------------------------------------------
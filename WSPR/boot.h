@@ -0,0 +1,19 @@
+#ifndef _BOOT_H
+#define _BOOT_H
+
+// Arduino includes
+#include <Arduino.h>
+
+#define BOOT_SYNCED_YEAR     1           // RTC year once the time is set from GPS, the date is otherwise unused
+
+// Function prototypes
+void BootStart();
+bool BootResume();
+void BootSaveConfig();
+void BootReady(const bool resumed);
+void BootFirstTx();
+void BootDump();
+
+#endif // _BOOT_H
+
+// ----------------- EOF -------------------------------------------------------------------
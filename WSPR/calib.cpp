@@ -0,0 +1,340 @@
+// Own include
+#include "calib.h"
+
+// RFzero includes
+#include <RFzero.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "config.h"
+
+// Reference calibration history. The reference is only measured against the GPS every few
+// transmissions, so after a reset the first frames would go out on the start frequency the
+// library stored on the previous boot. Instead every measurement is logged with the
+// processor temperature and the operating time in a small ring in the EEPROM, a linear
+// aging and temperature model is fitted to the ring, and its prediction stands in for the
+// reference until the first new measurement.
+//
+// Entry layout, little endian: sequence, CRC-8 of the rest, temperature (2), minutes (4),
+// offset (4). Entries are written round robin, the newest is the valid entry whose
+// successor does not carry the next sequence number. Time is operating time, continued
+// from the newest entry after each reset, so aging while powered off is not modelled
+
+#define CALIB_NOMINAL        27000000.0  // Hz, offsets are stored relative to this
+#define CALIB_AGING_SPAN     (24 * 60)   // Minutes of history before aging is fitted
+#define CALIB_TEMP_SPAN      20          // Temperature spread in 0.1 C before the temperature coefficient is fitted
+#define TEMP_LOG_ROW         0x00806030UL // NVM software calibration area, temperature log row
+
+static CalibEntry ring[CALIB_SAMPLES];
+static bool valid[CALIB_SAMPLES];
+static uint8_t seq[CALIB_SAMPLES];
+static int newest = -1;                  // Ring index of the newest entry, -1: empty
+static uint32_t baseMinutes = 0;         // Operating minutes at reset
+
+// Fitted model: offset = offsetMean + aging * (t - tMean) + tempco * (T - tempMean)
+static double offsetMean = 0.0;
+static double tMean = 0.0;
+static double tempMean = 0.0;
+static double aging = 0.0;               // mHz per minute
+static double tempco = 0.0;              // mHz per 0.1 C
+static int fitted = 0;                   // Entries in the fit
+static double predicted = 0.0;           // Reference in Hz at reset time, 0.0: no history
+static int16_t bootTemp = 0;
+
+// CRC-8, polynomial 0x07
+static uint8_t Crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static uint32_t Minutes()
+{
+    return baseMinutes + millis() / 60000UL;
+}
+
+static void Pack(const CalibEntry *e, uint8_t *b)
+{
+    b[2] = e->temp & 0xFF;
+    b[3] = (e->temp >> 8) & 0xFF;
+    for (int i = 0; i < 4; i++)
+    {
+        b[4 + i] = (e->minutes >> (8 * i)) & 0xFF;
+        b[8 + i] = ((uint32_t) e->offset >> (8 * i)) & 0xFF;
+    }
+    b[1] = Crc8(&b[2], CALIB_SAMPLE_SIZE - 2);
+}
+
+static bool Unpack(const uint8_t *b, CalibEntry *e)
+{
+    uint32_t offset = 0;
+
+    if (Crc8(&b[2], CALIB_SAMPLE_SIZE - 2) != b[1])
+        return false;
+
+    e->temp = (int16_t) (b[2] | (b[3] << 8));
+    e->minutes = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        e->minutes |= (uint32_t) b[4 + i] << (8 * i);
+        offset |= (uint32_t) b[8 + i] << (8 * i);
+    }
+    e->offset = (int32_t) offset;
+    return true;
+}
+
+static double Predict(const double minutes, const int16_t temp)
+{
+    double offset = offsetMean + aging * (minutes - tMean) + tempco * (temp - tempMean);
+    double limit = CALIB_MAX_SHIFT * CALIB_NOMINAL / 1000.0;    // ppm of the nominal in mHz
+
+    // A poor fit must not take the reference further away than the newest measurement
+    if (fabs(offset - ring[newest].offset) > limit)
+        offset = ring[newest].offset;
+    return CALIB_NOMINAL + offset / 1000.0;
+}
+
+// Least squares fit of the offset to time and temperature. Aging needs a day of history
+// and the temperature coefficient a couple of degrees of spread, until then they are 0
+static void Fit()
+{
+    double stt = 0.0, sTT = 0.0, stT = 0.0, stf = 0.0, sTf = 0.0;
+
+    fitted = 0;
+    offsetMean = tMean = tempMean = aging = tempco = 0.0;
+    for (int i = 0; i < CALIB_SAMPLES; i++)
+        if (valid[i])
+        {
+            offsetMean += ring[i].offset;
+            tMean += ring[i].minutes;
+            tempMean += ring[i].temp;
+            fitted++;
+        }
+    if (!fitted)
+        return;
+    offsetMean /= fitted;
+    tMean /= fitted;
+    tempMean /= fitted;
+
+    for (int i = 0; i < CALIB_SAMPLES; i++)
+        if (valid[i])
+        {
+            double t = ring[i].minutes - tMean;
+            double T = ring[i].temp - tempMean;
+            double f = ring[i].offset - offsetMean;
+
+            stt += t * t;
+            sTT += T * T;
+            stT += t * T;
+            stf += t * f;
+            sTf += T * f;
+        }
+
+    // Spread as a standard deviation
+    bool useAge = sqrt(stt / fitted) * 2.0 >= CALIB_AGING_SPAN;
+    bool useTemp = sqrt(sTT / fitted) * 2.0 >= CALIB_TEMP_SPAN;
+    double det = stt * sTT - stT * stT;
+
+    if (useAge && useTemp && (det > 1e-9 * stt * sTT))
+    {
+        aging = (stf * sTT - sTf * stT) / det;
+        tempco = (sTf * stt - stf * stT) / det;
+    }
+    else if (useAge)
+        aging = stf / stt;
+    else if (useTemp)
+        tempco = sTf / sTT;
+}
+
+// Read the ring, fit the model and predict the reference. Call once the EEPROM is usable
+void CalibLoad()
+{
+    uint8_t b[CALIB_SAMPLE_SIZE];
+
+    newest = -1;
+    for (int i = 0; i < CALIB_SAMPLES; i++)
+    {
+        for (int j = 0; j < CALIB_SAMPLE_SIZE; j++)
+            b[j] = eeprom.readByte(EEPROM_CALIB_Ring + i * CALIB_SAMPLE_SIZE + j, 0xFF);
+        seq[i] = b[0];
+        valid[i] = Unpack(b, &ring[i]);
+    }
+    for (int i = 0; i < CALIB_SAMPLES; i++)
+    {
+        int next = (i + 1) % CALIB_SAMPLES;
+        if (valid[i] && (!valid[next] || (seq[next] != (uint8_t) (seq[i] + 1))))
+        {
+            newest = i;
+            break;
+        }
+    }
+
+    predicted = 0.0;
+    if (newest < 0)
+        return;
+
+    baseMinutes = ring[newest].minutes - millis() / 60000UL;
+    Fit();
+    bootTemp = CalibTemperature();
+    predicted = Predict(Minutes(), bootTemp);
+}
+
+// Predicted reference frequency, or the start value stored by the library if there is
+// no history
+double CalibReference()
+{
+    if (predicted > 0.0)
+        return predicted;
+    return eeprom.readInteger(EEPROM_HW_RefStartFreq, 27000000L);
+}
+
+// Log a measured reference frequency. To spare the EEPROM an entry is only written after
+// CALIB_MIN_MINUTES or a change in temperature
+void CalibSample(const double fref)
+{
+    CalibEntry e;
+    uint8_t b[CALIB_SAMPLE_SIZE];
+    double offset = (fref - CALIB_NOMINAL) * 1000.0;
+
+    if ((fref <= 0.0) || (fabs(offset) > 2.0e9))
+        return;
+
+    e.minutes = Minutes();
+    e.offset = (int32_t) lround(offset);
+    e.temp = CalibTemperature();
+    if ((newest >= 0) && (e.minutes - ring[newest].minutes < CALIB_MIN_MINUTES) && (abs(e.temp - ring[newest].temp) < CALIB_MIN_TEMP))
+        return;
+
+    int slot = (newest + 1) % CALIB_SAMPLES;
+    b[0] = (newest >= 0) ? seq[newest] + 1 : 0;
+    Pack(&e, b);
+    for (int j = 0; j < CALIB_SAMPLE_SIZE; j++)
+        eeprom.writeByte(EEPROM_CALIB_Ring + slot * CALIB_SAMPLE_SIZE + j, b[j]);
+
+    ring[slot] = e;
+    valid[slot] = true;
+    seq[slot] = b[0];
+    newest = slot;
+    Fit();
+}
+
+// Processor temperature in 0.1 C from the internal sensor, using the factory calibration
+// in the temperature log row (SAM D21 datasheet, 37.11.8.2)
+int16_t CalibTemperature()
+{
+    const uint32_t *row = (const uint32_t *) TEMP_LOG_ROW;
+    uint32_t log0 = row[0];
+    uint32_t log1 = row[1];
+    double roomT = (log0 & 0xFF) + ((log0 >> 8) & 0x0F) / 10.0;
+    double hotT = ((log0 >> 12) & 0xFF) + ((log0 >> 20) & 0x0F) / 10.0;
+    double roomRef = 1.0 - (int8_t) ((log0 >> 24) & 0xFF) / 1000.0;
+    double hotRef = 1.0 - (int8_t) (log1 & 0xFF) / 1000.0;
+    double roomV = ((log1 >> 8) & 0xFFF) * roomRef / 4095.0;
+    double hotV = ((log1 >> 20) & 0xFFF) * hotRef / 4095.0;
+    uint16_t raw = 0;
+
+    // Borrow the ADC. analogRead() only sets the input, so the rest is put back afterwards
+    SYSCTRL->VREF.reg |= SYSCTRL_VREF_TSEN;
+    ADC->CTRLA.bit.ENABLE = 0;
+    while (ADC->STATUS.bit.SYNCBUSY);
+    uint8_t refctrl = ADC->REFCTRL.reg, avgctrl = ADC->AVGCTRL.reg, sampctrl = ADC->SAMPCTRL.reg;
+    uint16_t ctrlb = ADC->CTRLB.reg;
+    uint32_t inputctrl = ADC->INPUTCTRL.reg;
+    ADC->REFCTRL.reg = ADC_REFCTRL_REFSEL_INT1V;
+    ADC->INPUTCTRL.reg = ADC_INPUTCTRL_MUXPOS_TEMP | ADC_INPUTCTRL_MUXNEG_GND | ADC_INPUTCTRL_GAIN_1X;
+    ADC->AVGCTRL.reg = ADC_AVGCTRL_SAMPLENUM_16 | ADC_AVGCTRL_ADJRES(4);
+    ADC->SAMPCTRL.reg = 63;
+    ADC->CTRLB.reg = ADC_CTRLB_PRESCALER_DIV256 | ADC_CTRLB_RESSEL_16BIT;
+    while (ADC->STATUS.bit.SYNCBUSY);
+    ADC->CTRLA.bit.ENABLE = 1;
+    while (ADC->STATUS.bit.SYNCBUSY);
+
+    // The first conversion after a reference change is discarded
+    for (int i = 0; i < 2; i++)
+    {
+        ADC->INTFLAG.reg = ADC_INTFLAG_RESRDY;
+        ADC->SWTRIG.bit.START = 1;
+        while (!(ADC->INTFLAG.reg & ADC_INTFLAG_RESRDY));
+        raw = ADC->RESULT.reg;
+    }
+    ADC->CTRLA.bit.ENABLE = 0;
+    while (ADC->STATUS.bit.SYNCBUSY);
+    ADC->REFCTRL.reg = refctrl;
+    ADC->INPUTCTRL.reg = inputctrl;
+    ADC->AVGCTRL.reg = avgctrl;
+    ADC->SAMPCTRL.reg = sampctrl;
+    ADC->CTRLB.reg = ctrlb;
+    while (ADC->STATUS.bit.SYNCBUSY);
+
+    if (hotV <= roomV)
+        return 250;
+
+    // Coarse temperature with a 1 V reference, then again with the reference corrected
+    // for that temperature
+    double coarse = roomT + (hotT - roomT) * (raw / 4095.0 - roomV) / (hotV - roomV);
+    double ref = roomRef + (hotRef - roomRef) * (coarse - roomT) / (hotT - roomT);
+    double fine = roomT + (hotT - roomT) * (raw * ref / 4095.0 - roomV) / (hotV - roomV);
+
+    return (int16_t) lround(fine * 10.0);
+}
+
+// Invalidate every entry by erasing all of it. An erased entry reads as a new EEPROM does,
+// all 0xFF, which fails the CRC as the CRC-8 of ten 0xFF bytes is 0xF5. Clearing only the
+// CRC byte would leave every entry whose CRC happens to be 0xFF valid
+void CalibClear()
+{
+    for (int i = 0; i < CALIB_SAMPLES; i++)
+    {
+        for (int j = 0; j < CALIB_SAMPLE_SIZE; j++)
+            eeprom.writeByte(EEPROM_CALIB_Ring + i * CALIB_SAMPLE_SIZE + j, 0xFF);
+        valid[i] = false;
+    }
+    newest = -1;
+    predicted = 0.0;
+    Fit();
+}
+
+void CalibDump()
+{
+    char buf[60];
+    int16_t temp = CalibTemperature();
+
+    SerialUSB.println("Minutes    Temp C  Reference Hz");
+    for (int n = 1; n <= CALIB_SAMPLES; n++)
+    {
+        int i = (newest + n) % CALIB_SAMPLES;
+        if ((newest < 0) || !valid[i])
+            continue;
+        sprintf(buf, "%-9lu  %-6d  ", (unsigned long) ring[i].minutes, ring[i].temp / 10);
+        SerialUSB.print(buf);
+        SerialUSB.println(CALIB_NOMINAL + ring[i].offset / 1000.0, 3);
+    }
+
+    sprintf(buf, "Fitted %d entries, aging ppm/1000 h: ", fitted);
+    SerialUSB.print(buf);
+    SerialUSB.print(aging * 60.0e6 / CALIB_NOMINAL, 3);
+    SerialUSB.print(", temperature ppm/C: ");
+    SerialUSB.println(tempco * 1.0e4 / CALIB_NOMINAL, 3);
+    sprintf(buf, "Operating time %lu min, temperature C: ", (unsigned long) Minutes());
+    SerialUSB.print(buf);
+    SerialUSB.print(temp / 10.0, 1);
+    SerialUSB.print(", at reset: ");
+    SerialUSB.println(bootTemp / 10.0, 1);
+    if (predicted > 0.0)
+    {
+        SerialUSB.print("Predicted reference Hz at reset: ");
+        SerialUSB.print(predicted, 3);
+        SerialUSB.print(", now: ");
+        SerialUSB.println(Predict(Minutes(), temp), 3);
+    }
+    else
+        SerialUSB.println("No history, the stored start reference is used");
+}
+
+// ----------------- EOF -------------------------------------------------------------------
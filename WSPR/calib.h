@@ -0,0 +1,31 @@
+#ifndef _CALIB_H
+#define _CALIB_H
+
+// Arduino includes
+#include <Arduino.h>
+
+#define CALIB_SAMPLES        32          // Ring entries in the EEPROM
+#define CALIB_SAMPLE_SIZE    12          // Bytes per entry
+#define CALIB_MIN_MINUTES    120         // Store a sample at most this often...
+#define CALIB_MIN_TEMP       20          // ...unless the temperature moved this many 0.1 C
+#define CALIB_MAX_SHIFT      2.0         // Largest prediction in ppm away from the newest sample
+
+// Reference calibration sample, as stored
+struct CalibEntry
+{
+    uint32_t minutes;                    // Operating minutes when measured
+    int32_t offset;                      // Reference frequency - 27 MHz in mHz
+    int16_t temp;                        // Processor temperature in 0.1 C
+};
+
+// Function prototypes
+void CalibLoad();
+double CalibReference();
+void CalibSample(const double fref);
+int16_t CalibTemperature();
+void CalibClear();
+void CalibDump();
+
+#endif // _CALIB_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,208 @@
+// Own include
+#include "clock.h"
+
+// RFzero includes
+#include <RFzero.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "fmt.h"
+
+// One time base for the slot timing and the TX journal. The RTC runs as a calendar with a
+// 1 s tick whose phase is wherever rtc.begin() left the prescaler, so a slot started on
+// the RTC second could be up to a second off UTC. This clock is micros(), SysTick at
+// F_CPU, extended to 64 bits monotonic microseconds, and anchored to GPS UTC by the first
+// NMEA sentence of every second. The RTC stays the calendar and keeps the time when the
+// GPS is lost, and micros() stays the low word, so the TX engine, the task and I2C
+// statistics all run on the same clock already.
+//
+// The sketch does not see the 1PPS edge, so the anchor is the time the first sentence is
+// parsed less the NMEA delay, the time from the UTC second to the end of that sentence.
+// The delay depends on the receiver, its sentence set and the baud rate, about 1 ms per
+// character at 9600 Bd. The default is typical of a receiver that starts its output some
+// 70 ms after the second with an RMC sentence first. Set it with wr gpsdelay: a spot DT
+// that is 0.2 s high means 200 ms more delay. An error in the delay moves every slot by
+// the same amount, the residual in rd clock does not show it.
+//
+// The sentence is parsed up to a yield() pass after it ends, so a first sentence later
+// than the anchor predicts is taken as a late parse and skipped, unless the anchor is
+// stale. The earliest parses win and the residual shows the jitter.
+//
+// ClockNow() and the UTC conversions only mask interrupts for a few loads and stores, so
+// they are safe to call from an ISR. ClockNow() must run at least every 71 minutes to see
+// the micros() wrap, yield() makes sure of that
+
+static uint32_t nmeaDelay = CLOCK_NMEA_DELAY_MS * 1000UL;   // In us
+static uint32_t lastLow = 0;             // micros() at the last ClockNow()
+static uint32_t high = 0;                // micros() wraps
+
+static bool anchored = false;
+static uint64_t anchorMono = 0;          // ClockNow() at the start of the UTC second
+static uint32_t anchorUtc = 0;           // Seconds since 1970-01-01
+static uint32_t lastUtc = 0;             // UTC of the last sentence seen
+static uint32_t anchors = 0;
+static uint32_t skipped = 0;             // Late parses not taken
+static int32_t lastResidual = 0;         // Arrival - prediction of the last anchor in us
+static uint32_t maxResidual = 0;
+
+// Monotonic microseconds since the start
+uint64_t ClockNow()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t low = micros();
+    if (low < lastLow)
+        high++;
+    lastLow = low;
+    uint64_t now = ((uint64_t) high << 32) | low;
+
+    __set_PRIMASK(primask);
+    return now;
+}
+
+// True once a GPS sentence anchored the clock to UTC
+bool ClockSynced()
+{
+    return anchored;
+}
+
+// UTC of a monotonic time, seconds since 1970-01-01 and microseconds. False if not anchored
+bool ClockToUtc(const uint64_t mono, uint32_t *seconds, uint32_t *us)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool ok = anchored;
+    uint64_t baseMono = anchorMono;
+    uint32_t baseUtc = anchorUtc;
+    __set_PRIMASK(primask);
+
+    if (!ok)
+        return false;
+
+    int64_t delta = (int64_t) (mono - baseMono);
+    if ((delta >= 0) && (delta < 0xFFFFFFFFLL))
+    {   // 32 bit divisions, the M0+ has no 64 bit divide
+        *seconds = baseUtc + (uint32_t) delta / 1000000UL;
+        *us = (uint32_t) delta % 1000000UL;
+    }
+    else
+    {
+        int64_t s = delta / 1000000LL;
+        int64_t r = delta % 1000000LL;
+        if (r < 0)
+        {
+            s--;
+            r += 1000000LL;
+        }
+        *seconds = baseUtc + (int32_t) s;
+        *us = (uint32_t) r;
+    }
+    return true;
+}
+
+// Monotonic time of the start of a UTC second. 0 if not anchored
+uint64_t ClockFromUtc(const uint32_t seconds)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint64_t mono = anchored ? anchorMono + (int64_t) (int32_t) (seconds - anchorUtc) * 1000000LL : 0;
+    __set_PRIMASK(primask);
+    return mono;
+}
+
+// Days from 1970-01-01 to a date of the Gregorian calendar
+uint32_t ClockDays(int y, const int m, const int d)
+{
+    y -= (m <= 2);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + ((m > 2) ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097UL + doe - 719468UL;
+}
+
+// Anchor to the GPS UTC. Call as soon as a sentence is parsed
+void ClockGps()
+{
+    struct gpsData gpsInfo;
+    uint64_t at = ClockNow() - nmeaDelay;
+
+    gpsNMEA.getFrameData(&gpsInfo);
+    if (!gpsInfo.valid || (gpsInfo.utcYear < 2000) || (gpsInfo.utcMonth < 1) || (gpsInfo.utcMonth > 12) || (gpsInfo.utcDay < 1))
+        return;
+
+    uint32_t utc = ClockDays(gpsInfo.utcYear, gpsInfo.utcMonth, gpsInfo.utcDay) * 86400UL +
+                   gpsInfo.utcHours * 3600UL + gpsInfo.utcMinutes * 60UL + gpsInfo.utcSeconds;
+    if (utc == lastUtc)
+        return;                          // Not the first sentence of the second
+    lastUtc = utc;
+
+    if (anchored)
+    {
+        int64_t residual = (int64_t) (at - ClockFromUtc(utc));
+        if ((residual > (int64_t) CLOCK_LATE_US) && ((int32_t) (utc - anchorUtc) < CLOCK_STALE_S))
+        {
+            skipped++;
+            return;
+        }
+        lastResidual = (int32_t) constrain(residual, -2000000000LL, 2000000000LL);
+        if ((uint32_t) abs(lastResidual) > maxResidual)
+            maxResidual = abs(lastResidual);
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    anchorMono = at;
+    anchorUtc = utc;
+    anchored = true;
+    __set_PRIMASK(primask);
+    anchors++;
+}
+
+// Time from the UTC second to the end of the receiver's first sentence in ms. A change
+// takes effect with the next anchor
+void ClockSetDelay(const uint32_t ms)
+{
+    nmeaDelay = min(ms, (uint32_t) CLOCK_NMEA_DELAY_MAX) * 1000UL;
+}
+
+void ClockDump()
+{
+    char buf[80], *p;
+    uint64_t now = ClockNow();
+    uint32_t seconds, us;
+
+    p = FmtStr(buf, "Monotonic                   : ");
+    p = FmtUint(p, (uint32_t) (now / 1000000ULL));
+    p = FmtUint(FmtStr(p, "."), (uint32_t) (now % 1000000ULL) / 1000, 3, '0');
+    FmtStr(p, " s");
+    SerialUSB.println(buf);
+    sprintf(buf, "NMEA delay                  : %lu ms", (unsigned long) (nmeaDelay / 1000UL));
+    SerialUSB.println(buf);
+
+    if (!ClockToUtc(now, &seconds, &us))
+    {
+        SerialUSB.println("UTC                         : not anchored to the GPS");
+        return;
+    }
+    uint32_t days = seconds / 86400UL, rest = seconds % 86400UL;
+    uint32_t z = days + 719468UL, era = z / 146097UL, doe = z - era * 146097UL;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100), mp = (5 * doy + 2) / 153;
+    int month = mp < 10 ? mp + 3 : mp - 9;
+
+    p = FmtStr(buf, "UTC                         : ");
+    p = FmtDate(p, yoe + era * 400 + (month <= 2), month, doy - (153 * mp + 2) / 5 + 1);
+    p = FmtTime(FmtStr(p, " "), rest / 3600, (rest / 60) % 60, rest % 60);
+    FmtUint(FmtStr(p, "."), us / 1000, 3, '0');
+    SerialUSB.println(buf);
+
+    sprintf(buf, "Anchors                     : %lu, %lu late sentences skipped, last %lu s ago", (unsigned long) anchors,
+            (unsigned long) skipped, (unsigned long) (seconds - anchorUtc));
+    SerialUSB.println(buf);
+    sprintf(buf, "Residual                    : %ld us, max %lu us", (long) lastResidual, (unsigned long) maxResidual);
+    SerialUSB.println(buf);
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,24 @@
+#ifndef _CLOCK_H
+#define _CLOCK_H
+
+// Arduino includes
+#include <Arduino.h>
+
+#define CLOCK_NMEA_DELAY_MS  150         // Default UTC second to the end of the first sentence, see clock.cpp
+#define CLOCK_NMEA_DELAY_MAX 999
+#define CLOCK_LATE_US        5000UL      // A first sentence this much later than predicted was parsed late
+#define CLOCK_STALE_S        60          // Accept any sentence once the anchor is this old
+
+// Function prototypes
+uint64_t ClockNow();
+bool ClockSynced();
+bool ClockToUtc(const uint64_t mono, uint32_t *seconds, uint32_t *us);
+uint64_t ClockFromUtc(const uint32_t seconds);
+uint32_t ClockDays(int y, const int m, const int d);
+void ClockGps();
+void ClockSetDelay(const uint32_t ms);
+void ClockDump();
+
+#endif // _CLOCK_H
+
+// ----------------- EOF -------------------------------------------------------------------
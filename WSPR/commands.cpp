@@ -2,24 +2,64 @@
 #include <RFzero.h>
 #include <RFzero_modes.h>
 #include <RFzero_util.h>
+#include <RTCZero.h>
 
 // Program includes. Located in the same directory as the .ino file
 #include "global.h"
 #include "config.h"
+#include "band.h"
+#include "boot.h"
+#include "calib.h"
+#include "clock.h"
 #include "commands.h"
+#include "fmt.h"
+#include "i2cbus.h"
+#include "journal.h"
+#include "message.h"
+#include "mode.h"
+#include "profiler.h"
+#include "profiles.h"
+#include "schedule.h"
+#include "selftest.h"
+#include "settings.h"
+#include "tasks.h"
+#include "telemetry.h"
+#include "txengine.h"
+#include "txframe.h"
+#include "wspr.h"
 
 uint8_t configMode = 0;                                          // Indicates if program is in config mode
 uint8_t configChanged = 0;                                       // Indicates if the configuration has changed
 
+extern RTCZero rtc;
+
+// True if a command line may run while a frame is sent. Only the reading commands may:
+// the EEPROM writes are applied by exit, which reloads the symbols and tone tables the TX
+// engine is sending, and the clear commands erase the calibration or stall the flash
+bool CommandTxSafe(const char *str)
+{
+    while (*str == ' ')
+        str++;
+
+    if (!configMode)
+        return true;                                             // config, help and ? only
+    if ((0 == strncmp("rd selftest", str, sizeof("rd selftest") - 1)) || (0 == strncmp("rd bench", str, sizeof("rd bench") - 1)))
+        return false;                                            // Seconds of CPU
+    return (0 == strncmp("rd ", str, sizeof("rd ") - 1)) || (0 == strncmp("help", str, sizeof("help") - 1)) ||
+           (0 == strncmp("?", str, sizeof("?") - 1));
+}
+
 void ParseCommand(char *str)
 {
     const uint8_t NONE = 5;
     uint8_t comStatus = NONE;
-    int value, value1;
+    int value;
     double freq;
     char buffreq[20];
     char buf[80];
 
+    PROF_SCOPE(PROF_COMMAND);
+
     TrimCharArray(str);
     if (strlen(str))
     {
@@ -62,257 +102,279 @@ void ParseCommand(char *str)
                 {
                     SerialUSB.println("Configuration changed, please wait");
                     LoadConfiguration();
+                    BootSaveConfig();
                     configChanged = 0;
                 }
             }
 
 
-            // HARDWARE ..........................................................
-            // wr frst FREQ
-            else if (0 == strncmp("wr frst ", str, sizeof("wr frst ") - 1))
+            // Settings, every wr command that only writes the EEPROM, see settings.cpp
+            else if ((0 == strncmp("wr ", str, sizeof("wr ") - 1)) &&
+                     (SETTING_UNKNOWN != (value = SettingApply(&str[sizeof("wr ") - 1], ConfigRead, ConfigWrite))))
             {
-                if (1 == sscanf(&str[sizeof("wr frst ") - 1], "%d", &value))
+                if (value == SETTING_NEEDS_T1)
                 {
-                    if ((26990000L <= value) && (value <= 27010000L))        // Accept only frequencies +/- 10 kHz from 27 MHz
-                    {
-                        eeprom.writeInteger(EEPROM_HW_RefStartFreq, value);
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 3;
+                    SerialUSB.println("CLK1 is part of the T1 output, set T1 to 2: none first");
+                    value = SETTING_BAD;
                 }
-                else
-                    comStatus = 2;
+                comStatus = value;
+                if (comStatus == SETTING_OK)
+                    configChanged = 1;
             }
 
 
-            // wr hw T1 LCD
-            else if (0 == strncmp("wr hw ", str, sizeof("wr hw ") - 1))
+            // rd bands
+            else if (0 == strncmp("rd bands", str, sizeof("rd bands") - 1))
             {
-                if (2 == sscanf(&str[sizeof("wr hw ") - 1], "%d %d", &value, &value1))
+                static const char* const hopName[HOP_MODES] = { "off", "rotate", "WSPR plan", "hourly" };
+
+                sprintf(buf, "Hopping: %d, %s", BandHopMode(), hopName[BandHopMode()]);
+                SerialUSB.println(buf);
+                for (int i = 0; i < BANDS_MAX; i++)
                 {
-                    if ((0 <= value) && (value <= 2) && (0 <= value1) && (value1 <= 4))  // T1 and LCD
-                    {
-                        eeprom.writeByte(EEPROM_HW_T1, value);
-                        eeprom.writeByte(EEPROM_HW_DisplayMode, value1);
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 2;
+                    doubleToString(BandFrequency(i), 0, buffreq);
+                    sprintf(buf, "  Band %2d: %10s Hz  %s  plan slot xx:%02d", i + 1, buffreq, BandEnabled(i) ? "on " : "off", 2 * i);
+                    SerialUSB.println(buf);
                 }
-                else
-                    comStatus = 2;
+                SerialUSB.print("Hourly band (0: beacon frequency):");
+                for (int h = 0; h < 24; h++)
+                {
+                    sprintf(buf, "%s%02d:%d", (h % 8) ? "  " : "\n  ", h, BandHourly(h));
+                    SerialUSB.print(buf);
+                }
+                SerialUSB.println();
+                comStatus = NONE;
+            }
+
+
+            // rd telem
+            else if (0 == strncmp("rd telem", str, sizeof("rd telem") - 1))
+            {
+                TelemetryDump();
+                comStatus = NONE;
             }
 
 
-            // wr warmup DURATION
-            else if (0 == strncmp("wr warmup ", str, sizeof("wr warmup ") - 1))
+            // rd slots N
+            else if (0 == strncmp("rd slots", str, sizeof("rd slots") - 1))
             {
-                if (1 == sscanf(&str[sizeof("wr warmup ") - 1], "%d", &value))
+                if (1 != sscanf(&str[sizeof("rd slots") - 1], "%d", &value))
+                    value = 10;
+                value = constrain(value, 1, SCHED_PLAN_MAX);
+
+                if (SchedPercent())
+                    sprintf(buf, "TX percentage %d, seed %lu", SchedPercent(), (unsigned long) SchedSeed());
+                else
+                    sprintf(buf, "TX every %d minutes", Interval);
+                SerialUSB.println(buf);
+                if (SchedOffsetMode() != OFFSET_OFF)
                 {
-                    if ((0 <= value) && (value <= 0xFF))
-                    {
-                        eeprom.writeByte(EEPROM_HW_WarmUp, value);
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 2;
+                    sprintf(buf, "Offset %s within %d Hz", (SchedOffsetMode() == OFFSET_RANDOM) ? "random" : "pattern", SchedOffsetWindow());
+                    SerialUSB.println(buf);
                 }
-                else
-                    comStatus = 2;
+                SerialUSB.print("Slot map per UTC hour, q: quiet:");
+                for (int h = 0; h < 24; h++)
+                {
+                    sprintf(buf, "%s%02d:%08lx%c", (h % 6) ? "  " : "\n  ", h, (unsigned long) SchedSlots(h),
+                            (SchedQuiet() & (1UL << h)) ? 'q' : ' ');
+                    SerialUSB.print(buf);
+                }
+                SerialUSB.println();
+                sprintf(buf, "Next %d slots from %02d:%02d UTC%s:", value, rtc.getHours(), rtc.getMinutes(), goodRTC ? "" : ", RTC not set");
+                SerialUSB.println(buf);
+                SchedPlan(rtc.getEpoch() / 60, value);
+                comStatus = NONE;
             }
 
 
-            // GPS PARAMETERS ..........................................................
-            // wr echo ONOFF
-            else if (0 == strncmp("wr echo ", str, sizeof("wr echo ") - 1))
+            // rd fref
+            else if (0 == strncmp("rd fref", str, sizeof("rd fref") - 1))
             {
-                if (1 == sscanf(&str[sizeof("wr echo ") - 1], "%d", &value))
+                double fref = freqCount.getReferenceFrequency() ;
+                SerialUSB.println(fref, 2);
+                comStatus = 99;
+            }
+
+
+            // rd msg
+            else if (0 == strncmp("rd msg", str, sizeof("rd msg") - 1))
+            {
+                const ModeDesc *mode = TxEngineMode();
+
+                sprintf(buf, "Mode %s, %d symbols of ", mode->name, mode->symbols);
+                SerialUSB.print(buf);
+                SerialUSB.print(mode->symbolPeriodUs / 1000.0, 1);
+                SerialUSB.print(" ms, tone spacing ");
+                SerialUSB.print(mode->spacing, 4);
+                sprintf(buf, " Hz, every %d min", mode->periodMinutes);
+                SerialUSB.println(buf);
+                for (int m = 0; m < MSG_COUNT; m++)
                 {
-                    if ((0 <= value) && (value <= 1))
+                    char msgCall[16], msgLocator[9];
+                    uint32_t msgFreq;
+                    int power;
+
+                    if (!MessageGet(m, msgCall, msgLocator, &power, &msgFreq))
+                        continue;
+                    if (m)
                     {
-                        eeprom.writeByte(EEPROM_GPS_Echo, value);
-                        comStatus = 1;
-                        configChanged = 1;
+                        if (msgFreq)
+                            sprintf(buf, "Message %d on %lu Hz", m, (unsigned long) msgFreq);
+                        else
+                            sprintf(buf, "Message %d on the slot frequency", m);
+                        SerialUSB.println(buf);
+                    }
+                    if (!TxEngineFrames(m))
+                        SerialUSB.println("Call, locator or power cannot be sent as WSPR");
+                    for (int i = 0; i < TxEngineFrames(m); i++)
+                    {
+                        switch (TxEngineType(i, m))
+                        {
+                            case WSPR_TYPE1: sprintf(buf, "Frame %d, type 1: %s %.4s %d", i + 1, msgCall, msgLocator, power); break;
+                            case WSPR_TYPE2: sprintf(buf, "Frame %d, type 2: %s %d", i + 1, msgCall, power); break;
+                            default:         sprintf(buf, "Frame %d, type 3: <%s> %.6s %d", i + 1, msgCall, msgLocator, power); break;
+                        }
+                        if (i == TxEngineNext(m))
+                            strcat(buf, "   (next)");
+                        SerialUSB.println(buf);
                     }
-                    else
-                        comStatus = 2;
                 }
-                else
-                    comStatus = 2;
+                uint8_t pattern[MSG_PATTERN_MAX];
+                value = MessagePattern(pattern);
+                strcpy(buf, "Message pattern: ");
+                if (!value)
+                    strcat(buf, "every message in turn");
+                for (int i = 0; i < value; i++)
+                    sprintf(&buf[strlen(buf)], "%d", pattern[i]);
+                SerialUSB.println(buf);
+                if (TxEngineDual())
+                {
+                    doubleToString(dualFrequency, 0, buffreq);
+                    sprintf(buf, "CLK1: every frame on %s Hz, power %d dBm", buffreq, dualPower);
+                    SerialUSB.println(buf);
+                }
+                if (qrssEvery)
+                {
+                    static const char* const styleName[QRSS_STYLES] = { "none", "QRSS", "FSKCW", "DFCW" };
+                    sprintf(buf, "%s: %s, %d s dot, %lu s long, every %d slot(s)", styleName[qrssStyle], call, qrssDot,
+                            (unsigned long) TxEngineQrssLength(), qrssEvery);
+                    SerialUSB.println(buf);
+                }
+                comStatus = NONE;
             }
 
 
-            // BEACON PARAMETERS ..........................................................
-            // wr defaults
-            else if (0 == strncmp("wr defaults", str, sizeof("wr defaults") - 1))
+            // rd prof
+            else if (0 == strncmp("rd prof", str, sizeof("rd prof") - 1))
             {
-                // HARDWARE
-                eeprom.writeInteger(EEPROM_HW_RefStartFreq, 27000000L);
-                eeprom.writeByte(EEPROM_HW_T1, 0);
-                eeprom.writeByte(EEPROM_HW_DisplayMode, 1);
-                eeprom.writeByte(EEPROM_HW_WarmUp, 0);
+                ProfDump();
+                comStatus = NONE;
+            }
 
-                // GPS
-                eeprom.writeByte(EEPROM_GPS_Echo, 0);
 
-                // BEACON
-                eeprom.writeByte(EEPROM_BEACON_CalibInterval, 5);
-                eeprom.writeByte(EEPROM_BEACON_Interval, 2);
+#if FEATURE_SELFTEST
+            // rd selftest
+            else if (0 == strncmp("rd selftest", str, sizeof("rd selftest") - 1))
+            {
+                SelfTest(freqCount.getReferenceFrequency());
+                comStatus = NONE;
+            }
+
+
+            // rd bench
+            else if (0 == strncmp("rd bench", str, sizeof("rd bench") - 1))
+            {
+                FmtBench();
+                comStatus = NONE;
+            }
+#endif
 
-                // WSPR
-                eeprom.writeByte(EEPROM_BEACON_WSPRPower, 13);
 
+            // wr prof reset
+            else if (0 == strncmp("wr prof reset", str, sizeof("wr prof reset") - 1))
+            {
+                ProfReset();
                 comStatus = 1;
-                configChanged = 1;
             }
 
 
-            // wr freq FREQ
-            else if (0 == strncmp("wr freq ", str, sizeof("wr freq ") - 1))
+            // rd boot
+            else if (0 == strncmp("rd boot", str, sizeof("rd boot") - 1))
             {
-                if (1 == sscanf(&str[sizeof("wr freq ") - 1], "%s", buf))
-                {
-                    double fr = strtod(buf, NULL);
-                    if (100000.0 <= fr)                                  // Accept only frequencies from 100 kHz and up
-                    {
-                        eeprom.writeDouble(EEPROM_BEACON_Frequency, fr);
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 3;
-                }
-                else
-                    comStatus = 2;
+                BootDump();
+                comStatus = NONE;
             }
 
 
-            // wr cal INTERVAL
-            else if (0 == strncmp("wr cal ", str, sizeof("wr cal ") - 1))
+            // rd calib
+            else if (0 == strncmp("rd calib", str, sizeof("rd calib") - 1))
             {
-                if (1 == sscanf(&str[sizeof("wr cal ") - 1], "%d", &value))
-                {
-                    if ((1 <= value) && (value <= 0xFF))
-                    {
-                        eeprom.writeByte(EEPROM_BEACON_CalibInterval, value);
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 2;
-                }
-                else
-                    comStatus = 2;
+                CalibDump();
+                comStatus = NONE;
             }
 
-            // wr txdly INTERVAL_MINUTES
-            else if (0 == strncmp("wr txdly ", str, sizeof("wr txdly ") - 1))
+
+            // wr calib clear
+            else if (0 == strncmp("wr calib clear", str, sizeof("wr calib clear") - 1))
             {
-                if (1 == sscanf(&str[sizeof("wr txdly ") - 1], "%d", &value))
-                {
-                    if ((1 <= value) && (value <= 0xFF))
-                    {
-                        eeprom.writeByte(EEPROM_BEACON_Interval, value);
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 2;
-                }
-                else
-                    comStatus = 2;
+                CalibClear();
+                comStatus = 1;
             }
 
 
-            // wr bcn CALL
-            else if (0 == strncmp("wr bcn ", str, sizeof("wr bcn ") - 1))
+            // rd journal bin   or   rd journal
+            else if (0 == strncmp("rd journal", str, sizeof("rd journal") - 1))
             {
-                if (1 == sscanf(&str[sizeof("wr bcn ") - 1], "%s", buf))
-                {
-                    if (strlen(buf) < 16)
-                    {
-                        for (uint32_t i = 0; i < 16; i++)
-                        {
-                            if (i < strlen(buf))
-                            {
-                                eeprom.writeByte(EEPROM_BEACON_Call + i, toupper(buf[i]));
-                            }
-                            else
-                            {
-                                eeprom.writeByte(EEPROM_BEACON_Call + i, 0);            // Fill the remainder with null
-                            }
-                        }
-                        eeprom.writeByte(EEPROM_BEACON_Call + 15, 0);            // Hard stop sz
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 2;
-                }
-                else
-                    comStatus = 2;
+                JournalExport(0 == strncmp("rd journal bin", str, sizeof("rd journal bin") - 1));
+                comStatus = NONE;
             }
 
 
-            // wr loc LOCATOR
-            else if (0 == strncmp("wr loc ", str, sizeof("wr loc ") - 1))
+            // wr journal clear
+            else if (0 == strncmp("wr journal clear", str, sizeof("wr journal clear") - 1))
             {
-                if (1 == sscanf(&str[sizeof("wr loc ") - 1], "%s", buf))
-                {
-                    if (strlen(buf) < 9)
-                    {
-                        for (uint32_t i = 0; i < 9; i++)
-                        {
-                            if (i < strlen(buf))
-                            {
-                                eeprom.writeByte(EEPROM_COMMON_Locator + i, toupper(buf[i]));
-                            }
-                            else
-                            {
-                                eeprom.writeByte(EEPROM_COMMON_Locator + i, 0);    // Fill the remainder with null
-                            }
-                        }
-                        eeprom.writeByte(EEPROM_COMMON_Locator + 8, 0);            // Hard stop sz
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 2;
-                }
-                else
-                    comStatus = 2;
+                JournalClear();
+                comStatus = 1;
             }
 
-            // WSPR
-            // wr pwr POWER
-            else if (0 == strncmp("wr pwr ", str, sizeof("wr pwr ") - 1))
+
+            // rd i2c
+            else if (0 == strncmp("rd i2c", str, sizeof("rd i2c") - 1))
             {
-                if (1 == sscanf(&str[sizeof("wr pwr ") - 1], "%d", &value))
-                {
-                    if ((value >= 0) && (value <= 60) && ((value % 10 == 0) || ((value - 3) % 10 == 0) || ((value - 7) % 10 == 0)))
-                    {
-                        eeprom.writeByte(EEPROM_BEACON_WSPRPower, value);
-                        comStatus = 1;
-                        configChanged = 1;
-                    }
-                    else
-                        comStatus = 2;
-                }
-                else
-                    comStatus = 2;
+                I2cBusDump();
+                comStatus = NONE;
             }
 
 
-            // rd fref
-            else if (0 == strncmp("rd fref", str, sizeof("rd fref") - 1))
+            // wr i2c reset
+            else if (0 == strncmp("wr i2c reset", str, sizeof("wr i2c reset") - 1))
             {
-                double fref = freqCount.getReferenceFrequency() ;
-                SerialUSB.println(fref, 2);
-                comStatus = 99;
+                I2cBusReset();
+                comStatus = 1;
+            }
+
+
+            // rd clock
+            else if (0 == strncmp("rd clock", str, sizeof("rd clock") - 1))
+            {
+                ClockDump();
+                comStatus = NONE;
+            }
+
+
+            // rd tasks
+            else if (0 == strncmp("rd tasks", str, sizeof("rd tasks") - 1))
+            {
+                TaskDump();
+                comStatus = NONE;
+            }
+
+
+            // wr tasks reset
+            else if (0 == strncmp("wr tasks reset", str, sizeof("wr tasks reset") - 1))
+            {
+                TaskReset();
+                comStatus = 1;
             }
 
 
@@ -338,10 +400,12 @@ void ParseCommand(char *str)
                 // GPS
                 sprintf(buf, "\nEcho GPS data to USB port: 0: no*, 1: yes       : %d", eeprom.readByte(EEPROM_GPS_Echo, 0));
                 SerialUSB.println(buf);
+                sprintf(buf, "NMEA delay 0 to 999 ms, 150*                    : %ld", (long) eeprom.readInteger(EEPROM_GPS_Delay, CLOCK_NMEA_DELAY_MS));
+                SerialUSB.println(buf);
 
                 // BEACON
                 freq = eeprom.readDouble(EEPROM_BEACON_Frequency, 0.0);
-                doubleToString(freq, 0, buffreq);
+                FmtUint(buffreq, (uint32_t) lround(freq));
                 sprintf(buf, "\nNominal beacon frequency in Hz                  : %s", buffreq);
                 SerialUSB.println(buf);
                 sprintf(buf, "TX interval (minutes) 2 to 59, 4*               : %d", eeprom.readByte(EEPROM_BEACON_Interval, 4));
@@ -362,6 +426,106 @@ void ParseCommand(char *str)
                 sprintf(buf, "Power level in dBm: 0, 3, 7, 10, 13*, 17 ... 60 : %d", eeprom.readByte(EEPROM_BEACON_WSPRPower, 13));
                 SerialUSB.println(buf);
 
+                sprintf(buf, "Mode: 0: WSPR-2*, 1: WSPR-15                    : %d", eeprom.readByte(EEPROM_BEACON_Mode, MODE_WSPR2));
+                SerialUSB.println(buf);
+
+                // BAND HOPPING
+                sprintf(buf, "\nHopping: 0: off*, 1: rotate, 2: plan, 3: hourly : %d", eeprom.readByte(EEPROM_BAND_HopMode, HOP_OFF));
+                SerialUSB.println(buf);
+
+                // SLOT CALENDAR
+                sprintf(buf, "\nTX percentage: 0: every TX interval*, 1 to 100  : %d", eeprom.readByte(EEPROM_SCHED_Percent, 0));
+                SerialUSB.println(buf);
+                sprintf(buf, "Quiet UTC hours, bit per hour, 0*               : %06lx", (unsigned long) eeprom.readInteger(EEPROM_SCHED_Quiet, 0));
+                SerialUSB.println(buf);
+                sprintf(buf, "Slot offset: 0: off*, 1: random, 2: pattern     : %d", eeprom.readByte(EEPROM_OFFSET_Mode, OFFSET_OFF));
+                SerialUSB.println(buf);
+                sprintf(buf, "Slot offset window 10 to 200 Hz, 180*           : %d", eeprom.readByte(EEPROM_OFFSET_Window, 180));
+                SerialUSB.println(buf);
+                SerialUSB.print("Slot offset pattern in Hz                       :");
+                value = eeprom.readByte(EEPROM_OFFSET_Count, 0);
+                for (int i = 0; (i < value) && (i < OFFSET_PATTERN_MAX); i++)
+                {
+                    sprintf(buf, " %d", (int8_t) eeprom.readByte(EEPROM_OFFSET_Pattern + i, 0));
+                    SerialUSB.print(buf);
+                }
+                SerialUSB.println();
+
+                // OUTPUTS
+                sprintf(buf, "\nCLK0 drive: 0: 2, 1: 4, 2: 6, 3: 8 mA*          : %d", eeprom.readByte(EEPROM_OUT_Drive0, SI5351_DRIVE_8MA));
+                SerialUSB.println(buf);
+                sprintf(buf, "CLK1 drive: 0: 2, 1: 4, 2: 6, 3: 8 mA*          : %d", eeprom.readByte(EEPROM_OUT_Drive1, SI5351_DRIVE_8MA));
+                SerialUSB.println(buf);
+                sprintf(buf, "CLK1 second band: 0: off*, 1: on (T1 none only) : %d", eeprom.readByte(EEPROM_OUT_Enable1, 0));
+                SerialUSB.println(buf);
+                FmtUint(buffreq, eeprom.readInteger(EEPROM_OUT_Frequency1, 14097100L));
+                sprintf(buf, "CLK1 nominal frequency in Hz, 14097100*         : %s", buffreq);
+                SerialUSB.println(buf);
+                sprintf(buf, "CLK1 power level in dBm, 13*                    : %d", eeprom.readByte(EEPROM_OUT_Power1, 13));
+                SerialUSB.println(buf);
+
+                // PA SEQUENCER
+                sprintf(buf, "\nPA on before the RF 0 to 2550 ms, 50*           : %d", eeprom.readByte(EEPROM_PA_Lead, 5) * 10);
+                SerialUSB.println(buf);
+                sprintf(buf, "RF ramp up and down 0* to 255 ms                : %d", eeprom.readByte(EEPROM_PA_Ramp, 0));
+                SerialUSB.println(buf);
+                sprintf(buf, "PA on after the RF 0 to 2550 ms, 50*            : %d", eeprom.readByte(EEPROM_PA_Hold, 5) * 10);
+                SerialUSB.println(buf);
+
+                // QRSS
+                sprintf(buf, "\nQRSS: 0: off*, 1: QRSS, 2: FSKCW, 3: DFCW       : %d", eeprom.readByte(EEPROM_QRSS_Style, QRSS_NONE));
+                SerialUSB.println(buf);
+                sprintf(buf, "QRSS dot length 1 to 120 s, 3*                  : %d", eeprom.readByte(EEPROM_QRSS_Dot, 3));
+                SerialUSB.println(buf);
+                sprintf(buf, "QRSS FSK shift in 0.1 Hz, 50*                   : %d", eeprom.readByte(EEPROM_QRSS_Shift, 50));
+                SerialUSB.println(buf);
+                FmtUint(buffreq, eeprom.readInteger(EEPROM_QRSS_Frequency, 10140050L));
+                sprintf(buf, "QRSS frequency in Hz, 10140050*                 : %s", buffreq);
+                SerialUSB.println(buf);
+                sprintf(buf, "QRSS every N'th slot, 0: never*                 : %d", eeprom.readByte(EEPROM_QRSS_Every, 0));
+                SerialUSB.println(buf);
+
+                // TELEMETRY
+                value = (eeprom.readByte(EEPROM_TELEM_Channel + 1, 0xFF) << 8) | eeprom.readByte(EEPROM_TELEM_Channel, 0xFF);
+                if (value >= TELEM_CHANNELS)
+                    sprintf(buf, "\nTelemetry U4B channel 0 to 599, off*            : off");
+                else
+                    sprintf(buf, "\nTelemetry U4B channel 0 to 599, off*            : %d", value);
+                SerialUSB.println(buf);
+                value = eeprom.readByte(EEPROM_TELEM_VoltPin, 0xFF);
+                sprintf(buf, "Supply voltage analog input, -1: none*          : %d", (value == 0xFF) ? -1 : value);
+                SerialUSB.println(buf);
+                sprintf(buf, "Supply voltage divider ratio, 1.0*              : %d.%d", eeprom.readByte(EEPROM_TELEM_VoltScale, 10) / 10,
+                        eeprom.readByte(EEPROM_TELEM_VoltScale, 10) % 10);
+                SerialUSB.println(buf);
+
+                // MESSAGE TABLE
+                for (int i = 0; i < MSG_MAX; i++)
+                {
+                    int address = EEPROM_MSG_Table + i * MSG_ENTRY_SIZE;
+                    char msgCall[16], msgLocator[9];
+
+                    for (int k = 0; k < 16; k++)
+                        msgCall[k] = eeprom.readByte(address + k, 0);
+                    for (int k = 0; k < 9; k++)
+                        msgLocator[k] = eeprom.readByte(address + 16 + k, 0);
+                    msgCall[15] = msgLocator[8] = 0;
+                    if (!msgCall[0] || ((uint8_t) msgCall[0] == 0xFF))
+                        sprintf(buf, "%sMessage %d call locator power freq, off*         : off", i ? "" : "\n", i + 1);
+                    else
+                        sprintf(buf, "%sMessage %d call locator power freq, off*         : %s %s %d %lu", i ? "" : "\n", i + 1, msgCall,
+                                ((uint8_t) msgLocator[0] == 0xFF) || !msgLocator[0] ? "*" : msgLocator, eeprom.readByte(address + 25, 0),
+                                (unsigned long) eeprom.readInteger(address + 26, 0));
+                    SerialUSB.println(buf);
+                }
+                value = eeprom.readByte(EEPROM_MSG_PatternCount, 0);
+                strcpy(buf, "Message pattern, every message in turn*         : ");
+                if (!value || (value > MSG_PATTERN_MAX))
+                    strcat(buf, "off");
+                for (int i = 0; (value <= MSG_PATTERN_MAX) && (i < value); i++)
+                    sprintf(&buf[strlen(buf)], "%d", eeprom.readByte(EEPROM_MSG_Pattern + i, 0));
+                SerialUSB.println(buf);
+
                 SerialUSB.println("\n*: default value\n");
 
                 comStatus = NONE;
@@ -372,22 +536,61 @@ void ParseCommand(char *str)
             {
                 PrintLibPrgVer(1);
 
+#if FEATURE_HELP
                 SerialUSB.println("Available MMI commands. Type   exit   to return to run mode\n");
 
                 SerialUSB.println("Configuration");
                 SerialUSB.println("=============");
                 SerialUSB.println("  wr bcn CALL                to set the CALL, max six/ten characters");
-                SerialUSB.println("  wr loc LOCATOR             to set the LOCATOR, max six characters");
-                SerialUSB.println("  wr pwr POWER               to set the power level in dBm, 0, 3, 7, 10, 13, 17, 20, 23, 27 30 ... 60\n");
+                SerialUSB.println("  wr loc LOCATOR             to set the LOCATOR, max six characters, six adds a type 3 frame");
+                SerialUSB.println("  wr pwr POWER               to set the power level in dBm, 0, 3, 7, 10, 13, 17, 20, 23, 27 30 ... 60");
+                SerialUSB.println("  wr mode MODE               to set the mode, 0: WSPR-2, 1: WSPR-15\n");
 
                 SerialUSB.println("  wr freq FREQ               to set the beacon nominal frequency in Hz from 100 kHz and up\n");
 
-                SerialUSB.println("  wr txdly MINUTES           to set delay between of transmissions, 2 - 59");
+                SerialUSB.println("  wr txdly MINUTES           to set delay between of transmissions, 2 - 59\n");
+
+                SerialUSB.println("  wr hop MODE                to set band hopping, 0: off, 1: rotate bands, 2: WSPR hopping plan, 3: band per UTC hour");
+                SerialUSB.println("  wr band BAND FREQ          to enable band 1 - 10 (160 m - 10 m) on the FREQ in Hz, FREQ 0 disables the band");
+                SerialUSB.println("  wr hour HOUR BAND          to use BAND 1 - 10 in the UTC HOUR 0 - 23 when hopping per hour, 0: beacon frequency");
+                SerialUSB.println("  rd bands                   to list the band table and hopping schedule\n");
+
+                SerialUSB.println("  wr slots HOUR MASK         to allow TX in the UTC HOUR 0 - 23, 24: all hours, in the slots set in the hex MASK");
+                SerialUSB.println("                             bit n: the n'th slot, minute 2n or 15n in WSPR-15, 3fffffff: every slot");
+                SerialUSB.println("  wr quiet FROM TO           to not transmit from the UTC hour FROM up to TO, FROM = TO: no quiet hours");
+                SerialUSB.println("  wr txpct PERCENT SEED      to transmit in PERCENT of the slots at random, 0: every TX interval");
+                SerialUSB.println("  wr offset MODE WINDOW      to move each frame within WINDOW Hz around its frequency, 0: off, 1: random, 2: pattern");
+                SerialUSB.println("  wr pattern HZ HZ ...       to set up to 8 offsets in Hz, one per used slot in turn, for offset MODE 2");
+                SerialUSB.println("  rd slots N                 to show the slot calendar and the next N planned slots and offsets\n");
+
+                SerialUSB.println("  wr dual FREQ POWER         to also send every WSPR frame on CLK1 on FREQ in Hz with POWER in dBm, FREQ 0: off");
+                SerialUSB.println("                             CLK1 is free only without T1, see wr hw");
+                SerialUSB.println("  wr drive CLK0 CLK1         to set the output drive strength, 0: 2 mA, 1: 4 mA, 2: 6 mA, 3: 8 mA\n");
+
+                SerialUSB.println("  wr pa LEAD RAMP HOLD       to set the PA on LEAD ms before the RF, the RF RAMP in ms (0 - 255) and the");
+                SerialUSB.println("                             PA HOLD ms after the RF, LEAD and HOLD 0 - 2550 in 10 ms steps\n");
+
+                SerialUSB.println("  wr qrss STYLE DOT SHIFT    to set the slow CW style, 0: off, 1: QRSS, 2: FSKCW, 3: DFCW, DOT 1 - 120 s, SHIFT in Hz");
+                SerialUSB.println("                             no WSPR is sent while a frame lasts, with long dots that is hours");
+                SerialUSB.println("  wr qrssfreq FREQ           to set the QRSS frequency in Hz, the FSK shift is added above it");
+                SerialUSB.println("  wr qrssslot N              to send the call in QRSS instead of WSPR in every N'th slot, 0: never\n");
+
+                SerialUSB.println("  wr telem CHANNEL           to follow every WSPR frame with a balloon telemetry frame on U4B CHANNEL 0 - 599,");
+                SerialUSB.println("                             off: no telemetry. The channel sets the TX minute and frequency lane and the");
+                SerialUSB.println("                             WSPR frames then take the locator from the GPS. WSPR-2 only");
+                SerialUSB.println("  wr telemv PIN RATIO        to measure the supply voltage on analog input A0 - A5 behind a RATIO divider, -1: none");
+                SerialUSB.println("                             A0 - A2 are taken by the rotary encoder in builds with the LCD");
+                SerialUSB.println("  rd telem                   to show the GPS fix and the last telemetry frame\n");
+
+                SerialUSB.println("  wr msg N CALL LOC POWER F  to send message 1 - 4 in rotation with the beacon message, LOC *: the beacon");
+                SerialUSB.println("                             locator, F in Hz optional, 0: the slot frequency. off: message N not in use");
+                SerialUSB.println("  wr msgpat DIGITS           to send the messages in the order of up to 8 DIGITS 0 - 4, off: every message in turn\n");
 
                 SerialUSB.println("  wr cal INTERVAL            to set the number of sequences before calibrating the frequencies, 1 - 255");
                 SerialUSB.println("  wr warmup SECONDS          to set the number of seconds to warm up the H/W before transmitting, 0 - 255\n");
 
-                SerialUSB.println("  wr echo on/off             to turn on/off GPS data echo on the USB on/off: 0: off, 1: on\n");
+                SerialUSB.println("  wr echo on/off             to turn on/off GPS data echo on the USB on/off: 0: off, 1: on");
+                SerialUSB.println("  wr gpsdelay MS             to set the time from the UTC second to the end of the first NMEA sentence, 0 - 999\n");
 
                 SerialUSB.println("  wr defaults                to set the H/W and S/W defaults");
                 SerialUSB.println("  wr hw T1 LCD               to set the H/W where:");
@@ -395,7 +598,26 @@ void ParseCommand(char *str)
                 SerialUSB.println("                                LCD : 0: none          1: 20x4");
                 SerialUSB.println("  wr frst FREQ               to write the Si5351A start reference frequency to the EEPROM\n");
 
-                SerialUSB.println("  rd cfg                     to list the current configuration\n");
+                SerialUSB.println("  rd cfg                     to list the current configuration");
+                SerialUSB.println("  rd msg                     to show the WSPR frames and messages sent in rotation, type 1, 2 and 3");
+                SerialUSB.println("  rd prof                    to show the hot path profiler call counts, timing and histograms");
+                SerialUSB.println("  wr prof reset              to clear the profiler statistics");
+                SerialUSB.println("  rd boot                    to show the reset cause, boot path and time to the first TX");
+                SerialUSB.println("  rd calib                   to show the reference history, aging and temperature model");
+                SerialUSB.println("  wr calib clear             to erase the reference history");
+                SerialUSB.println("  rd journal                 to list the TX journal as CSV, oldest first");
+                SerialUSB.println("  rd journal bin             to send the TX journal as binary records");
+                SerialUSB.println("  wr journal clear           to erase the TX journal");
+                SerialUSB.println("  rd i2c                     to show the I2C bus grants, waits and hold times per client");
+                SerialUSB.println("  wr i2c reset               to clear the I2C bus statistics");
+                SerialUSB.println("  rd clock                   to show the GPS anchored time base, UTC to the millisecond and its jitter");
+                SerialUSB.println("  rd tasks                   to show the foreground task runtimes, overruns and deferrals");
+                SerialUSB.println("  wr tasks reset             to clear the task statistics");
+                SerialUSB.println("  rd selftest                to check WSPR encoding and tone calculation against golden vectors");
+                SerialUSB.println("  rd bench                   to time the display formatting against sprintf and float printing\n");
+#else
+                SerialUSB.println("The command list is not in this build, see the README\n");
+#endif
 
                 comStatus = NONE;
             }
@@ -6,6 +6,7 @@ extern uint8_t configMode;                                 // Indicates if progr
 extern uint8_t configChanged;                              // Indicates if the configuration has changed
 
 void ParseCommand(char *str);
+bool CommandTxSafe(const char *str);
 
 #endif  // _COMMANDS_H
 
@@ -1,14 +1,37 @@
 // Program includes. Located in the same directory as the .ino file
 #include "global.h"
 #include "config.h"
+#include "band.h"
+#include "clock.h"
+#include "message.h"
+#include "mode.h"
+#include "profiler.h"
+#include "schedule.h"
+#include "settings.h"
+#include "telemetry.h"
+#include "txengine.h"
+#include "txframe.h"
+#include "wspr.h"
 
 #include <RFzero_modes.h>
 
+static_assert(SETTING_DRIVE_MAX == SI5351_DRIVE_8MA, "wr drive range is not the one of the RFzero library");
+
+// The EEPROM as the settings see it, see settings.cpp
+uint8_t ConfigRead(const uint16_t address)
+{
+    return eeprom.readByte(address, 0xFF);
+}
+
+void ConfigWrite(const uint16_t address, const uint8_t value)
+{
+    eeprom.writeByte(address, value);
+}
+
 void LoadConfiguration()
 {
     // EXISTING VALUES
     int oldCalibInterval = calibInterval;
-    double oldFrequency = frequency;
     int oldInterval = Interval;
 
     // HARDWARE
@@ -20,6 +43,7 @@ void LoadConfiguration()
 
     // GPS
     gpsEcho = eeprom.readByte(EEPROM_GPS_Echo, 0);
+    ClockSetDelay(eeprom.readInteger(EEPROM_GPS_Delay, CLOCK_NMEA_DELAY_MS));
 
 
     // COMMON
@@ -51,20 +75,58 @@ void LoadConfiguration()
 
     // WSPR
     wsprPower = eeprom.readByte(EEPROM_BEACON_WSPRPower, 13);
-    if ((wsprPower < 0) || (wsprPower > 60) || ((wsprPower % 10 != 0) && ((wsprPower - 3) % 10 != 0) && ((wsprPower - 7) % 10 != 0)))
+    if (!WsprValidPower(wsprPower))
     {
         wsprPower = 13;                                     // Wrong power level so set it to 13 dBm
         eeprom.writeByte(EEPROM_BEACON_WSPRPower, 13);
     }
 
-    Modes.setupWSPR(call, locator, wsprPower);
+    wsprMode = eeprom.readByte(EEPROM_BEACON_Mode, MODE_WSPR2);
+    if (!ModeGet(wsprMode))
+        wsprMode = MODE_WSPR2;                              // Unknown mode
 
-    // Recalc regs if frequency changed
-    if (oldFrequency != frequency)
+    TxEngineLoad(wsprMode, call, locator, wsprPower);       // Type 1, 2 and 3 frames as the call and locator allow
+    MessageLoad();                                          // The message table in the same mode
+
+    // QRSS
+    qrssStyle = eeprom.readByte(EEPROM_QRSS_Style, QRSS_NONE);
+    qrssDot = eeprom.readByte(EEPROM_QRSS_Dot, 3);
+    qrssShift = eeprom.readByte(EEPROM_QRSS_Shift, 50);
+    qrssEvery = eeprom.readByte(EEPROM_QRSS_Every, 0);
+    qrssFrequency = eeprom.readInteger(EEPROM_QRSS_Frequency, 10140050L);
+    if ((qrssStyle >= QRSS_STYLES) || (qrssDot < 1) || (qrssDot > 120) || (qrssShift < 1) ||
+        (qrssFrequency < 100000.0) || (qrssFrequency > 298765432.0) || !TxEngineLoadQrss(qrssStyle, call, qrssDot * 1000UL))
+        qrssEvery = 0;                                     // Never send a QRSS frame that cannot be made
+
+    // OUTPUTS. CLK1 is part of the RF output with the T1 transformer or combiner, so it can
+    // only carry a second band when T1 is not fitted
+    uint8_t drive0 = eeprom.readByte(EEPROM_OUT_Drive0, SI5351_DRIVE_8MA);
+    uint8_t drive1 = eeprom.readByte(EEPROM_OUT_Drive1, SI5351_DRIVE_8MA);
+    TxEngineDrive(drive0 & 0x03, drive1 & 0x03);
+    dualEnable = eeprom.readByte(EEPROM_OUT_Enable1, 0);
+    dualPower = eeprom.readByte(EEPROM_OUT_Power1, 13);
+    dualFrequency = eeprom.readInteger(EEPROM_OUT_Frequency1, 14097100L);
+    if ((dualEnable != 1) || (t1Hardware != 2) || !WsprValidPower(dualPower) ||
+        (dualFrequency < 100000.0) || (dualFrequency > 298765432.0) || !TxEngineLoadDual(true, call, locator, dualPower))
     {
-        Modes.calculateTones(frequency) ;
-        Modes.setCWCarrierTone(true) ;   // will recenter PLL
+        dualEnable = 0;
+        TxEngineLoadDual(false, call, locator, dualPower);
     }
+
+    // PA SEQUENCER
+    paLead = eeprom.readByte(EEPROM_PA_Lead, 5) * 10;
+    paRamp = eeprom.readByte(EEPROM_PA_Ramp, 0);
+    paHold = eeprom.readByte(EEPROM_PA_Hold, 5) * 10;
+    TxEngineSequence(paLead, paRamp, paHold);
+
+    // SLOT CALENDAR
+    SchedLoad();
+
+    // TELEMETRY. The regular frames keep the configured locator until the next GPS fix
+    TelemetryLoad();
+
+    // BAND HOPPING. Recalc regs of the beacon frequency and every enabled band if changed
+    PROF_CALL(PROF_TONES, BandLoad());   // The TX engine loads and resets the PLL itself at the start of each frame
 }
 
 // ----------------- EOF -------------------------------------------------------------------
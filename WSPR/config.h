@@ -30,8 +30,69 @@
 // INTERVAL
 #define EEPROM_BEACON_Interval       195  // 1 byte
 
+// BAND HOPPING
+#define EEPROM_BAND_HopMode          196  // 1 byte
+#define EEPROM_BAND_Enable           197  // 2 bytes, bit n: band n enabled
+#define EEPROM_BAND_Freq             200  // 10 x 4 bytes, centre frequency in Hz
+#define EEPROM_BAND_Hour             240  // 12 bytes, band + 1 per UTC hour, 4 bits each, even hours in the low nibble
+
+// MODE
+#define EEPROM_BEACON_Mode           252  // 1 byte, MODE_WSPR2 etc.
+
+// QRSS (second 256 byte block of the 24LC08B)
+#define EEPROM_QRSS_Style            256  // 1 byte, QRSS_NONE etc.
+#define EEPROM_QRSS_Dot              257  // 1 byte, dot length in s
+#define EEPROM_QRSS_Shift            258  // 1 byte, FSK shift in 0.1 Hz
+#define EEPROM_QRSS_Every            259  // 1 byte, 0: never, N: every N'th slot
+#define EEPROM_QRSS_Frequency        260  // 4 bytes, tone 0 frequency in Hz
+
+// OUTPUTS
+#define EEPROM_OUT_Drive0            264  // 1 byte, CLK0 drive strength, SI5351_DRIVE_2MA etc.
+#define EEPROM_OUT_Drive1            265  // 1 byte, CLK1 drive strength
+#define EEPROM_OUT_Enable1           266  // 1 byte, 1: CLK1 sends every WSPR frame too
+#define EEPROM_OUT_Power1            267  // 1 byte, CLK1 power level in dBm
+#define EEPROM_OUT_Frequency1        268  // 4 bytes, CLK1 nominal frequency in Hz
+
+// PA SEQUENCER
+#define EEPROM_PA_Lead               272  // 1 byte, PA on before the RF in 10 ms
+#define EEPROM_PA_Ramp               273  // 1 byte, RF ramp in ms
+#define EEPROM_PA_Hold               274  // 1 byte, PA on after the RF in 10 ms
+
+// BOOT
+#define EEPROM_BOOT_Signature        275  // 2 bytes, CRC-16 of the running configuration
+
+// REFERENCE CALIBRATION
+#define EEPROM_CALIB_Ring            280  // 32 x 12 bytes, measured reference history, see calib.cpp
+
+// SLOT CALENDAR
+#define EEPROM_SCHED_Slots           664  // 24 x 4 bytes, bit n: TX allowed in the n'th slot of the UTC hour
+#define EEPROM_SCHED_Quiet           760  // 4 bytes, bit h: no TX in UTC hour h
+#define EEPROM_SCHED_Percent         764  // 1 byte, 0: every TX interval, 1 - 100: random TX percentage
+#define EEPROM_SCHED_Seed            765  // 4 bytes, random TX percentage seed
+
+// SLOT OFFSET
+#define EEPROM_OFFSET_Mode           769  // 1 byte, OFFSET_OFF etc.
+#define EEPROM_OFFSET_Window         770  // 1 byte, window width in Hz around the table frequency
+#define EEPROM_OFFSET_Count          771  // 1 byte, entries in the pattern
+#define EEPROM_OFFSET_Pattern        772  // 8 x 1 byte, signed offsets in Hz
+
+// TELEMETRY
+#define EEPROM_TELEM_Channel         780  // 2 bytes, U4B channel 0 - 599, 0xFFFF: off
+#define EEPROM_TELEM_VoltPin         782  // 1 byte, supply voltage on analog input An, 0xFF: none
+#define EEPROM_TELEM_VoltScale       783  // 1 byte, voltage divider ratio in 0.1
+
+// MESSAGE TABLE
+#define EEPROM_MSG_Table             784  // 4 x 32 bytes, messages 1 - 4, see message.cpp
+#define EEPROM_MSG_PatternCount      912  // 1 byte, entries in the pattern, 0: every message in turn
+#define EEPROM_MSG_Pattern           913  // 8 x 1 byte, message numbers
+
+// GPS TIMING
+#define EEPROM_GPS_Delay             921  // 4 bytes, UTC second to the end of the first NMEA sentence in ms
+
 // Function prototypes
 void LoadConfiguration();
+uint8_t ConfigRead(const uint16_t address);
+void ConfigWrite(const uint16_t address, const uint8_t value);
 
 #endif // _CONFIG_H
 
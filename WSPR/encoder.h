@@ -0,0 +1,36 @@
+#ifndef _ENCODER_H
+#define _ENCODER_H
+
+// Plain C++ so the state tables can also be built on a host
+#include <stdint.h>
+
+// Rotary encoder state machines. Row: state & 0x0F, column: (B << 1) | A. The next state
+// carries the step direction in bits 4 - 5
+#define ENC_RIGHT      0x10
+#define ENC_LEFT       0x20
+#define ENC_DIRECTION  0x30
+
+static const uint8_t encTableHalfStep[6][4] =
+{
+    {0x3, 0x2, 0x1, 0x0},
+    {0x23, 0x0, 0x1, 0x0},
+    {0x13, 0x2, 0x0, 0x0},
+    {0x3, 0x5, 0x4, 0x0},
+    {0x3, 0x3, 0x4, 0x10},
+    {0x3, 0x5, 0x3, 0x20},
+};
+
+static const uint8_t encTableFullStep[7][4] =
+{
+    {0x0, 0x2, 0x4,  0x0},
+    {0x3, 0x0, 0x1, 0x10},
+    {0x3, 0x2, 0x0,  0x0},
+    {0x3, 0x2, 0x1,  0x0},
+    {0x6, 0x0, 0x4,  0x0},
+    {0x6, 0x5, 0x0, 0x20},
+    {0x6, 0x5, 0x4,  0x0},
+};
+
+#endif // _ENCODER_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,197 @@
+// Own include
+#include "fmt.h"
+
+// RFzero includes
+#include <RFzero_util.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "profiler.h"
+
+// Small formatter for the display and console paths. sprintf() goes through the whole
+// newlib printf, and LCD.print() of a float through soft float multiplications, for what
+// is a couple of integers and a frequency. The M0+ has no divide instruction either, so
+// digits are found by subtracting powers of ten, a few cycles per digit, instead of a
+// library division per digit. Frequencies are integer Hz, shown as fixed point kHz
+
+static const uint32_t pow10[10] =
+{
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL, 1000UL, 100UL, 10UL, 1UL,
+};
+
+// Number of digits of a value, at least 1
+static int Digits(const uint32_t value)
+{
+    int n = 10;
+
+    while ((n > 1) && (value < pow10[10 - n]))
+        n--;
+    return n;
+}
+
+// Two digits of a value 0 - 99
+static char *Two(char *p, int value)
+{
+    char tens = '0';
+
+    while (value >= 10)
+    {
+        value -= 10;
+        tens++;
+    }
+    *p++ = tens;
+    *p++ = '0' + value;
+    return p;
+}
+
+char *FmtStr(char *p, const char *s)
+{
+    while (*s)
+        *p++ = *s++;
+    *p = 0;
+    return p;
+}
+
+// Decimal, right aligned in width with pad, '0' or ' '
+char *FmtUint(char *p, uint32_t value, const uint8_t width, const char pad)
+{
+    int n = Digits(value);
+
+    for (int i = n; i < width; i++)
+        *p++ = pad;
+    for (int i = 10 - n; i < 10; i++)
+    {
+        char digit = '0';
+        while (value >= pow10[i])
+        {
+            value -= pow10[i];
+            digit++;
+        }
+        *p++ = digit;
+    }
+    *p = 0;
+    return p;
+}
+
+// Signed decimal. With '0' padding the sign comes first, -007, with ' ' right before the digits
+char *FmtInt(char *p, const int32_t value, const uint8_t width, const char pad)
+{
+    uint32_t magnitude = (value < 0) ? 0UL - (uint32_t) value : (uint32_t) value;
+
+    if (value >= 0)
+        return FmtUint(p, magnitude, width, pad);
+    if (pad == ' ')
+        for (int i = Digits(magnitude) + 1; i < width; i++)
+            *p++ = ' ';
+    *p++ = '-';
+    return FmtUint(p, magnitude, ((pad == '0') && width) ? width - 1 : 0, pad);
+}
+
+// A value in units of 10^-decimals, e.g. 1409710 with 2 decimals is 14097.10
+char *FmtFixed(char *p, const int32_t value, const uint8_t decimals)
+{
+    uint32_t magnitude = (value < 0) ? 0UL - (uint32_t) value : (uint32_t) value;
+
+    if (value < 0)
+        *p++ = '-';
+    p = FmtUint(p, magnitude, decimals + 1, '0');
+    if (!decimals)
+        return p;
+
+    memmove(p - decimals + 1, p - decimals, decimals + 1);    // Make room for the point, with the terminator
+    p[-decimals] = '.';
+    return p + 1;
+}
+
+// A frequency in Hz as kHz with 0 - 3 decimals, rounded
+char *FmtKhz(char *p, const uint32_t hz, const uint8_t decimals)
+{
+    uint32_t unit = pow10[6 + min(decimals, (uint8_t) 3)];
+
+    return FmtFixed(p, (hz + unit / 2) / unit, min(decimals, (uint8_t) 3));
+}
+
+// hh:mm:ss
+char *FmtTime(char *p, const int hours, const int minutes, const int seconds)
+{
+    p = Two(p, hours);
+    *p++ = ':';
+    p = Two(p, minutes);
+    *p++ = ':';
+    p = Two(p, seconds);
+    *p = 0;
+    return p;
+}
+
+// yyyy-mm-dd
+char *FmtDate(char *p, const int year, const int month, const int day)
+{
+    p = FmtUint(p, year, 4, '0');
+    *p++ = '-';
+    p = Two(p, month);
+    *p++ = '-';
+    p = Two(p, day);
+    *p = 0;
+    return p;
+}
+
+#if PROFILER_ENABLED
+// Output that goes nowhere, to time Print::print() of a float without the LCD
+class NullPrint : public Print
+{
+public:
+    size_t write(uint8_t) { return 1; }
+};
+#endif
+
+// Cycles per call of the formatter against the sprintf(), LCD.print() and doubleToString()
+// calls it replaced, for the strings the display writes every second
+void FmtBench()
+{
+#if PROFILER_ENABLED
+    NullPrint sink;
+    const int runs = 100;
+    static const char* const caseName[4] = { "Time hh:mm:ss", "QRG kHz", "GPS line", "Frequency Hz" };
+    uint32_t cycles[4][2];
+    volatile double frequency = 14097100.0;
+    volatile int hh = 12, mm = 34, ss = 56, sats = 9, seq = 42;
+    char out[32], buf[80];
+
+    for (int c = 0; c < 4; c++)
+        for (int f = 0; f < 2; f++)
+        {
+            uint32_t start = ProfCycles();
+            for (int i = 0; i < runs; i++)
+            {
+                char *p = out;
+                switch (c * 2 + f)
+                {
+                    case 0: sprintf(out, "%02d:%02d:%02d", hh, mm, ss); break;
+                    case 1: FmtTime(out, hh, mm, ss); break;
+                    case 2: sink.print((float) (frequency / 1000.0), 2); sink.print(" kHz"); break;
+                    case 3: FmtStr(FmtKhz(out, (uint32_t) frequency, 2), " kHz"); break;
+                    case 4: sprintf(out, "GPS:OK,SAT:%02d,SEQ:%02d", sats, seq); break;
+                    case 5:
+                        p = FmtUint(FmtStr(p, "GPS:OK,SAT:"), sats, 2, '0');
+                        FmtUint(FmtStr(p, ",SEQ:"), seq, 2, '0');
+                        break;
+                    case 6: doubleToString(frequency, 0, out); break;
+                    default: FmtUint(out, (uint32_t) frequency); break;
+                }
+            }
+            cycles[c][f] = (ProfCycles() - start) / runs;
+        }
+
+    SerialUSB.println("Cycles per call   Before     Fmt        Speed up");
+    for (int c = 0; c < 4; c++)
+    {
+        sprintf(buf, "%-16s  %-9lu  %-9lu  ", caseName[c], (unsigned long) cycles[c][0], (unsigned long) cycles[c][1]);
+        SerialUSB.print(buf);
+        SerialUSB.print(cycles[c][1] ? (double) cycles[c][0] / cycles[c][1] : 0.0, 1);
+        SerialUSB.println(" x");
+    }
+#else
+    SerialUSB.println("Profiler disabled, see PROFILER_ENABLED");
+#endif
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,22 @@
+#ifndef _FMT_H
+#define _FMT_H
+
+// Arduino includes
+#include <Arduino.h>
+
+// Every function writes at p, 0 terminates and returns the end of the text, so calls can
+// be chained into one buffer. The caller makes sure the buffer is large enough
+
+// Function prototypes
+char *FmtStr(char *p, const char *s);
+char *FmtUint(char *p, uint32_t value, const uint8_t width = 0, const char pad = ' ');
+char *FmtInt(char *p, const int32_t value, const uint8_t width = 0, const char pad = ' ');
+char *FmtFixed(char *p, const int32_t value, const uint8_t decimals);
+char *FmtKhz(char *p, const uint32_t hz, const uint8_t decimals);
+char *FmtTime(char *p, const int hours, const int minutes, const int seconds);
+char *FmtDate(char *p, const int year, const int month, const int day);
+void FmtBench();
+
+#endif // _FMT_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -1,6 +1,9 @@
 // Own include
 #include "global.h"
 
+// Program includes. Located in the same directory as the .ino file
+#include "fmt.h"
+
 // S/W package info
 const char swPackage[] = "Beacon WSPR";
 const char swVersion[] = "0.9.3 mod";
@@ -25,6 +28,10 @@ int goodRTC = 0;
 
 // TXflag
 int TXflag = 2;                               // Initially, wait two minites
+int txState = 0;                              // TX_IDLE
+int paLead = 50;                              // PA on before the RF in ms
+int paRamp = 0;                               // RF ramp in ms, 0: hard keying
+int paHold = 50;                              // PA on after the RF in ms
 
 int REbutton = 7;                             // Rotary Encoder Switch. Deafult 1Mhz
 int REinc = 0;                                // Rotary Encoder right turns  
@@ -42,6 +49,19 @@ char locator[9] = "        ";                 // Locator. Make sure [8] = 0 or e
 
 // WSPR
 int wsprPower = 13;                           // The WSPR power level in dBm 
+int wsprMode = 0;                             // MODE_WSPR2
+
+// Second output on CLK1
+int dualEnable = 0;
+int dualPower = 13;                           // Power level in dBm
+double dualFrequency = 14097100.0;            // 20 m
+
+// QRSS
+int qrssStyle = 0;                            // QRSS_NONE
+int qrssDot = 3;                              // Dot length in s
+int qrssShift = 50;                           // FSK shift in 0.1 Hz
+int qrssEvery = 0;                            // 0: never, 1: every slot, N: every N'th slot
+double qrssFrequency = 10140050.0;            // Tone 0 frequency in Hz
 
 class Modulate Modes;
 
@@ -58,9 +78,9 @@ void PrintLibPrgVer(const int captionType)
     }
     
     char buf[50];
-    sprintf(buf, "RFzero library, v.%s", RFZERO_LIBRARY_VERSION);
+    FmtStr(FmtStr(buf, "RFzero library, v."), RFZERO_LIBRARY_VERSION);
     SerialUSB.println(buf);
-    sprintf(buf, "%s, v.%s", swPackage, swVersion);
+    FmtStr(FmtStr(FmtStr(buf, swPackage), ", v."), swVersion);
     SerialUSB.println(buf);
     
     switch (captionType)
@@ -71,7 +91,8 @@ void PrintLibPrgVer(const int captionType)
                 struct gpsData gpsInfo;
                 gpsNMEA.getFrameData(&gpsInfo);
 
-                sprintf(buf, "UTC (now): %04d-%02d-%02d, %02d:%02d:%02d", gpsInfo.utcYear, gpsInfo.utcMonth, gpsInfo.utcDay, gpsInfo.utcHours, gpsInfo.utcMinutes, gpsInfo.utcSeconds);
+                char *p = FmtDate(FmtStr(buf, "UTC (now): "), gpsInfo.utcYear, gpsInfo.utcMonth, gpsInfo.utcDay);
+                FmtTime(FmtStr(p, ", "), gpsInfo.utcHours, gpsInfo.utcMinutes, gpsInfo.utcSeconds);
                 SerialUSB.println(buf);
             }
             break;
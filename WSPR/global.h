@@ -32,8 +32,15 @@ extern int goodRTC;                    // Special flag to trust to RTC
 
 // TX flag
 extern int TXflag;                     // Transmit only if this flag equal 0
+extern int txState;                    // TX_IDLE, TX_LEAD, TX_ON or TX_HOLD, set by the TX engine
+extern int paLead;                     // PA on before the RF in ms
+extern int paRamp;                     // RF ramp in ms, 0: hard keying
+extern int paHold;                     // PA on after the RF in ms
 
 // Rotary Encoder Switch
+#define encA A0                        // Rotary encoder pins, in use with the LCD
+#define encB A1
+#define encP A2                        // Rotary encoder push pin
 extern int REbutton;                   // Rotary Encoder Button
 extern int REinc;                      // Rotary Encoder right turns  
 extern int REdec;                      // Rotary Encoder left turns
@@ -50,6 +57,19 @@ extern char locator[9];                // Locator. Make sure [8] = 0 or earlier
 
 // WSPR
 extern int wsprPower;                  // The WSPR power level in dBm 
+extern int wsprMode;                   // MODE_WSPR2, MODE_WSPR15 etc.
+
+// Second output on CLK1
+extern int dualEnable;                 // 1: CLK1 sends every WSPR frame too
+extern int dualPower;                  // CLK1 power level in dBm
+extern double dualFrequency;           // CLK1 nominal frequency in Hz
+
+// QRSS
+extern int qrssStyle;                  // QRSS_NONE, QRSS_OOK, QRSS_FSKCW or QRSS_DFCW
+extern int qrssDot;                    // Dot length in s
+extern int qrssShift;                  // FSK shift in 0.1 Hz
+extern int qrssEvery;                  // 0: never, 1: every slot, N: every N'th slot
+extern double qrssFrequency;           // Tone 0 frequency in Hz
 
 extern Modulate Modes;
 
@@ -0,0 +1,224 @@
+// Own include
+#include "i2cbus.h"
+
+#include <Wire.h>
+
+// The sketch is a single loop, so clients never really collide on the bus. What hurts is
+// a slow client (a display refresh, an EEPROM write) started from yield() just before a
+// symbol edge. During a frame the TX engine reserves its next edge, and a queued job only
+// gets the bus if its longest hold so far fits before that edge. Preemption is at job
+// boundaries: a job is a whole display refresh or command, as the libraries own the
+// individual transactions.
+//
+// The Si5351 and the 24LC08B run at 400 kHz. The PCF8574 is a 100 kHz part, so the clock
+// is lowered for the LCD and whenever the bus is idle outside a frame, which keeps every
+// library access that does not go through the arbiter safe
+
+struct I2cEntry
+{
+    I2cJob job;
+    unsigned long posted;              // micros() when queued
+    bool deferred;                     // Already counted as deferred
+};
+
+struct I2cQueue
+{
+    I2cEntry entry[I2C_QUEUE_MAX];
+    uint8_t head;
+    uint8_t count;
+};
+
+static const char* const i2cClientName[I2C_CLIENTS] =
+{
+    "TX",
+    "Calibration",
+    "EEPROM",
+    "LCD",
+};
+
+static const uint32_t i2cClientClock[I2C_CLIENTS] = { I2C_FAST_CLOCK, I2C_FAST_CLOCK, I2C_FAST_CLOCK, I2C_SLOW_CLOCK };
+static const uint32_t i2cClientBudget[I2C_CLIENTS] = { 0, 0, 20000UL, 30000UL };   // Hold estimate in us until one is measured
+
+static I2cQueue i2cQueue[I2C_CLIENTS];
+static I2cStat i2cTable[I2C_CLIENTS];
+static unsigned long statStart = 0;    // millis() of the last reset
+
+static bool reserved = false;          // A TX edge is reserved
+static unsigned long reservedEdge = 0; // micros() of the next symbol edge
+static unsigned long heldStart = 0;
+static uint32_t busClock = 0;
+
+static void SetClock(const uint32_t hz)
+{
+    if (hz != busClock)
+    {
+        Wire.setClock(hz);
+        busClock = hz;
+    }
+}
+
+// True if the client's job is expected to finish before the reserved TX edge
+static bool Fits(const uint8_t client)
+{
+    return I2cBusFits(max(i2cClientBudget[client], i2cTable[client].maxHeldUs));
+}
+
+void I2cBusInit()
+{
+    SetClock(I2C_SLOW_CLOCK);
+    I2cBusReset();
+}
+
+// Reserve the bus for a TX register write at edge. The bus stays at 400 kHz until released
+void I2cBusReserve(const unsigned long edge)
+{
+    reservedEdge = edge;
+    reserved = true;
+    SetClock(I2C_FAST_CLOCK);
+}
+
+void I2cBusRelease()
+{
+    reserved = false;
+    SetClock(I2C_SLOW_CLOCK);
+}
+
+// True if work of us microseconds, bus or not, ends before the reserved TX edge
+bool I2cBusFits(const uint32_t us)
+{
+    return !reserved || ((long) (reservedEdge - micros()) > (long) (us + I2C_GUARD_US));
+}
+
+// Queue a job. A job already waiting is not queued twice
+bool I2cBusPost(const uint8_t client, I2cJob job)
+{
+    if ((client == I2C_TX) || (client >= I2C_CLIENTS))
+        return false;
+
+    I2cQueue *q = &i2cQueue[client];
+    for (int i = 0; i < q->count; i++)
+        if (q->entry[(q->head + i) % I2C_QUEUE_MAX].job == job)
+            return true;
+    if (q->count == I2C_QUEUE_MAX)
+        return false;
+
+    I2cEntry *e = &q->entry[(q->head + q->count) % I2C_QUEUE_MAX];
+    e->job = job;
+    e->posted = micros();
+    e->deferred = false;
+    q->count++;
+    return true;
+}
+
+bool I2cBusPending(const uint8_t client)
+{
+    return (client < I2C_CLIENTS) && i2cQueue[client].count;
+}
+
+// Run the queued jobs in priority order as long as they fit before the reserved TX edge.
+// A job that does not fit also holds back every lower priority job
+void I2cBusRun()
+{
+    static bool running = false;
+
+    if (running)
+        return;
+    running = true;
+
+    for (int c = I2C_TX + 1; c < I2C_CLIENTS; c++)
+    {
+        I2cQueue *q = &i2cQueue[c];
+        while (q->count)
+        {
+            I2cEntry *e = &q->entry[q->head];
+            if (!Fits(c))
+            {
+                if (!e->deferred)
+                    i2cTable[c].deferred++;
+                e->deferred = true;
+                running = false;
+                return;
+            }
+
+            I2cJob job = e->job;
+            uint32_t wait = micros() - e->posted;
+            q->head = (q->head + 1) % I2C_QUEUE_MAX;
+            q->count--;
+
+            i2cTable[c].waitUs += wait;
+            if (wait > i2cTable[c].maxWaitUs)
+                i2cTable[c].maxWaitUs = wait;
+
+            I2cBusBegin(c);
+            job();
+            I2cBusEnd(c);
+        }
+    }
+    running = false;
+}
+
+// Take the bus for a client at its clock. For TX the wait is how late the write is after
+// the reserved edge
+void I2cBusBegin(const uint8_t client)
+{
+    I2cStat *stat = &i2cTable[client];
+
+    SetClock(i2cClientClock[client]);
+    heldStart = micros();
+    stat->count++;
+
+    if ((client == I2C_TX) && reserved)
+    {
+        long late = (long) (heldStart - reservedEdge);
+        if (late > 0)
+        {
+            stat->waitUs += late;
+            if ((uint32_t) late > stat->maxWaitUs)
+                stat->maxWaitUs = late;
+        }
+    }
+}
+
+void I2cBusEnd(const uint8_t client)
+{
+    I2cStat *stat = &i2cTable[client];
+    uint32_t held = micros() - heldStart;
+
+    stat->heldUs += held;
+    if (held > stat->maxHeldUs)
+        stat->maxHeldUs = held;
+    SetClock(reserved ? I2C_FAST_CLOCK : I2C_SLOW_CLOCK);
+}
+
+void I2cBusReset()
+{
+    memset(i2cTable, 0, sizeof(i2cTable));
+    statStart = millis();
+}
+
+void I2cBusDump()
+{
+    char buf[100];
+    uint64_t held = 0;
+    unsigned long elapsed = millis() - statStart;
+
+    SerialUSB.println("Client       Grants     Deferred   Wait avg us  Wait max us  Held ms    Held max us");
+    for (int i = 0; i < I2C_CLIENTS; i++)
+    {
+        const I2cStat *stat = &i2cTable[i];
+        unsigned long avg = stat->count ? (unsigned long) (stat->waitUs / stat->count) : 0;
+
+        sprintf(buf, "%-11s  %-9lu  %-9lu  %-11lu  %-11lu  %-9lu  %lu", i2cClientName[i], (unsigned long) stat->count,
+                (unsigned long) stat->deferred, avg, (unsigned long) stat->maxWaitUs, (unsigned long) (stat->heldUs / 1000),
+                (unsigned long) stat->maxHeldUs);
+        SerialUSB.println(buf);
+        held += stat->heldUs;
+    }
+
+    sprintf(buf, "Bus held %lu of %lu ms: ", (unsigned long) (held / 1000), elapsed);
+    SerialUSB.print(buf);
+    SerialUSB.print(elapsed ? held / 10.0 / elapsed : 0.0, 2);
+    SerialUSB.println(" %");
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,50 @@
+#ifndef _I2CBUS_H
+#define _I2CBUS_H
+
+// Arduino includes
+#include <Arduino.h>
+
+// Arbiter for the shared Wire bus. Clients in priority order, highest first. Keep
+// i2cClientName[] and i2cClientClock[] in i2cbus.cpp in the same order
+enum I2cClient
+{
+    I2C_TX = 0,                        // Si5351 symbol writes, never queued
+    I2C_CAL,                           // Reference calibration
+    I2C_EEPROM,                        // 24LC08B, configuration commands
+    I2C_LCD,                           // PCF8574 LCD backpack
+    I2C_CLIENTS                        // Number of clients, must be last
+};
+
+#define I2C_FAST_CLOCK    400000UL     // Si5351 and 24LC08B
+#define I2C_SLOW_CLOCK    100000UL     // PCF8574, and the bus when idle
+#define I2C_QUEUE_MAX     4            // Pending jobs per client
+#define I2C_GUARD_US      5000UL       // Margin a job must leave before the reserved TX edge
+
+typedef void (*I2cJob)();
+
+struct I2cStat
+{
+    uint32_t count;                    // Bus grants
+    uint32_t deferred;                 // Times a queued job had to wait for a TX edge
+    uint64_t waitUs;                   // Total wait, queued to granted. TX: late after the symbol edge
+    uint32_t maxWaitUs;
+    uint64_t heldUs;                   // Total time the client held the bus
+    uint32_t maxHeldUs;                // Longest hold, also the estimate used to fit the job before an edge
+};
+
+// Function prototypes
+void I2cBusInit();
+void I2cBusReserve(const unsigned long edge);
+void I2cBusRelease();
+bool I2cBusFits(const uint32_t us);
+bool I2cBusPost(const uint8_t client, I2cJob job);
+bool I2cBusPending(const uint8_t client);
+void I2cBusRun();
+void I2cBusBegin(const uint8_t client);
+void I2cBusEnd(const uint8_t client);
+void I2cBusDump();
+void I2cBusReset();
+
+#endif // _I2CBUS_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,244 @@
+// Own include
+#include "journal.h"
+
+// RFzero includes
+#include <RFzero.h>
+#include <RTCZero.h>
+#include <time.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "global.h"
+#include "calib.h"
+#include "clock.h"
+#include "txengine.h"
+
+// TX journal. Every slot the schedule acts on leaves a fixed width record, so after a
+// field failure the history can be matched against the WSPRnet spots. The 1 kB EEPROM
+// is all but full with the configuration and the calibration ring, so the journal lives
+// in a ring of flash rows: 4 kB, 256 records, some 8 hours of back to back WSPR-2 frames.
+// The rows are a row aligned const array of the sketch, placed by the linker with the
+// other constants. A record is one page write of 4 words, and a row is only erased when
+// the ring reaches it, so every row sees one erase per 256 frames. As the array is part
+// of the sketch image, every sketch upload writes it back to zeros and erases the journal.
+//
+// Record layout, little endian: sequence, CRC-8 of the rest, UTC (4), frequency in Hz (4),
+// reference - 27 MHz in 0.1 Hz (2), slot start to first symbol in ms (2), kind (2 bits),
+// message (3 bits) and result (3 bits), GPS valid (bit 7), RTC trusted (bit 6) and
+// satellites (6 bits). UTC and the slot start come from the GPS anchored clock. Without
+// it the time is the RTC's with the date of the GPS, or only the time of day. The
+// sequence counts modulo 255 so a full ring still has a break after the newest record
+
+#define JOURNAL_SEQ_MOD      255
+#define JOURNAL_NOMINAL      27000000.0  // Hz, reference offsets are stored relative to this
+
+extern RTCZero rtc;
+
+// The ring, whole flash rows of its own. Read through a volatile pointer as the
+// compiler takes the array for all zero
+__attribute__((__aligned__(JOURNAL_ROW_SIZE), used))
+static const uint8_t journalFlash[JOURNAL_ROWS * JOURNAL_ROW_SIZE] = { };
+static const volatile uint8_t *flash = journalFlash;
+
+static int newest = -1;                  // Index of the newest record, -1: empty
+static uint8_t newestSeq = 0;
+static bool started = false;             // A slot is waiting for its record, see JournalStart()
+static uint32_t startUtc = 0;
+static unsigned long startUs = 0;
+static uint8_t startGps = 0;
+
+// CRC-8, polynomial 0x07. Starts at 0xFF so the all zero records of a fresh upload fail
+static uint8_t Crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0xFF;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static uint32_t Get32(const uint8_t *b)
+{
+    return b[0] | (b[1] << 8) | ((uint32_t) b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+static void Put32(uint8_t *b, const uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        b[i] = (v >> (8 * i)) & 0xFF;
+}
+
+// Copy a record out of the flash. False if it is erased, never written or damaged
+static bool Read(const int index, uint8_t *b)
+{
+    for (int i = 0; i < JOURNAL_RECORD_SIZE; i++)
+        b[i] = flash[index * JOURNAL_RECORD_SIZE + i];
+    return (b[0] < JOURNAL_SEQ_MOD) && (Crc8(&b[2], JOURNAL_RECORD_SIZE - 2) == b[1]);
+}
+
+static void NvmCommand(const uint32_t cmd)
+{
+    NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | cmd;
+    while (!NVMCTRL->INTFLAG.bit.READY);
+}
+
+// Erase the flash row of a record
+static void EraseRow(const int index)
+{
+    NVMCTRL->ADDR.reg = ((uintptr_t) &journalFlash[index * JOURNAL_RECORD_SIZE]) / 2;
+    NvmCommand(NVMCTRL_CTRLA_CMD_ER);
+}
+
+// Program a record. The page buffer is cleared to all ones, so the rest of the page is
+// left as it is. Manual write mode only for the one page, the core and the RFzero library
+// expect CTRLB as they set it
+static void Program(const int index, const uint8_t *b)
+{
+    volatile uint32_t *dst = (volatile uint32_t *) &journalFlash[index * JOURNAL_RECORD_SIZE];
+    const uint32_t ctrlb = NVMCTRL->CTRLB.reg;
+
+    NVMCTRL->CTRLB.bit.MANW = 1;
+    NvmCommand(NVMCTRL_CTRLA_CMD_PBC);
+    for (int i = 0; i < JOURNAL_RECORD_SIZE / 4; i++)
+        dst[i] = Get32(&b[4 * i]);
+    NvmCommand(NVMCTRL_CTRLA_CMD_WP);
+    NVMCTRL->CTRLB.reg = ctrlb;
+}
+
+// Find the newest record
+void JournalLoad()
+{
+    uint8_t b[JOURNAL_RECORD_SIZE], next[JOURNAL_RECORD_SIZE];
+
+    newest = -1;
+    for (int i = 0; i < JOURNAL_RECORDS; i++)
+    {
+        if (!Read(i, b))
+            continue;
+        if (!Read((i + 1) % JOURNAL_RECORDS, next) || (next[0] != (b[0] + 1) % JOURNAL_SEQ_MOD))
+        {
+            newest = i;
+            newestSeq = b[0];
+            break;
+        }
+    }
+}
+
+// Note the start of a slot the schedule acts on, slotStart on ClockNow()
+void JournalStart(const uint64_t slotStart)
+{
+    struct gpsData gpsInfo;
+    uint32_t us;
+
+    gpsNMEA.getFrameData(&gpsInfo);
+    if (!ClockToUtc(slotStart + 500000ULL, &startUtc, &us))     // Rounded to the second
+    {
+        startUtc = rtc.getHours() * 3600UL + rtc.getMinutes() * 60UL + rtc.getSeconds();
+        if ((gpsInfo.utcYear >= 2000) && (gpsInfo.utcMonth >= 1) && (gpsInfo.utcMonth <= 12) && (gpsInfo.utcDay >= 1))
+            startUtc += ClockDays(gpsInfo.utcYear, gpsInfo.utcMonth, gpsInfo.utcDay) * 86400UL;
+    }
+    startUs = (unsigned long) slotStart;
+    started = true;
+    startGps = (gpsInfo.valid ? 0x80 : 0) | (goodRTC ? 0x40 : 0) | min(max(gpsInfo.satellites, 0), 63);
+}
+
+// Log the slot noted by JournalStart(). Frequency and start time are those of the frame
+// the TX engine sent last, so only a sent frame has them
+void JournalWrite(const uint8_t kind, const uint8_t msg, const uint8_t result)
+{
+    uint8_t b[JOURNAL_RECORD_SIZE];
+    double fref = freqCount.getReferenceFrequency();
+    int32_t value;
+
+    if (!started)
+        return;
+    if (fref <= 0.0)
+        fref = CalibReference();
+
+    Put32(&b[2], startUtc);
+    Put32(&b[6], (result == JOURNAL_SENT) ? (uint32_t) lround(TxEngineFrequency()) : 0);
+    value = constrain(lround((fref - JOURNAL_NOMINAL) * 10.0), -32768L, 32767L);
+    b[10] = value & 0xFF;
+    b[11] = (value >> 8) & 0xFF;
+    value = (result == JOURNAL_SENT) ? constrain((long) (TxEngineStartUs() - startUs) / 1000L, -32768L, 32767L) : 0;
+    b[12] = value & 0xFF;
+    b[13] = (value >> 8) & 0xFF;
+    b[14] = ((kind & 0x03) << 6) | ((msg & 0x07) << 3) | (result & 0x07);
+    b[15] = startGps;
+    b[0] = (newest >= 0) ? (newestSeq + 1) % JOURNAL_SEQ_MOD : 0;
+    b[1] = Crc8(&b[2], JOURNAL_RECORD_SIZE - 2);
+
+    int index = (newest + 1) % JOURNAL_RECORDS;
+    if (!(index % (JOURNAL_ROW_SIZE / JOURNAL_RECORD_SIZE)))
+        EraseRow(index);
+    Program(index, b);
+    newest = index;
+    newestSeq = b[0];
+    started = false;
+}
+
+// Number of records in the ring
+int JournalCount()
+{
+    uint8_t b[JOURNAL_RECORD_SIZE];
+    int count = 0;
+
+    for (int i = 0; i < JOURNAL_RECORDS; i++)
+        if (Read(i, b))
+            count++;
+    return count;
+}
+
+// Stream the journal, oldest record first. Binary: "WSPRJRNL", record size, record count
+// (2), then the records as stored. CSV: a header line and a line per record
+void JournalExport(const bool binary)
+{
+    static const char* const kindName[4] = { "WSPR", "telemetry", "QRSS", "?" };
+    static const char* const resultName[8] = { "sent", "no frame", "no table", "failed", "?", "?", "?", "?" };
+    uint8_t b[JOURNAL_RECORD_SIZE];
+    char buf[100];
+
+    if (binary)
+    {
+        int count = JournalCount();
+        SerialUSB.write((const uint8_t *) "WSPRJRNL", 8);
+        SerialUSB.write((uint8_t) JOURNAL_RECORD_SIZE);
+        SerialUSB.write((uint8_t) (count & 0xFF));
+        SerialUSB.write((uint8_t) (count >> 8));
+    }
+    else
+        SerialUSB.println("utc,kind,message,frequency_hz,reference_hz,start_ms,gps_valid,rtc_trusted,satellites,result");
+
+    for (int i = 1; i <= JOURNAL_RECORDS; i++)
+    {
+        if (!Read((newest + i) % JOURNAL_RECORDS, b))
+            continue;
+        if (binary)
+        {
+            SerialUSB.write(b, JOURNAL_RECORD_SIZE);
+            continue;
+        }
+
+        time_t utc = Get32(&b[2]);
+        struct tm *tm = gmtime(&utc);
+        long fref = (int16_t) (b[10] | (b[11] << 8)) + (long) (JOURNAL_NOMINAL * 10.0);
+        sprintf(buf, "%04d-%02d-%02d %02d:%02d:%02d,%s,%d,%lu,%ld.%ld,%d,%d,%d,%d,%s", tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+                tm->tm_hour, tm->tm_min, tm->tm_sec, kindName[b[14] >> 6], (b[14] >> 3) & 0x07, (unsigned long) Get32(&b[6]),
+                fref / 10, fref % 10, (int16_t) (b[12] | (b[13] << 8)), (b[15] >> 7) & 1, (b[15] >> 6) & 1, b[15] & 0x3F,
+                resultName[b[14] & 0x07]);
+        SerialUSB.println(buf);
+    }
+}
+
+// Erase the whole ring
+void JournalClear()
+{
+    for (int i = 0; i < JOURNAL_RECORDS; i += JOURNAL_ROW_SIZE / JOURNAL_RECORD_SIZE)
+        EraseRow(i);
+    newest = -1;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,33 @@
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+// Arduino includes
+#include <Arduino.h>
+
+#define JOURNAL_ROW_SIZE     256         // Bytes per flash row, the erase unit
+#define JOURNAL_ROWS         16          // Flash rows in the ring
+#define JOURNAL_RECORD_SIZE  16          // Bytes per record
+#define JOURNAL_RECORDS      (JOURNAL_ROWS * JOURNAL_ROW_SIZE / JOURNAL_RECORD_SIZE)
+
+// What was sent
+#define JOURNAL_WSPR         0
+#define JOURNAL_TELEMETRY    1
+#define JOURNAL_QRSS         2
+
+// How it ended
+#define JOURNAL_SENT         0
+#define JOURNAL_NO_FRAME     1           // The message cannot be encoded in the mode
+#define JOURNAL_NO_TABLE     2           // No valid tone table for the frequency
+#define JOURNAL_FAILED       3           // The TX engine refused the frame
+
+// Function prototypes
+void JournalLoad();
+void JournalStart(const uint64_t slotStart);
+void JournalWrite(const uint8_t kind, const uint8_t msg, const uint8_t result);
+int JournalCount();
+void JournalExport(const bool binary);
+void JournalClear();
+
+#endif // _JOURNAL_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,139 @@
+// Own include
+#include "message.h"
+
+// RFzero includes
+#include <RFzero.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "global.h"
+#include "config.h"
+#include "txengine.h"
+#include "wspr.h"
+
+// Message table. Besides the beacon call, locator and power (message 0) up to MSG_MAX
+// more messages can be sent in rotation, e.g. other power levels, a club call or another
+// locator. Every message is encoded by the TX engine when the configuration is loaded,
+// and a message on its own frequency also gets its own tone table, so picking the next
+// message at the slot boundary is an index step.
+//
+// Entry layout in the EEPROM: call (15 + 1), locator (8 + 1), power (1), frequency in Hz
+// (4, 0: the frequency of the slot). An entry with no call is unused, an entry without a
+// locator uses the beacon locator.
+//
+// The messages follow the pattern, a list of message numbers, or without one every used
+// message in turn
+
+struct Message
+{
+    char call[16];
+    char locator[9];
+    int power;
+    uint32_t freq;
+};
+
+static Message message[MSG_COUNT];         // [0] is unused, message 0 is the beacon configuration
+static uint8_t pattern[MSG_PATTERN_MAX];
+static int patternCount = 0;
+static int patternNext = 0;
+
+// Read a 0 terminated string field, false if it is empty or unwritten
+static bool ReadString(const int address, char *str, const int size)
+{
+    for (int i = 0; i < size; i++)
+        str[i] = (char) eeprom.readByte(address + i, 0);
+    str[size - 1] = 0;
+    return (str[0] != 0) && ((uint8_t) str[0] != 0xFF);
+}
+
+// Read and encode the table. TxEngineLoad() must have set the mode first
+void MessageLoad()
+{
+    for (int i = 1; i < MSG_COUNT; i++)
+    {
+        int address = EEPROM_MSG_Table + (i - 1) * MSG_ENTRY_SIZE;
+        Message *m = &message[i];
+
+        m->freq = 0;
+        if (!ReadString(address, m->call, sizeof(m->call)))
+        {
+            m->call[0] = 0;
+            TxEngineLoadMessage(i, 0, 0, 0);
+            continue;
+        }
+        if (!ReadString(address + 16, m->locator, sizeof(m->locator)))
+            strcpy(m->locator, locator);
+        m->power = eeprom.readByte(address + 25, 0xFF);
+        m->freq = eeprom.readInteger(address + 26, 0);
+        if ((m->freq < 100000) || (m->freq > 298765432))           // Same range as the beacon frequency
+            m->freq = 0;
+        TxEngineLoadMessage(i, m->call, m->locator, m->power);
+    }
+
+    patternCount = eeprom.readByte(EEPROM_MSG_PatternCount, 0);
+    if (patternCount > MSG_PATTERN_MAX)
+        patternCount = 0;
+    for (int i = 0; i < patternCount; i++)
+    {
+        pattern[i] = eeprom.readByte(EEPROM_MSG_Pattern + i, 0);
+        if (pattern[i] >= MSG_COUNT)
+            pattern[i] = 0;
+    }
+    patternNext = 0;
+}
+
+// Calculate the tone tables of the messages on their own frequency
+void MessageRefresh()
+{
+    for (int i = 1; i < MSG_COUNT; i++)
+        if (message[i].freq && TxEngineFrames(i))
+            TxEngineTones(TX_TABLE_MSG + i - 1, message[i].freq);
+}
+
+// The message for the next frame. Messages that cannot be sent are skipped
+int MessageNext()
+{
+    for (int i = 0; i < (patternCount ? patternCount : MSG_COUNT); i++)
+    {
+        int msg = patternCount ? pattern[patternNext % patternCount] : patternNext % MSG_COUNT;
+        patternNext = (patternNext + 1) % (patternCount ? patternCount : MSG_COUNT);
+        if (TxEngineFrames(msg))
+            return msg;
+    }
+    return 0;
+}
+
+// The tone table of a message on its own frequency, BAND_NONE if it uses the slot's table
+int MessageTable(const int msg)
+{
+    return ((msg > 0) && (msg < MSG_COUNT) && message[msg].freq) ? TX_TABLE_MSG + msg - 1 : BAND_NONE;
+}
+
+// Fields of a message, false if it is not in use. TxEngineFrames() tells if it can be sent
+bool MessageGet(const int msg, char *msgCall, char *msgLocator, int *power, uint32_t *freq)
+{
+    if (msg == 0)
+    {
+        strcpy(msgCall, call);
+        strcpy(msgLocator, locator);
+        *power = wsprPower;
+        *freq = 0;
+        return true;
+    }
+    if ((msg < 0) || (msg >= MSG_COUNT) || !message[msg].call[0])
+        return false;
+
+    strcpy(msgCall, message[msg].call);
+    strcpy(msgLocator, message[msg].locator);
+    *power = message[msg].power;
+    *freq = message[msg].freq;
+    return true;
+}
+
+// The rotation pattern, returns the number of entries, 0: every message in turn
+int MessagePattern(uint8_t *entries)
+{
+    memcpy(entries, pattern, patternCount);
+    return patternCount;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,22 @@
+#ifndef _MESSAGE_H
+#define _MESSAGE_H
+
+// Arduino includes
+#include <Arduino.h>
+
+#define MSG_MAX            4               // Messages in the table besides the beacon message
+#define MSG_COUNT          (MSG_MAX + 1)   // Message 0 is the beacon call, locator and power
+#define MSG_PATTERN_MAX    8               // Entries in the rotation pattern
+#define MSG_ENTRY_SIZE     32              // EEPROM bytes per message
+
+// Function prototypes
+void MessageLoad();
+void MessageRefresh();
+int MessageNext();
+int MessageTable(const int msg);
+bool MessageGet(const int msg, char *call, char *locator, int *power, uint32_t *freq);
+int MessagePattern(uint8_t *pattern);
+
+#endif // _MESSAGE_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,43 @@
+// Own include
+#include "mode.h"
+
+// The slow WSPR modes. WSPR-15 is WSPR-2 with 8 times longer symbols and 8 times closer
+// tones. Only modes with an encoder are listed, the TX engine, the scheduler and the tools
+// take the symbols, tones, timing and sync pattern of a frame from here.
+//
+// FST4W is deferred. Its 4-GFSK frame has the sync in five 8 symbol blocks between the
+// data symbols, which a SYNC_INSERTED pattern describes, but its CRC-24 and LDPC (240,74)
+// code need the generator matrix of WSJT-X and golden vectors from fst4sim to be verified.
+// It goes in as its own change with those: an encoder, a pattern and a row per T/R period
+
+static const ModeDesc modeTable[MODE_COUNT] =
+{
+    { "WSPR-2",      WSPR_SYMBOL_COUNT, 4, 12000.0 / 8192.0,     682667UL,  2, SYNC_MERGED, wsprSync, WsprEncodeRotation },
+    { "WSPR-15",     WSPR_SYMBOL_COUNT, 4, 12000.0 / 65536.0,   5461333UL, 15, SYNC_MERGED, wsprSync, WsprEncodeRotation },
+};
+
+// The descriptor of a mode, NULL if there is no such mode
+const ModeDesc *ModeGet(const int mode)
+{
+    return ((mode >= 0) && (mode < MODE_COUNT)) ? &modeTable[mode] : 0;
+}
+
+// True if a frame carries the sync pattern of its mode
+bool ModeSyncOk(const ModeDesc *mode, const uint8_t *symbols)
+{
+    for (int k = 0; k < mode->symbols; k++)
+    {
+        if (symbols[k] >= mode->tones)
+            return false;
+        if (mode->syncMode == SYNC_MERGED)
+        {
+            if ((symbols[k] & 1) != mode->sync[k])
+                return false;
+        }
+        else if ((mode->sync[k] != SYNC_DATA) && (symbols[k] != mode->sync[k]))
+            return false;
+    }
+    return true;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
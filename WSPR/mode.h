@@ -0,0 +1,47 @@
+#ifndef _MODE_H
+#define _MODE_H
+
+// Plain C++ so the mode table can also be built on a host
+#include <stdint.h>
+
+#include "wspr.h"
+
+#define MODE_SYMBOLS_MAX   WSPR_SYMBOL_COUNT   // Longest frame of all modes
+
+// Where the sync pattern of a mode sits in the channel symbols
+#define SYNC_MERGED        0                   // Bit 0 of every symbol, the data in the bits above (WSPR)
+#define SYNC_INSERTED      1                   // Whole sync symbols at fixed positions between the data symbols
+#define SYNC_DATA          0xFF                // SYNC_INSERTED pattern entry of a data symbol
+
+// Modes. Keep modeTable[] in mode.cpp in the same order
+enum ModeId
+{
+    MODE_WSPR2 = 0,
+    MODE_WSPR15,
+    MODE_COUNT                                 // Number of modes, must be last
+};
+
+// Encodes every frame of the message rotation. Returns the number of frames, 0 if the
+// message cannot be sent in the mode
+typedef int (*ModeEncodeFunc)(const char *call, const char *locator, const int power, uint8_t symbols[][MODE_SYMBOLS_MAX], uint8_t *types);
+
+struct ModeDesc
+{
+    const char *name;
+    uint16_t symbols;                          // Channel symbols per frame
+    uint8_t tones;                             // FSK tones
+    double spacing;                            // Tone spacing in Hz
+    uint32_t symbolPeriodUs;                   // Symbol length in us
+    uint8_t periodMinutes;                     // T/R period. Frames start on minutes of the hour divisible by it
+    uint8_t syncMode;                          // SYNC_MERGED or SYNC_INSERTED
+    const uint8_t *sync;                       // Sync pattern, one entry per channel symbol
+    ModeEncodeFunc encode;
+};
+
+// Function prototypes
+const ModeDesc *ModeGet(const int mode);
+bool ModeSyncOk(const ModeDesc *mode, const uint8_t *symbols);
+
+#endif // _MODE_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,106 @@
+// Own include
+#include "profiler.h"
+
+// The Cortex-M0+ has no DWT cycle counter, so cycles are derived from the SysTick
+// timer that the Arduino core already runs at F_CPU with a 1 ms reload
+
+#define CYCLES_PER_MS   (F_CPU / 1000)
+
+#if PROFILER_ENABLED
+
+static const char* const profSectionName[PROF_SECTIONS] =
+{
+    "yield",
+    "Display_Update",
+    "ParseCommand",
+    "gps.autoParse",
+    "refreshRefFrequency",
+    "BandRefresh",
+};
+
+static ProfStat profTable[PROF_SECTIONS];
+
+// Free running 32 bit cycle counter. Wraps every ~89 s at 48 MHz which is fine for durations
+uint32_t ProfCycles()
+{
+    uint32_t ticks, ticks2;
+    uint32_t pend, pend2;
+    uint32_t count, count2;
+
+    // Same retry scheme as the core's micros(): re-read until no SysTick wrap happened in between.
+    // millis() is the SysTick interrupt counter
+    ticks2 = SysTick->VAL;
+    pend2 = !!(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk);
+    count2 = millis();
+    do
+    {
+        ticks = ticks2;
+        pend = pend2;
+        count = count2;
+        ticks2 = SysTick->VAL;
+        pend2 = !!(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk);
+        count2 = millis();
+    } while ((pend != pend2) || (count != count2) || (ticks < ticks2));
+
+    // The counter runs LOAD down to 0, LOAD + 1 cycles per millisecond tick
+    uint32_t period = SysTick->LOAD + 1;
+    return (count + pend + 1) * period - ticks;
+}
+
+void ProfRecord(const uint8_t section, const uint32_t cycles)
+{
+    ProfStat *stat = &profTable[section];
+
+    stat->count++;
+    stat->total += cycles;
+    if (cycles > stat->max)
+        stat->max = cycles;
+
+    uint8_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+    stat->hist[bucket]++;
+}
+
+void ProfReset()
+{
+    memset(profTable, 0, sizeof(profTable));
+}
+
+void ProfDump()
+{
+    char buf[80];
+
+    SerialUSB.println("Section               Calls      Total ms   Avg us     Max us");
+    for (int i = 0; i < PROF_SECTIONS; i++)
+    {
+        const ProfStat *stat = &profTable[i];
+        unsigned long avg = stat->count ? (unsigned long) ((stat->total / stat->count) / (CYCLES_PER_MS / 1000)) : 0;
+
+        sprintf(buf, "%-20s  %-9lu  %-9lu  %-9lu  %lu", profSectionName[i], (unsigned long) stat->count,
+                (unsigned long) (stat->total / CYCLES_PER_MS), avg, (unsigned long) (stat->max / (CYCLES_PER_MS / 1000)));
+        SerialUSB.println(buf);
+
+        for (int b = 0; b < PROF_BUCKETS; b++)
+        {
+            if (stat->hist[b])
+            {
+                sprintf(buf, "    >= 2^%02d cycles    : %lu", b, (unsigned long) stat->hist[b]);
+                SerialUSB.println(buf);
+            }
+        }
+    }
+}
+
+#else
+
+void ProfReset()
+{
+}
+
+void ProfDump()
+{
+    SerialUSB.println("Profiler disabled at compile time");
+}
+
+#endif // PROFILER_ENABLED
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,71 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+// Arduino includes
+#include <Arduino.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "profiles.h"
+
+// Hot-path profiler. Set PROFILER_ENABLED to 0, or pick a build profile without it in
+// profiles.h, to compile all instrumentation out
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// Profiled sections. Keep profSectionName[] in profiler.cpp in the same order
+enum ProfSection
+{
+    PROF_YIELD = 0,                    // yield(), inclusive of everything it calls
+    PROF_DISPLAY,                      // Display_Update()
+    PROF_COMMAND,                      // ParseCommand()
+    PROF_GPS,                          // gps.autoParse()
+    PROF_REFCAL,                       // si5351a.refreshRefFrequency()
+    PROF_TONES,                        // BandLoad() and BandRefresh(), all tone tables
+    PROF_SECTIONS                      // Number of sections, must be last
+};
+
+#define PROF_BUCKETS 32                // log2 histogram buckets, bucket n holds 2^n to 2^(n+1)-1 cycles
+
+struct ProfStat
+{
+    uint32_t count;                    // Number of calls
+    uint64_t total;                    // Total number of cycles
+    uint32_t max;                      // Longest call in cycles
+    uint32_t hist[PROF_BUCKETS];       // log2 latency histogram
+};
+
+#if PROFILER_ENABLED
+
+uint32_t ProfCycles();
+void ProfRecord(const uint8_t section, const uint32_t cycles);
+
+// Records the cycles spent from construction until the object goes out of scope
+class ProfScope
+{
+public:
+    ProfScope(const uint8_t section) : _section(section), _start(ProfCycles()) {}
+    ~ProfScope() { ProfRecord(_section, ProfCycles() - _start); }
+
+private:
+    const uint8_t _section;
+    const uint32_t _start;
+};
+
+#define PROF_SCOPE(section)  ProfScope profScope_##section(section)
+#define PROF_CALL(section, call) do { ProfScope profScope_call(section); call; } while (0)
+
+#else
+
+#define PROF_SCOPE(section)
+#define PROF_CALL(section, call) do { call; } while (0)
+
+#endif // PROFILER_ENABLED
+
+// Function prototypes
+void ProfDump();
+void ProfReset();
+
+#endif // _PROFILER_H
+
+// ----------------- EOF -------------------------------------------------------------------
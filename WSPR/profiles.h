@@ -0,0 +1,43 @@
+#ifndef _PROFILES_H
+#define _PROFILES_H
+
+// Build profiles. Pick one with -DWSPR_PROFILE=n, see the README for the build targets.
+// A single feature can still be set on its own, e.g. -DFEATURE_HELP=0. A feature set to
+// 0 is compiled out: the code, its strings and, for the LCD, the encoder interrupts
+#define PROFILE_FULL         0           // LCD and encoder, help, telemetry, self test and profiler
+#define PROFILE_HEADLESS     1           // USB console only, no LCD or encoder
+#define PROFILE_BALLOON      2           // Telemetry, no LCD, help text, self test or profiler
+#define PROFILE_LAB          3           // USB console with the diagnostics: help, self test and profiler
+
+#ifndef WSPR_PROFILE
+#define WSPR_PROFILE         PROFILE_FULL
+#endif
+
+// 20x4 LCD, rotary encoder, splash screens and the frequency dialog
+#ifndef FEATURE_LCD
+#define FEATURE_LCD          (WSPR_PROFILE == PROFILE_FULL)
+#endif
+
+// Command list of help and ?
+#ifndef FEATURE_HELP
+#define FEATURE_HELP         (WSPR_PROFILE != PROFILE_BALLOON)
+#endif
+
+// Balloon telemetry frames and the NMEA parser feeding them
+#ifndef FEATURE_TELEMETRY
+#define FEATURE_TELEMETRY    ((WSPR_PROFILE == PROFILE_FULL) || (WSPR_PROFILE == PROFILE_BALLOON))
+#endif
+
+// rd selftest golden vectors and rd bench
+#ifndef FEATURE_SELFTEST
+#define FEATURE_SELFTEST     (WSPR_PROFILE != PROFILE_BALLOON)
+#endif
+
+// Hot path profiler, see profiler.h
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED     ((WSPR_PROFILE == PROFILE_FULL) || (WSPR_PROFILE == PROFILE_LAB))
+#endif
+
+#endif // _PROFILES_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,107 @@
+// Own include
+#include "qrss.h"
+
+#include <string.h>
+
+// Morse text to a (tone, units) timeline. Runs of the same tone are merged, so a frame
+// is played back with one register write or RF switch per entry. Timing: dot 1 unit,
+// dash 3, element gap 1, character gap 3, word gap 7. DFCW dashes are 1 unit as well
+
+// Elements of A-Z, 0-9 and /, LSB first, 1: dash, the highest set bit marks the end
+static const uint8_t morseLetters[26] =
+{
+    0x06, 0x11, 0x15, 0x09, 0x02, 0x14, 0x0B, 0x10, 0x04, 0x1E, 0x0D, 0x12, 0x07,  // A-M
+    0x05, 0x0F, 0x16, 0x1B, 0x0A, 0x08, 0x03, 0x0C, 0x18, 0x0E, 0x19, 0x1D, 0x13,  // N-Z
+};
+
+static const uint8_t morseDigits[10] =
+{
+    0x3F, 0x3E, 0x3C, 0x38, 0x30, 0x20, 0x21, 0x23, 0x27, 0x2F,                    // 0-9
+};
+
+#define MORSE_SLASH 0x29                   // -..-.
+
+static uint8_t MorseCode(const char ch)
+{
+    if ((ch >= 'A') && (ch <= 'Z'))
+        return morseLetters[ch - 'A'];
+    if ((ch >= 'a') && (ch <= 'z'))
+        return morseLetters[ch - 'a'];
+    if ((ch >= '0') && (ch <= '9'))
+        return morseDigits[ch - '0'];
+    if (ch == '/')
+        return MORSE_SLASH;
+    return 0;
+}
+
+// Append a run, merging it with the previous one if the tone is the same
+static bool Append(QrssEvent *timeline, int *count, const int max, const uint8_t tone, uint8_t units)
+{
+    if (*count && (timeline[*count - 1].tone == tone) && (timeline[*count - 1].units + units <= 0xFF))
+    {
+        timeline[*count - 1].units += units;
+        return true;
+    }
+    if (*count >= max)
+        return false;
+
+    timeline[*count].tone = tone;
+    timeline[*count].units = units;
+    (*count)++;
+    return true;
+}
+
+// Compile text into a timeline. Returns the number of entries, 0 if the text has
+// characters without a Morse code or does not fit
+int QrssCompile(const char *text, const uint8_t style, QrssEvent *timeline, const int max)
+{
+    const uint8_t up = (style == QRSS_FSKCW) ? 0 : QRSS_TONE_OFF;
+    int count = 0;
+    bool ok = true;
+
+    if ((style == QRSS_NONE) || (style >= QRSS_STYLES))
+        return 0;
+
+    for (const char *p = text; *p && ok; p++)
+    {
+        if (*p == ' ')
+        {   // Word gap, the character gap before it is already there
+            if (count)
+                ok = Append(timeline, &count, max, up, 4);
+            continue;
+        }
+
+        uint8_t code = MorseCode(*p);
+        if (!code)
+            return 0;
+
+        for (; ok && (code > 1); code >>= 1)
+        {
+            bool dash = code & 0x01;
+            switch (style)
+            {
+                case QRSS_OOK:   ok = Append(timeline, &count, max, 0, dash ? 3 : 1); break;
+                case QRSS_FSKCW: ok = Append(timeline, &count, max, 1, dash ? 3 : 1); break;
+                default:         ok = Append(timeline, &count, max, dash ? 1 : 0, 1); break;
+            }
+            ok = ok && Append(timeline, &count, max, up, (code > 3) ? 1 : 3);   // Element or character gap
+        }
+    }
+
+    // The frame ends with the last element, not a gap
+    while (count && (timeline[count - 1].tone == up))
+        count--;
+    return ok ? count : 0;
+}
+
+// Length of a timeline in Morse units
+uint32_t QrssUnits(const QrssEvent *timeline, const int count)
+{
+    uint32_t units = 0;
+
+    for (int i = 0; i < count; i++)
+        units += timeline[i].units;
+    return units;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,31 @@
+#ifndef _QRSS_H
+#define _QRSS_H
+
+// Plain C++ so the keying timeline can also be built on a host
+#include <stdint.h>
+
+#define QRSS_EVENTS_MAX  200               // Run-length entries in a timeline, ~15 characters
+#define QRSS_TONE_OFF   0xFF               // Carrier off
+
+// Keying styles
+#define QRSS_NONE          0
+#define QRSS_OOK           1               // On/off keyed carrier on tone 0
+#define QRSS_FSKCW         2               // Key down on tone 1, key up on tone 0
+#define QRSS_DFCW          3               // Dots on tone 0, dashes on tone 1, both one unit long
+
+#define QRSS_STYLES        4
+
+// One run of the timeline: a tone held for a number of Morse units
+struct QrssEvent
+{
+    uint8_t tone;                          // Tone index or QRSS_TONE_OFF
+    uint8_t units;                         // Length in Morse units (dots)
+};
+
+// Function prototypes
+int QrssCompile(const char *text, const uint8_t style, QrssEvent *timeline, const int max);
+uint32_t QrssUnits(const QrssEvent *timeline, const int count);
+
+#endif // _QRSS_H
+
+// ----------------- EOF -------------------------------------------------------------------
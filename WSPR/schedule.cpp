@@ -0,0 +1,195 @@
+// Own include
+#include "schedule.h"
+
+// RFzero includes
+#include <RFzero.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "global.h"
+#include "config.h"
+#include "band.h"
+#include "telemetry.h"
+#include "txengine.h"
+
+// Slot calendar. Whether a slot is used follows from its start time alone, counted in
+// minutes since the RTC epoch, so a missed or skipped slot never shifts the ones after it.
+// A slot is used if its hour is not quiet, its bit is set in the hour's slot map, and
+// either it is a whole number of TX intervals from the epoch or, with a TX percentage,
+// a hash of the slot number and the seed falls below the percentage. The hash makes the
+// random choice repeatable, so the plan can be listed ahead.
+//
+// Bit n of an hour's slot map is the n'th slot of the hour in the mode's T/R period, the
+// one starting in minute 2n in WSPR-2 and in minute 15n in WSPR-15.
+//
+// With balloon telemetry on, the U4B channel fixes both: a slot is used if it starts in the
+// channel's minute of every 10 and its hour and slot bit allow it, and every frame goes
+// out on the channel's lane, see telemetry.cpp.
+//
+// The slot offset spreads the frames of several beacons on one frequency over the WSPR
+// window so they do not collide in the decoders. Random offsets are hashed from the slot
+// number and the processor serial number, so units with the same configuration still
+// differ. A pattern steps through up to eight set offsets, one per used slot
+
+static uint32_t slotMap[24];               // Slot bits per UTC hour
+static uint32_t quietHours = 0;            // Bit h: no TX in UTC hour h
+static uint8_t percent = 0;                // 0: every TX interval, 1 - 100: random TX percentage
+static uint32_t seed = 0;
+
+static uint8_t offsetMode = OFFSET_OFF;
+static uint8_t offsetWindow = 180;         // Hz, the frame stays inside it around the table frequency
+static int8_t offsetPattern[OFFSET_PATTERN_MAX];
+static uint8_t offsetCount = 0;            // Entries in the pattern
+static uint32_t unitHash = 0;              // Hash of the processor serial number
+
+// 32 bit integer hash with good avalanche
+static uint32_t Mix(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352DUL;
+    x ^= x >> 15;
+    x *= 0x846CA68BUL;
+    x ^= x >> 16;
+    return x;
+}
+
+// TX interval in whole slots
+static uint32_t Every()
+{
+    uint32_t period = TxEngineMode()->periodMinutes;
+    uint32_t every = (Interval + period - 1) / period;
+
+    return (percent || !every) ? 1 : every;
+}
+
+void SchedLoad()
+{
+    for (int h = 0; h < 24; h++)
+        slotMap[h] = eeprom.readInteger(EEPROM_SCHED_Slots + 4 * h, SCHED_ALL_SLOTS) & SCHED_ALL_SLOTS;
+
+    quietHours = eeprom.readInteger(EEPROM_SCHED_Quiet, 0);
+    if (quietHours & ~SCHED_ALL_HOURS)
+        quietHours = 0;                                // Unwritten EEPROM
+
+    percent = eeprom.readByte(EEPROM_SCHED_Percent, 0);
+    if (percent > 100)
+        percent = 0;
+    seed = eeprom.readInteger(EEPROM_SCHED_Seed, 0);
+
+    offsetMode = eeprom.readByte(EEPROM_OFFSET_Mode, OFFSET_OFF);
+    offsetWindow = eeprom.readByte(EEPROM_OFFSET_Window, 180);
+    offsetCount = eeprom.readByte(EEPROM_OFFSET_Count, 0);
+    if ((offsetMode >= OFFSET_MODES) || (offsetWindow > OFFSET_WINDOW_MAX))
+        offsetMode = OFFSET_OFF;
+    if (offsetCount > OFFSET_PATTERN_MAX)
+        offsetCount = 0;
+    for (int i = 0; i < offsetCount; i++)
+        offsetPattern[i] = (int8_t) eeprom.readByte(EEPROM_OFFSET_Pattern + i, 0);
+    if ((offsetMode == OFFSET_PATTERN) && !offsetCount)
+        offsetMode = OFFSET_OFF;
+
+    // The 128 bit serial number, SAM D21 datasheet 10.3.3
+    unitHash = Mix(*(const uint32_t *) 0x0080A00CUL ^ Mix(*(const uint32_t *) 0x0080A040UL ^
+                   Mix(*(const uint32_t *) 0x0080A044UL ^ Mix(*(const uint32_t *) 0x0080A048UL))));
+}
+
+// True if the slot starting at minute, counted from the RTC epoch, is to be used
+bool SchedSlot(const uint32_t minute)
+{
+    uint32_t period = TxEngineMode()->periodMinutes;
+    uint32_t slot = minute / period;
+    int hour = (minute / 60) % 24;
+
+    if ((quietHours & (1UL << hour)) || !(slotMap[hour] & (1UL << ((minute % 60) / period))))
+        return false;
+
+    if (TelemetryOn())
+        return (int) (minute % 10) == TelemetryMinute();
+    if (percent)
+        return (Mix(slot ^ seed) % 100) < percent;
+    return !(slot % Every());
+}
+
+// Offset in Hz of the frame in the slot starting at minute. The frame stays inside the
+// window centred on the table frequency
+int SchedOffset(const uint32_t minute)
+{
+    const ModeDesc *mode = TxEngineMode();
+    uint32_t slot = minute / mode->periodMinutes;
+    int limit = (int) (offsetWindow - mode->tones * mode->spacing) / 2;
+
+    if (TelemetryOn())
+        return TelemetryLane();
+    if (limit <= 0)
+        return 0;
+    switch (offsetMode)
+    {
+        case OFFSET_RANDOM:
+            return (int) (Mix(slot ^ unitHash) % (2 * limit + 1)) - limit;
+
+        case OFFSET_PATTERN:
+            return constrain(offsetPattern[(slot / Every()) % offsetCount], -limit, limit);
+
+        default:
+            return 0;
+    }
+}
+
+int SchedOffsetMode()
+{
+    return offsetMode;
+}
+
+int SchedOffsetWindow()
+{
+    return offsetWindow;
+}
+
+uint32_t SchedSlots(const int hour)
+{
+    return slotMap[hour % 24];
+}
+
+uint32_t SchedQuiet()
+{
+    return quietHours;
+}
+
+int SchedPercent()
+{
+    return percent;
+}
+
+uint32_t SchedSeed()
+{
+    return seed;
+}
+
+// List the next count slots after minute and the band each would use
+void SchedPlan(const uint32_t minute, const int count)
+{
+    char buf[40];
+    uint32_t period = TxEngineMode()->periodMinutes;
+    uint32_t start = (minute / period + 1) * period;
+    int next = BandRotation();
+    int found = 0;
+
+    for (uint32_t m = start; (found < count) && (m < start + 2 * 24 * 60); m += period)
+    {
+        if (!SchedSlot(m))
+            continue;
+
+        int band = BandPreview((m / 60) % 24, m % 60, &next);
+        if (band == BAND_NONE)
+            continue;
+        if (band == TX_TABLE_BEACON)
+            sprintf(buf, "  %02d:%02d  beacon   %+4d Hz", (int) ((m / 60) % 24), (int) (m % 60), SchedOffset(m));
+        else
+            sprintf(buf, "  %02d:%02d  band %-2d  %+4d Hz", (int) ((m / 60) % 24), (int) (m % 60), band + 1, SchedOffset(m));
+        SerialUSB.println(buf);
+        found++;
+    }
+    if (!found)
+        SerialUSB.println("  No slot in the next 48 hours");
+}
+
+// ----------------- EOF -------------------------------------------------------------------
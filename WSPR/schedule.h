@@ -0,0 +1,34 @@
+#ifndef _SCHEDULE_H
+#define _SCHEDULE_H
+
+// Arduino includes
+#include <Arduino.h>
+
+#define SCHED_ALL_SLOTS   0x3FFFFFFFUL     // Bit n: the n'th slot of the hour in the mode's T/R period
+#define SCHED_ALL_HOURS   0x00FFFFFFUL     // Bit h: UTC hour h
+#define SCHED_PLAN_MAX    100              // Most slots rd slots lists
+
+// Slot offset modes, where in the WSPR window a frame is placed
+#define OFFSET_OFF        0                // On the table frequency
+#define OFFSET_RANDOM     1                // Pseudo random per slot and unit
+#define OFFSET_PATTERN    2                // Next entry of the offset pattern
+#define OFFSET_MODES      3
+
+#define OFFSET_PATTERN_MAX 8               // Entries in the offset pattern
+#define OFFSET_WINDOW_MAX 200              // Hz, the WSPR sub-band
+
+// Function prototypes
+void SchedLoad();
+bool SchedSlot(const uint32_t minute);
+uint32_t SchedSlots(const int hour);
+uint32_t SchedQuiet();
+int SchedPercent();
+uint32_t SchedSeed();
+void SchedPlan(const uint32_t minute, const int count);
+int SchedOffset(const uint32_t minute);
+int SchedOffsetMode();
+int SchedOffsetWindow();
+
+#endif // _SCHEDULE_H
+
+// ----------------- EOF -------------------------------------------------------------------
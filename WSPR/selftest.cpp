@@ -0,0 +1,359 @@
+// Own include
+#include "selftest.h"
+
+// Program includes. Located in the same directory as the .ino file
+#include "fmt.h"
+#include "wspr.h"
+#include "mode.h"
+#include "tones.h"
+
+// No RFzero includes, so the tools can run the same vectors on the host, see tools/wsprcheck.cpp
+
+// Golden WSPR vectors. The first is the K1ABC FN42 37 example from the WSJT documentation,
+// the rest cover every power level accepted by LoadConfiguration() and both call sign alignments.
+// Symbols are packed four per byte, first symbol in the most significant bits
+struct WsprVector
+{
+    const char *call;
+    const char *locator;
+    int power;
+    uint8_t packed[(WSPR_SYMBOL_COUNT + 3) / 4];
+};
+
+static const WsprVector wsprVectors[] =
+{
+    { "K1ABC", "FN42", 37,
+      { 0xF0, 0x80, 0x48, 0x76, 0xA4, 0x3B, 0x7E, 0x88, 0x0E, 0x1B, 0xA0, 0xAE, 0x52, 0xF9,
+        0x29, 0xE6, 0xA3, 0xCC, 0xC6, 0x49, 0x8E, 0x78, 0x3E, 0xCE, 0x8C, 0x88, 0x4B, 0x25,
+        0x6F, 0x2D, 0x9A, 0x9F, 0x80, 0x13, 0x87, 0xAA, 0x8B, 0xEE, 0xF8, 0x36, 0xA0 } },
+    { "OZ2M", "JO65", 0,
+      { 0xD2, 0x0A, 0xC8, 0x74, 0x06, 0x91, 0x56, 0x08, 0xAC, 0x19, 0x08, 0xA4, 0x50, 0xF1,
+        0x03, 0x44, 0x01, 0x4C, 0x4C, 0xC1, 0x2C, 0xD2, 0x16, 0xEC, 0x04, 0x80, 0x49, 0x25,
+        0x45, 0x8D, 0x30, 0x15, 0xA2, 0x99, 0x25, 0xA0, 0x8B, 0x6E, 0x78, 0x94, 0x80 } },
+    { "G4ABC", "IO91", 3,
+      { 0xFA, 0x0A, 0x40, 0xFE, 0x84, 0x91, 0x54, 0x08, 0x04, 0x39, 0x08, 0x86, 0x58, 0xD9,
+        0x03, 0xC6, 0x83, 0xE6, 0xE6, 0xC1, 0xA6, 0xF0, 0x9C, 0xE4, 0x84, 0x0A, 0xE1, 0x85,
+        0x67, 0xA7, 0xB2, 0xBF, 0xAA, 0x13, 0x8F, 0x00, 0xAB, 0x4C, 0x72, 0xB4, 0x80 } },
+    { "PA0XYZ", "JO22", 7,
+      { 0xD0, 0x28, 0xE2, 0xFC, 0x0E, 0x99, 0x7C, 0xA2, 0x8C, 0x31, 0x22, 0x04, 0x70, 0x53,
+        0x01, 0xCE, 0x09, 0xE4, 0xE4, 0xC3, 0x26, 0x58, 0x16, 0x44, 0x06, 0x28, 0xE3, 0xA7,
+        0x67, 0x07, 0xB0, 0xB7, 0x82, 0x39, 0x85, 0x2A, 0xA1, 0x44, 0xD2, 0x3C, 0xA0 } },
+    { "9A1A", "JN75", 10,
+      { 0x5A, 0xA8, 0xE8, 0xFC, 0xA4, 0xB9, 0xFC, 0x02, 0x2E, 0x19, 0xAA, 0xA4, 0xF0, 0x7B,
+        0x0B, 0xE4, 0x2B, 0xC6, 0xCE, 0xC1, 0x8C, 0x58, 0x1C, 0x6E, 0x84, 0x02, 0x49, 0xAF,
+        0xE5, 0x07, 0x10, 0x35, 0x0A, 0x33, 0x2D, 0x2A, 0x01, 0x4C, 0xD8, 0x3E, 0x80 } },
+    { "VK2RH", "QF56", 13,
+      { 0xFA, 0x2A, 0x4A, 0x74, 0xA4, 0x11, 0xDE, 0x80, 0x0C, 0x91, 0x80, 0x04, 0xD2, 0x79,
+        0x83, 0x6E, 0xA9, 0x46, 0x6C, 0x6B, 0x86, 0xD2, 0xB6, 0x46, 0x0C, 0x8A, 0xE3, 0x05,
+        0x6D, 0x2D, 0x92, 0x9F, 0x88, 0x93, 0x8D, 0x00, 0x2B, 0xCE, 0xF8, 0x16, 0x20 } },
+    { "W1AW", "FN31", 17,
+      { 0xF8, 0x80, 0x6A, 0xFE, 0xAE, 0xB1, 0xFE, 0x02, 0x06, 0x13, 0x8A, 0x0C, 0xF8, 0x53,
+        0x89, 0x6E, 0x81, 0xE4, 0x64, 0x6B, 0x24, 0x78, 0x1E, 0x66, 0xA6, 0x02, 0x69, 0xA7,
+        0xC5, 0x25, 0x9A, 0x1F, 0xAA, 0x91, 0x0F, 0xA2, 0xA1, 0xEE, 0x50, 0x1E, 0x80 } },
+    { "JA1XYZ", "PM95", 20,
+      { 0xD2, 0x0A, 0x40, 0xF4, 0x04, 0x1B, 0xFE, 0xA2, 0x8C, 0xB9, 0x2A, 0x06, 0x7A, 0xD9,
+        0xA3, 0x44, 0x21, 0x4E, 0x6C, 0x4B, 0xA4, 0xD8, 0x1C, 0xEC, 0xAE, 0xAA, 0xC9, 0x27,
+        0x6F, 0x2F, 0x98, 0x35, 0xA0, 0x3B, 0x27, 0x20, 0x21, 0xC4, 0xF2, 0x1C, 0x00 } },
+    { "ZS6AB", "KG33", 23,
+      { 0xD0, 0x20, 0xC8, 0x76, 0x84, 0x93, 0xD4, 0x0A, 0x24, 0xB3, 0xA2, 0x84, 0x7A, 0xD1,
+        0x2B, 0xE6, 0x8B, 0x46, 0xC6, 0xEB, 0x8E, 0xF2, 0x36, 0x64, 0x8E, 0x20, 0x69, 0xAF,
+        0xC7, 0x25, 0x92, 0x3F, 0x80, 0xB3, 0x25, 0xA0, 0x8B, 0xC6, 0xDA, 0xB4, 0xA0 } },
+    { "K9AN", "EN50", 27,
+      { 0xF8, 0x02, 0x60, 0x76, 0xAC, 0xB3, 0x54, 0x00, 0x0C, 0x93, 0xA2, 0x84, 0x78, 0x51,
+        0x01, 0x4E, 0x89, 0xC6, 0xE4, 0xC3, 0xAE, 0x72, 0x14, 0x64, 0x86, 0x22, 0x4B, 0x2D,
+        0x6D, 0xA7, 0x18, 0x1F, 0xA0, 0x9B, 0xAF, 0x08, 0x81, 0x6C, 0xFA, 0x14, 0xA0 } },
+    { "5Q7J", "JO55", 30,
+      { 0x50, 0x00, 0xC0, 0xFC, 0x06, 0x93, 0x54, 0x20, 0x0E, 0xBB, 0x02, 0x06, 0xF0, 0xF3,
+        0x21, 0xE4, 0x09, 0x66, 0x4C, 0x43, 0x0C, 0xF2, 0x3E, 0xCE, 0xAC, 0x80, 0x43, 0xA5,
+        0xC7, 0x25, 0x1A, 0x9D, 0x22, 0x39, 0x27, 0x2A, 0xA9, 0xE6, 0xD8, 0x36, 0xA0 } },
+    { "OZ5N", "JO55", 33,
+      { 0xD8, 0x22, 0xE8, 0xF4, 0x04, 0x3B, 0x74, 0xA2, 0x86, 0x19, 0x02, 0x84, 0x5A, 0xF3,
+        0x0B, 0x6E, 0x03, 0xC4, 0x6E, 0x63, 0x06, 0x78, 0x36, 0xC6, 0x0E, 0x2A, 0x41, 0x8F,
+        0x67, 0xA5, 0x10, 0x1F, 0xA0, 0x19, 0x0F, 0x28, 0x8B, 0x4E, 0x50, 0x3E, 0xA0 } },
+    { "OZ2XH", "JO45", 37,
+      { 0xDA, 0x28, 0xC0, 0xFE, 0x06, 0x99, 0x56, 0xA8, 0xAE, 0x19, 0x20, 0x2E, 0x50, 0x71,
+        0x23, 0x4E, 0x09, 0x66, 0x4E, 0xE9, 0x2E, 0x78, 0x34, 0x46, 0x2E, 0x82, 0x63, 0x0D,
+        0x65, 0xAD, 0x3A, 0xB7, 0x82, 0x93, 0x27, 0x0A, 0x83, 0x4E, 0x52, 0xB6, 0xA0 } },
+    { "DL1ABC", "JO62", 40,
+      { 0x70, 0x82, 0x42, 0x5E, 0x8E, 0xB9, 0x76, 0x88, 0x8E, 0xB3, 0xA8, 0xAE, 0x50, 0xF9,
+        0x29, 0x4C, 0x81, 0x46, 0x6C, 0xE3, 0xAE, 0xD8, 0x9C, 0x4C, 0x84, 0x88, 0xE9, 0x2D,
+        0xCF, 0x05, 0x92, 0x3D, 0x08, 0x1B, 0x85, 0x22, 0x29, 0xCE, 0xD0, 0x9C, 0x00 } },
+    { "F5XYZ", "JN18", 43,
+      { 0xD8, 0x0A, 0x68, 0xD4, 0x8C, 0x11, 0x7E, 0xA8, 0x0E, 0xB3, 0x28, 0x0C, 0x72, 0x59,
+        0xAB, 0x66, 0xA9, 0xEC, 0xCC, 0xE3, 0xA6, 0x7A, 0x16, 0xC4, 0xAE, 0x22, 0xEB, 0x05,
+        0x47, 0x8F, 0x12, 0x3F, 0x80, 0x31, 0xA7, 0x2A, 0xA3, 0xCC, 0x52, 0x14, 0x80 } },
+    { "LA9JO", "JP99", 47,
+      { 0xF0, 0xA2, 0x4A, 0xF6, 0x0E, 0x91, 0xFE, 0x0A, 0x8C, 0x31, 0x80, 0x26, 0xFA, 0x53,
+        0xA9, 0x46, 0x23, 0xEC, 0x6C, 0x61, 0x0E, 0x5A, 0x94, 0x44, 0x8C, 0x00, 0xE9, 0x0F,
+        0xC5, 0x2F, 0xB8, 0xB7, 0xAA, 0xB9, 0x05, 0x20, 0x21, 0x44, 0xF8, 0x14, 0x00 } },
+    { "KH6RS", "BL11", 50,
+      { 0xD2, 0x2A, 0xC8, 0xD4, 0x2C, 0x9B, 0x7C, 0x22, 0xA4, 0xBB, 0x28, 0x0E, 0xD2, 0xD9,
+        0x89, 0xCC, 0x29, 0x6C, 0xCC, 0xCB, 0x2E, 0x50, 0x34, 0x4E, 0xA4, 0x22, 0xC3, 0x27,
+        0x65, 0x05, 0xBA, 0x35, 0x8A, 0xB9, 0x25, 0xA2, 0x21, 0xCE, 0xF8, 0x36, 0x20 } },
+    { "VE3ABC", "FN03", 53,
+      { 0xD2, 0x0A, 0x68, 0x54, 0xA6, 0x31, 0xF6, 0x20, 0x06, 0xB9, 0x02, 0x06, 0xF2, 0x5B,
+        0xA1, 0x4E, 0x89, 0x4E, 0x46, 0xE9, 0xAE, 0x72, 0x3C, 0xCE, 0x2E, 0x28, 0x63, 0x0D,
+        0x47, 0xAF, 0x1A, 0x9F, 0x8A, 0x33, 0x87, 0x80, 0x2B, 0x4C, 0x7A, 0x1E, 0x20 } },
+    { "2E0ABC", "IO83", 57,
+      { 0x7A, 0x8A, 0xEA, 0x54, 0x84, 0x93, 0x5E, 0x22, 0x2E, 0x91, 0x82, 0x26, 0xF8, 0x53,
+        0x89, 0xCE, 0x01, 0xCE, 0x44, 0xC1, 0x06, 0xD2, 0x94, 0x4E, 0x24, 0x88, 0x61, 0x8F,
+        0x6F, 0x8D, 0xB0, 0x37, 0x28, 0xB1, 0x07, 0x08, 0xA3, 0x4E, 0x5A, 0x36, 0x20 } },
+    { "EA8BFK", "IL18", 60,
+      { 0x58, 0x08, 0x60, 0x76, 0x2C, 0x9B, 0x74, 0x02, 0x86, 0x93, 0xA2, 0x8C, 0xF2, 0x59,
+        0x83, 0xCC, 0x81, 0x64, 0x64, 0xC1, 0x2E, 0x72, 0xBE, 0xE4, 0x24, 0x8A, 0xE9, 0x27,
+        0xCF, 0x8F, 0xB0, 0xBD, 0x08, 0xB3, 0xA5, 0x02, 0x2B, 0x64, 0x5A, 0x9C, 0x80 } },
+};
+
+// Type 2 and type 3 vectors for compound calls and 6 character locators, checked against
+// independent encoder and decoder implementations. The type 2 ones have no locator
+struct WsprVectorType
+{
+    uint8_t type;
+    const char *call;
+    const char *locator;
+    int power;
+    uint8_t packed[(WSPR_SYMBOL_COUNT + 3) / 4];
+};
+
+static const WsprVectorType wsprTypeVectors[] =
+{
+    { WSPR_TYPE2, "PA/OZ2M", NULL, 37,
+      { 0xD2, 0x02, 0xC8, 0x5C, 0x26, 0xB1, 0x7C, 0x02, 0xAE, 0x3B, 0x28, 0x84, 0x52, 0xD9,
+        0x23, 0x6E, 0x23, 0x44, 0x4E, 0xCB, 0x0E, 0xD2, 0x1C, 0xCC, 0x24, 0x88, 0x69, 0x2F,
+        0x65, 0x85, 0x3A, 0x3F, 0x80, 0x93, 0x25, 0xA2, 0x89, 0x46, 0x52, 0x9C, 0xA0 } },
+    { WSPR_TYPE2, "PJ4/K1ABC", NULL, 30,
+      { 0xD2, 0xA0, 0x4A, 0x74, 0x86, 0x39, 0x74, 0x88, 0x2E, 0x33, 0x82, 0xA4, 0x70, 0xD3,
+        0x03, 0xCC, 0xA3, 0xE4, 0xE4, 0x41, 0x8C, 0x78, 0x1E, 0xEC, 0xAE, 0xA0, 0x69, 0x25,
+        0x4F, 0x2F, 0xB0, 0xBD, 0x80, 0x33, 0x85, 0xA8, 0xA9, 0xCC, 0xF2, 0x34, 0xA0 } },
+    { WSPR_TYPE2, "K1ABC/P", NULL, 10,
+      { 0xD0, 0x82, 0x6A, 0x54, 0x84, 0x1B, 0x5C, 0xA2, 0x0C, 0x3B, 0x80, 0xAC, 0x70, 0xF1,
+        0x03, 0xEC, 0xA3, 0xEE, 0xC4, 0x41, 0x8C, 0x72, 0x14, 0xCC, 0xAE, 0x80, 0x4B, 0x07,
+        0x4F, 0x07, 0x92, 0xBD, 0x80, 0x13, 0x85, 0x80, 0xA9, 0xC4, 0xF8, 0x3C, 0x80 } },
+    { WSPR_TYPE2, "G4ABC/12", NULL, 60,
+      { 0xF8, 0x0A, 0x62, 0xF4, 0x86, 0x93, 0x5C, 0x28, 0x06, 0x1B, 0x0A, 0xAE, 0x78, 0xD1,
+        0x0B, 0xC4, 0xA1, 0xCC, 0xC6, 0xEB, 0xA4, 0xF8, 0xBC, 0xEE, 0xA6, 0x28, 0xC3, 0xAD,
+        0x67, 0x87, 0x98, 0xBD, 0xAA, 0x33, 0x8D, 0x22, 0x89, 0x64, 0x5A, 0xB6, 0xA0 } },
+    { WSPR_TYPE2, "3DA/ZS6AB", NULL, 23,
+      { 0xF0, 0x28, 0xCA, 0x7C, 0x86, 0xBB, 0xF6, 0x20, 0x04, 0xBB, 0x80, 0xAE, 0x7A, 0xD9,
+        0x23, 0xCC, 0x8B, 0x6C, 0xE4, 0xE3, 0xAC, 0xF0, 0x3E, 0x6C, 0x8C, 0x08, 0x69, 0x85,
+        0xE5, 0x2D, 0xB0, 0x3D, 0x80, 0xB3, 0x27, 0x80, 0xA9, 0xEE, 0xD8, 0xBC, 0xA0 } },
+    { WSPR_TYPE3, "PA/OZ2M", "JO65AB", 37,
+      { 0xF2, 0x80, 0x60, 0xD6, 0x2E, 0xB9, 0x5E, 0x8A, 0x86, 0x19, 0x8A, 0x24, 0xD0, 0xD9,
+        0x0B, 0x44, 0x0B, 0xE6, 0x4C, 0xC9, 0x84, 0xD8, 0x34, 0xE6, 0x06, 0x08, 0x41, 0x8F,
+        0x6F, 0x0D, 0xB0, 0x9D, 0xA0, 0x1B, 0x87, 0xA8, 0xA3, 0x64, 0xF2, 0x36, 0xA0 } },
+    { WSPR_TYPE3, "K1ABC", "FN42AB", 37,
+      { 0xFA, 0x82, 0xE0, 0xF6, 0x8E, 0x9B, 0x5E, 0x02, 0x8E, 0xB9, 0xA2, 0x24, 0x72, 0x51,
+        0xA1, 0x4C, 0x21, 0x4E, 0xEC, 0xE1, 0x04, 0x50, 0xB6, 0xEE, 0x84, 0x82, 0xE9, 0x07,
+        0xCF, 0x0D, 0x38, 0x1D, 0x82, 0xB9, 0xA7, 0x80, 0xA9, 0x44, 0x52, 0xBE, 0x20 } },
+    { WSPR_TYPE3, "OZ2M", "JO65MR", 0,
+      { 0xDA, 0x8A, 0x6A, 0xD4, 0x06, 0x19, 0x5E, 0xA2, 0x8C, 0xB3, 0x80, 0x26, 0xD0, 0x79,
+        0x2B, 0xCE, 0x23, 0xEE, 0x6E, 0x49, 0x84, 0x72, 0x3E, 0xEC, 0x06, 0x82, 0x61, 0x27,
+        0x67, 0x05, 0xB2, 0x37, 0x82, 0x19, 0xAD, 0x2A, 0x89, 0x6C, 0xFA, 0x1C, 0xA0 } },
+    { WSPR_TYPE3, "G4ABC/12", "IO91WM", 60,
+      { 0xD2, 0x02, 0x6A, 0x5E, 0x2E, 0x11, 0xDE, 0x28, 0xAE, 0x31, 0x8A, 0x0E, 0xF0, 0xF1,
+        0xA1, 0xCE, 0x29, 0xC6, 0x46, 0xC1, 0xA6, 0xF2, 0x36, 0xC4, 0x24, 0x8A, 0x63, 0x0D,
+        0x45, 0xA7, 0xB2, 0xBF, 0xA0, 0x19, 0xAF, 0x80, 0xA3, 0x66, 0x72, 0xBC, 0x80 } },
+};
+
+// Type 3 call hashes, lookup3 with init value 146, 15 bits
+struct WsprHash
+{
+    const char *call;
+    uint16_t hash;
+};
+
+static const WsprHash wsprHashes[] =
+{
+    { "K1ABC", 6521 },
+    { "PA/OZ2M", 17246 },
+    { "OZ2M", 26064 },
+    { "PJ4/K1ABC", 19735 },
+};
+
+// Messages that must be rejected
+struct WsprReject
+{
+    const char *call;
+    const char *locator;
+    int power;
+};
+
+static const WsprReject wsprRejects[] =
+{
+    { "K1ABC",   "FN42", 5 },                       // Illegal power level
+    { "K1ABC",   "FN42", 61 },
+    { "K1ABC",   "SS00", 37 },                      // Locator field out of range
+    { "K1ABC",   "FN4",  37 },
+    { "ABCDEF",  "FN42", 37 },                      // No digit in the call
+    { "PA0XYZA", "JO22", 37 },                      // Too long for a type 1 message
+};
+
+// Compound calls that must be rejected by the type 2 encoder
+static const char *wsprType2Rejects[] =
+{
+    "K1ABC",                                        // No prefix or suffix
+    "K1ABC/QRP",                                    // Suffix longer than one letter or two digits
+    "ABCD/K1ABC",                                   // Prefix longer than three characters
+    "PA/ABCDEF",                                    // Base call without a digit
+    "A/B/K1ABC",
+};
+
+// Dial + 1500 Hz of the WSPR sub bands plus the ends of the accepted frequency range
+static const double toneFrequencies[] =
+{
+    100000.0, 137500.0, 475700.0, 1838100.0, 3570100.0, 5288700.0, 7040100.0, 10140200.0, 14097100.0,
+    18106100.0, 21096100.0, 24926100.0, 28126100.0, 40663500.0, 50294500.0, 70092500.0, 144490500.0, 200000000.0,
+};
+
+#define TONE_TOLERANCE 0.01                         // Max tone frequency error in Hz
+
+static int TestEncoder()
+{
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+    uint8_t expected[WSPR_SYMBOL_COUNT];
+    char buf[80];
+    int failed = 0;
+
+    for (uint32_t i = 0; i < sizeof(wsprVectors) / sizeof(wsprVectors[0]); i++)
+    {
+        const WsprVector *v = &wsprVectors[i];
+        bool ok = WsprEncodeType1(v->call, v->locator, v->power, symbols);
+
+        WsprUnpackSymbols(v->packed, expected);
+        ok = ok && (0 == memcmp(symbols, expected, WSPR_SYMBOL_COUNT));
+        if (!ok)
+        {
+            sprintf(buf, "FAIL  encode %s %s %d", v->call, v->locator, v->power);
+            SerialUSB.println(buf);
+            failed++;
+        }
+    }
+
+    for (uint32_t i = 0; i < sizeof(wsprRejects) / sizeof(wsprRejects[0]); i++)
+    {
+        const WsprReject *r = &wsprRejects[i];
+        if (WsprEncodeType1(r->call, r->locator, r->power, symbols))
+        {
+            sprintf(buf, "FAIL  reject %s %s %d", r->call, r->locator, r->power);
+            SerialUSB.println(buf);
+            failed++;
+        }
+    }
+
+    for (uint32_t i = 0; i < sizeof(wsprTypeVectors) / sizeof(wsprTypeVectors[0]); i++)
+    {
+        const WsprVectorType *v = &wsprTypeVectors[i];
+        bool ok = (v->type == WSPR_TYPE2) ? WsprEncodeType2(v->call, v->power, symbols) : WsprEncodeType3(v->call, v->locator, v->power, symbols);
+
+        WsprUnpackSymbols(v->packed, expected);
+        ok = ok && (0 == memcmp(symbols, expected, WSPR_SYMBOL_COUNT));
+        if (!ok)
+        {
+            sprintf(buf, "FAIL  encode type %d %s %s %d", v->type, v->call, v->locator ? v->locator : "", v->power);
+            SerialUSB.println(buf);
+            failed++;
+        }
+    }
+
+    for (uint32_t i = 0; i < sizeof(wsprHashes) / sizeof(wsprHashes[0]); i++)
+    {
+        if (WsprCallHash(wsprHashes[i].call) != wsprHashes[i].hash)
+        {
+            sprintf(buf, "FAIL  hash %s", wsprHashes[i].call);
+            SerialUSB.println(buf);
+            failed++;
+        }
+    }
+
+    for (uint32_t i = 0; i < sizeof(wsprType2Rejects) / sizeof(wsprType2Rejects[0]); i++)
+    {
+        if (WsprEncodeType2(wsprType2Rejects[i], 37, symbols))
+        {
+            sprintf(buf, "FAIL  reject type 2 %s", wsprType2Rejects[i]);
+            SerialUSB.println(buf);
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+// Every frame of every mode must carry the mode's sync pattern
+static int TestModes()
+{
+    uint8_t rotation[WSPR_ROTATION_MAX][MODE_SYMBOLS_MAX];
+    uint8_t types[WSPR_ROTATION_MAX];
+    char buf[80];
+    int failed = 0;
+
+    for (int m = 0; m < MODE_COUNT; m++)
+    {
+        const ModeDesc *mode = ModeGet(m);
+        int frames = mode->encode("PJ4/K1ABC", "FN42AB", 37, rotation, types);
+        bool ok = frames > 0;
+
+        for (int i = 0; ok && (i < frames); i++)
+            ok = ModeSyncOk(mode, rotation[i]);
+        if (!ok)
+        {
+            sprintf(buf, "FAIL  sync %s", mode->name);
+            SerialUSB.println(buf);
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+static int TestTones(const double fref)
+{
+    ToneTable table;
+    char buf[80];
+    int failed = 0;
+
+    for (uint32_t i = 0; i < sizeof(toneFrequencies) / sizeof(toneFrequencies[0]); i++)
+    {
+        double carrier = toneFrequencies[i];
+        bool ok = ToneCalculate(fref, carrier, WSPR_TONE_SPACING, WSPR_TONE_COUNT, &table);
+
+        for (int n = 0; ok && (n < WSPR_TONE_COUNT); n++)
+        {
+            const uint8_t *pll = (table.toneReg == SI5351_REG_PLLA) ? table.tone[n] : table.pll;
+            const uint8_t *ms = (table.toneReg == SI5351_REG_PLLA) ? table.ms : table.tone[n];
+
+            ok = fabs(ToneFrequency(fref, pll, ms) - (carrier + n * WSPR_TONE_SPACING)) < TONE_TOLERANCE;
+        }
+
+        if (!ok)
+        {
+            FmtStr(FmtUint(FmtStr(buf, "FAIL  tones "), (uint32_t) carrier), " Hz");
+            SerialUSB.println(buf);
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+// Run all self tests, print failures and a summary. The tones are also checked with fref,
+// the measured reference once calibrated, if it is not 0. Returns the number of failures
+int SelfTest(const double fref)
+{
+    char buf[60];
+    int failed = 0;
+
+    failed += TestEncoder();
+    failed += TestModes();
+    failed += TestTones(27000000.0);
+    if (fref > 0.0)
+        failed += TestTones(fref);
+
+    sprintf(buf, "%d vectors, %d tone sets: %s", (int) (sizeof(wsprVectors) / sizeof(wsprVectors[0]) + sizeof(wsprRejects) / sizeof(wsprRejects[0]) +
+            sizeof(wsprTypeVectors) / sizeof(wsprTypeVectors[0]) + sizeof(wsprHashes) / sizeof(wsprHashes[0]) + sizeof(wsprType2Rejects) / sizeof(wsprType2Rejects[0]) + MODE_COUNT),
+            (int) (((fref > 0.0) ? 2 : 1) * sizeof(toneFrequencies) / sizeof(toneFrequencies[0])), failed ? "FAILED" : "PASSED");
+    SerialUSB.println(buf);
+
+    return failed;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,12 @@
+#ifndef _SELFTEST_H
+#define _SELFTEST_H
+
+// Arduino includes
+#include <Arduino.h>
+
+// Function prototypes
+int SelfTest(const double fref);
+
+#endif // _SELFTEST_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,596 @@
+// Own include
+#include "settings.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "config.h"
+#include "band.h"
+#include "clock.h"
+#include "message.h"
+#include "mode.h"
+#include "profiles.h"
+#include "qrss.h"
+#include "schedule.h"
+#include "telemetry.h"
+#include "wspr.h"
+
+// The configuration commands. Every "wr" command that only writes the EEPROM is parsed,
+// range checked and stored here, and so are the "wr defaults" values and the signature
+// boot.cpp keeps of the running configuration. ParseCommand() runs them on the EEPROM,
+// wsprbatch on the images it provisions, so a beacon reads an image exactly as if the
+// commands had been typed on it. No RFzero includes, the EEPROM is reached through the
+// read and write functions
+
+const SettingField settingFields[] =
+{
+    { EEPROM_HW_RefStartFreq, 4 },
+    { EEPROM_HW_T1, 1 },
+    { EEPROM_HW_DisplayMode, 1 },
+    { EEPROM_HW_WarmUp, 1 },
+    { EEPROM_GPS_Echo, 1 },
+    { EEPROM_COMMON_Locator, 9 },
+    { EEPROM_BEACON_Frequency, 8 },
+    { EEPROM_BEACON_CalibInterval, 1 },
+    { EEPROM_BEACON_Call, 16 },
+    { EEPROM_BEACON_WSPRPower, 1 },
+    { EEPROM_BEACON_Interval, 1 },
+    { EEPROM_BAND_HopMode, 1 },
+    { EEPROM_BAND_Enable, 2 },
+    { EEPROM_BAND_Freq, 4 * BANDS_MAX },
+    { EEPROM_BAND_Hour, 12 },
+    { EEPROM_BEACON_Mode, 1 },
+    { EEPROM_QRSS_Style, 1 },
+    { EEPROM_QRSS_Dot, 1 },
+    { EEPROM_QRSS_Shift, 1 },
+    { EEPROM_QRSS_Every, 1 },
+    { EEPROM_QRSS_Frequency, 4 },
+    { EEPROM_OUT_Drive0, 1 },
+    { EEPROM_OUT_Drive1, 1 },
+    { EEPROM_OUT_Enable1, 1 },
+    { EEPROM_OUT_Power1, 1 },
+    { EEPROM_OUT_Frequency1, 4 },
+    { EEPROM_PA_Lead, 1 },
+    { EEPROM_PA_Ramp, 1 },
+    { EEPROM_PA_Hold, 1 },
+    { EEPROM_BOOT_Signature, 2 },
+    { EEPROM_SCHED_Slots, 4 * 24 },
+    { EEPROM_SCHED_Quiet, 4 },
+    { EEPROM_SCHED_Percent, 1 },
+    { EEPROM_SCHED_Seed, 4 },
+    { EEPROM_OFFSET_Mode, 1 },
+    { EEPROM_OFFSET_Window, 1 },
+    { EEPROM_OFFSET_Count, 1 },
+    { EEPROM_OFFSET_Pattern, OFFSET_PATTERN_MAX },
+    { EEPROM_TELEM_Channel, 2 },
+    { EEPROM_TELEM_VoltPin, 1 },
+    { EEPROM_TELEM_VoltScale, 1 },
+    { EEPROM_MSG_Table, MSG_MAX * MSG_ENTRY_SIZE },
+    { EEPROM_MSG_PatternCount, 1 },
+    { EEPROM_MSG_Pattern, MSG_PATTERN_MAX },
+    { EEPROM_GPS_Delay, 4 },
+};
+
+const int settingFieldCount = sizeof(settingFields) / sizeof(settingFields[0]);
+
+// Dial + 1500 Hz, in the order of the WSJT-X coordinated hopping plan where band n is
+// used in the n'th 2 minute slot of every 20 minutes
+static const uint32_t bandDefault[BANDS_MAX] =
+{
+    1838100, 3570100, 5288700, 7040100, 10140200, 14097100, 18106100, 21096100, 24926100, 28126100,
+};
+
+uint32_t SettingBandDefault(const int band)
+{
+    return ((band >= 0) && (band < BANDS_MAX)) ? bandDefault[band] : 0;
+}
+
+// Analog input n of wr telemv, An. The rotary encoder has A0 - A2 in builds with the LCD
+bool SettingVoltInput(const int input)
+{
+    return (input >= (FEATURE_LCD ? 3 : 0)) && (input < SETTING_VOLT_INPUTS);
+}
+
+static bool ValidFrequency(const double freq)
+{
+    return (SETTING_FREQ_MIN <= freq) && (freq <= SETTING_FREQ_MAX);
+}
+
+static void PutBytes(SettingWriteFunc write, const uint16_t address, const void *value, const int size)
+{
+    for (int i = 0; i < size; i++)
+        write(address + i, ((const uint8_t *) value)[i]);
+}
+
+static void PutInt32(SettingWriteFunc write, const uint16_t address, const int32_t value)
+{
+    PutBytes(write, address, &value, 4);
+}
+
+// A string of at most size - 1 characters in upper case, the rest of the field 0
+static void PutString(SettingWriteFunc write, const uint16_t address, const char *s, const int size)
+{
+    int len = strlen(s);
+
+    for (int i = 0; i < size; i++)
+        write(address + i, (i < len) && (i < size - 1) ? toupper((unsigned char) s[i]) : 0);
+}
+
+// wr defaults. Call, locator and beacon frequency are kept
+static void Defaults(SettingWriteFunc write)
+{
+    // HARDWARE
+    PutInt32(write, EEPROM_HW_RefStartFreq, 27000000L);
+    write(EEPROM_HW_T1, 0);
+    write(EEPROM_HW_DisplayMode, 1);
+    write(EEPROM_HW_WarmUp, 0);
+
+    // GPS
+    write(EEPROM_GPS_Echo, 0);
+    PutInt32(write, EEPROM_GPS_Delay, CLOCK_NMEA_DELAY_MS);
+
+    // BEACON
+    write(EEPROM_BEACON_CalibInterval, 5);
+    write(EEPROM_BEACON_Interval, 2);
+
+    // WSPR
+    write(EEPROM_BEACON_WSPRPower, 13);
+    write(EEPROM_BEACON_Mode, MODE_WSPR2);
+
+    // BAND HOPPING
+    write(EEPROM_BAND_HopMode, HOP_OFF);
+    write(EEPROM_BAND_Enable, 0);
+    write(EEPROM_BAND_Enable + 1, 0);
+    for (int i = 0; i < BANDS_MAX; i++)
+        PutInt32(write, EEPROM_BAND_Freq + 4 * i, bandDefault[i]);
+    for (int i = 0; i < 12; i++)
+        write(EEPROM_BAND_Hour + i, 0);
+
+    // OUTPUTS
+    write(EEPROM_OUT_Drive0, SETTING_DRIVE_MAX);
+    write(EEPROM_OUT_Drive1, SETTING_DRIVE_MAX);
+    write(EEPROM_OUT_Enable1, 0);
+    write(EEPROM_OUT_Power1, 13);
+    PutInt32(write, EEPROM_OUT_Frequency1, 14097100L);
+
+    // PA SEQUENCER
+    write(EEPROM_PA_Lead, 5);
+    write(EEPROM_PA_Ramp, 0);
+    write(EEPROM_PA_Hold, 5);
+
+    // QRSS
+    write(EEPROM_QRSS_Style, QRSS_NONE);
+    write(EEPROM_QRSS_Dot, 3);
+    write(EEPROM_QRSS_Shift, 50);
+    write(EEPROM_QRSS_Every, 0);
+    PutInt32(write, EEPROM_QRSS_Frequency, 10140050L);
+
+    // SLOT CALENDAR
+    for (int h = 0; h < 24; h++)
+        PutInt32(write, EEPROM_SCHED_Slots + 4 * h, SCHED_ALL_SLOTS);
+    PutInt32(write, EEPROM_SCHED_Quiet, 0);
+    write(EEPROM_SCHED_Percent, 0);
+    PutInt32(write, EEPROM_SCHED_Seed, 0);
+
+    // SLOT OFFSET
+    write(EEPROM_OFFSET_Mode, OFFSET_OFF);
+    write(EEPROM_OFFSET_Window, 180);
+    write(EEPROM_OFFSET_Count, 0);
+    for (int i = 0; i < OFFSET_PATTERN_MAX; i++)
+        write(EEPROM_OFFSET_Pattern + i, 0);
+
+    // TELEMETRY
+    write(EEPROM_TELEM_Channel, 0xFF);
+    write(EEPROM_TELEM_Channel + 1, 0xFF);
+    write(EEPROM_TELEM_VoltPin, 0xFF);
+    write(EEPROM_TELEM_VoltScale, 10);
+
+    // MESSAGE TABLE
+    for (int i = 0; i < MSG_MAX; i++)
+        write(EEPROM_MSG_Table + i * MSG_ENTRY_SIZE, 0);                 // No call, message not in use
+    write(EEPROM_MSG_PatternCount, 0);
+    for (int i = 0; i < MSG_PATTERN_MAX; i++)
+        write(EEPROM_MSG_Pattern + i, 0);
+}
+
+// Apply a setting, a "wr" command without the "wr", e.g. "hop 2". Returns SETTING_OK, an
+// error, or SETTING_UNKNOWN if it is not a setting. Nothing is written on an error
+int SettingApply(const char *setting, SettingReadFunc read, SettingWriteFunc write)
+{
+    char name[16], buf[32];
+    int value, value1, value2, used;
+    double freq;
+
+    while (*setting == ' ')
+        setting++;
+    if (1 != sscanf(setting, "%15s%n", name, &used))
+        return SETTING_UNKNOWN;
+    const char *arg = setting + used;
+
+    // HARDWARE
+    // frst FREQ
+    if (0 == strcmp(name, "frst"))
+    {
+        if (1 != sscanf(arg, "%d", &value))
+            return SETTING_BAD;
+        if ((value < 26990000L) || (value > 27010000L))        // Accept only frequencies +/- 10 kHz from 27 MHz
+            return SETTING_FREQUENCY;
+        PutInt32(write, EEPROM_HW_RefStartFreq, value);
+    }
+
+    // hw T1 LCD
+    else if (0 == strcmp(name, "hw"))
+    {
+        if ((2 != sscanf(arg, "%d %d", &value, &value1)) || (value < 0) || (value > 2) || (value1 < 0) || (value1 > 4))
+            return SETTING_BAD;
+        write(EEPROM_HW_T1, value);
+        write(EEPROM_HW_DisplayMode, value1);
+    }
+
+    // warmup DURATION
+    else if (0 == strcmp(name, "warmup"))
+    {
+        if ((1 != sscanf(arg, "%d", &value)) || (value < 0) || (value > 0xFF))
+            return SETTING_BAD;
+        write(EEPROM_HW_WarmUp, value);
+    }
+
+    // GPS PARAMETERS
+    // echo ONOFF
+    else if (0 == strcmp(name, "echo"))
+    {
+        if ((1 != sscanf(arg, "%d", &value)) || (value < 0) || (value > 1))
+            return SETTING_BAD;
+        write(EEPROM_GPS_Echo, value);
+    }
+
+    // gpsdelay MS
+    else if (0 == strcmp(name, "gpsdelay"))
+    {
+        if ((1 != sscanf(arg, "%d", &value)) || (value < 0) || (value > CLOCK_NMEA_DELAY_MAX))
+            return SETTING_BAD;
+        PutInt32(write, EEPROM_GPS_Delay, value);
+    }
+
+    // BEACON PARAMETERS
+    // defaults
+    else if (0 == strcmp(name, "defaults"))
+        Defaults(write);
+
+    // freq FREQ
+    else if (0 == strcmp(name, "freq"))
+    {
+        if (1 != sscanf(arg, "%31s", buf))
+            return SETTING_BAD;
+        freq = strtod(buf, NULL);
+        if (freq < SETTING_FREQ_MIN)                           // Accept only frequencies from 100 kHz and up
+            return SETTING_FREQUENCY;
+        PutBytes(write, EEPROM_BEACON_Frequency, &freq, 8);
+    }
+
+    // cal INTERVAL   and   txdly INTERVAL_MINUTES
+    else if ((0 == strcmp(name, "cal")) || (0 == strcmp(name, "txdly")))
+    {
+        if ((1 != sscanf(arg, "%d", &value)) || (value < 1) || (value > 0xFF))
+            return SETTING_BAD;
+        write((name[0] == 'c') ? EEPROM_BEACON_CalibInterval : EEPROM_BEACON_Interval, value);
+    }
+
+    // bcn CALL
+    else if (0 == strcmp(name, "bcn"))
+    {
+        if ((1 != sscanf(arg, "%31s", buf)) || (strlen(buf) >= 16))
+            return SETTING_BAD;
+        PutString(write, EEPROM_BEACON_Call, buf, 16);
+    }
+
+    // loc LOCATOR
+    else if (0 == strcmp(name, "loc"))
+    {
+        if ((1 != sscanf(arg, "%31s", buf)) || (strlen(buf) >= 9))
+            return SETTING_BAD;
+        PutString(write, EEPROM_COMMON_Locator, buf, 9);
+    }
+
+    // WSPR
+    // pwr POWER
+    else if (0 == strcmp(name, "pwr"))
+    {
+        if ((1 != sscanf(arg, "%d", &value)) || !WsprValidPower(value))
+            return SETTING_BAD;
+        write(EEPROM_BEACON_WSPRPower, value);
+    }
+
+    // mode MODE
+    else if (0 == strcmp(name, "mode"))
+    {
+        if ((1 != sscanf(arg, "%d", &value)) || !ModeGet(value))
+            return SETTING_BAD;
+        write(EEPROM_BEACON_Mode, value);
+    }
+
+    // BAND HOPPING
+    // hop MODE
+    else if (0 == strcmp(name, "hop"))
+    {
+        if ((1 != sscanf(arg, "%d", &value)) || (value < 0) || (value >= HOP_MODES))
+            return SETTING_BAD;
+        write(EEPROM_BAND_HopMode, value);
+    }
+
+    // band BAND FREQ
+    else if (0 == strcmp(name, "band"))
+    {
+        if ((2 != sscanf(arg, "%d %31s", &value, buf)) || (value < 1) || (value > BANDS_MAX))
+            return SETTING_BAD;
+        freq = strtod(buf, NULL);
+        if ((freq != 0.0) && !ValidFrequency(freq))
+            return SETTING_FREQUENCY;
+
+        uint16_t enable = (read(EEPROM_BAND_Enable + 1) << 8) | read(EEPROM_BAND_Enable);
+        if (freq == 0.0)                                       // 0 disables the band but keeps its frequency
+            enable &= ~(1 << (value - 1));
+        else
+        {
+            PutInt32(write, EEPROM_BAND_Freq + 4 * (value - 1), (int32_t) freq);
+            enable |= 1 << (value - 1);
+        }
+        write(EEPROM_BAND_Enable, enable & 0xFF);
+        write(EEPROM_BAND_Enable + 1, enable >> 8);
+    }
+
+    // hour HOUR BAND
+    else if (0 == strcmp(name, "hour"))
+    {
+        if ((2 != sscanf(arg, "%d %d", &value, &value1)) || (value < 0) || (value > 23) || (value1 < 0) || (value1 > BANDS_MAX))
+            return SETTING_BAD;
+        uint8_t hours = read(EEPROM_BAND_Hour + value / 2);
+        hours = (value % 2) ? (hours & 0x0F) | (value1 << 4) : (hours & 0xF0) | value1;
+        write(EEPROM_BAND_Hour + value / 2, hours);
+    }
+
+    // SLOT CALENDAR
+    // slots HOUR MASK
+    else if (0 == strcmp(name, "slots"))
+    {
+        unsigned long mask;
+        if ((2 != sscanf(arg, "%d %lx", &value, &mask)) || (value < 0) || (value > 24) || (mask & ~SCHED_ALL_SLOTS))
+            return SETTING_BAD;
+        for (int h = 0; h < 24; h++)
+            if ((h == value) || (value == 24))
+                PutInt32(write, EEPROM_SCHED_Slots + 4 * h, mask);
+    }
+
+    // quiet FROM TO
+    else if (0 == strcmp(name, "quiet"))
+    {
+        if ((2 != sscanf(arg, "%d %d", &value, &value1)) || (value < 0) || (value > 23) || (value1 < 0) || (value1 > 23))
+            return SETTING_BAD;
+        uint32_t quiet = 0;
+        for (int h = value; h != value1; h = (h + 1) % 24)
+            quiet |= 1UL << h;
+        PutInt32(write, EEPROM_SCHED_Quiet, quiet);
+    }
+
+    // txpct PERCENT SEED
+    else if (0 == strcmp(name, "txpct"))
+    {
+        unsigned long seed = 0;
+        if ((1 > sscanf(arg, "%d %lu", &value, &seed)) || (value < 0) || (value > 100))
+            return SETTING_BAD;
+        write(EEPROM_SCHED_Percent, value);
+        PutInt32(write, EEPROM_SCHED_Seed, seed);
+    }
+
+    // offset MODE WINDOW
+    else if (0 == strcmp(name, "offset"))
+    {
+        if ((2 != sscanf(arg, "%d %d", &value, &value1)) || (value < 0) || (value >= OFFSET_MODES) || (value1 < 10) || (value1 > OFFSET_WINDOW_MAX))
+            return SETTING_BAD;
+        write(EEPROM_OFFSET_Mode, value);
+        write(EEPROM_OFFSET_Window, value1);
+    }
+
+    // pattern HZ HZ ...
+    else if (0 == strcmp(name, "pattern"))
+    {
+        int8_t pattern[OFFSET_PATTERN_MAX];
+        int count = 0;
+
+        while (1 == sscanf(arg, "%d%n", &value, &used))
+        {
+            if ((count >= OFFSET_PATTERN_MAX) || (value < -OFFSET_WINDOW_MAX / 2) || (value > OFFSET_WINDOW_MAX / 2))
+                return SETTING_BAD;
+            pattern[count++] = value;
+            arg += used;
+        }
+        for (int i = 0; i < count; i++)
+            write(EEPROM_OFFSET_Pattern + i, (uint8_t) pattern[i]);
+        write(EEPROM_OFFSET_Count, count);
+    }
+
+    // OUTPUTS
+    // dual FREQ POWER
+    else if (0 == strcmp(name, "dual"))
+    {
+        if (2 != sscanf(arg, "%31s %d", buf, &value))
+            return SETTING_BAD;
+        freq = strtod(buf, NULL);
+        if (freq == 0.0)                                       // 0 turns CLK1 off but keeps its settings
+            write(EEPROM_OUT_Enable1, 0);
+        else if (read(EEPROM_HW_T1) != 2)
+            return SETTING_NEEDS_T1;
+        else if (!WsprValidPower(value))
+            return SETTING_BAD;
+        else if (!ValidFrequency(freq))
+            return SETTING_FREQUENCY;
+        else
+        {
+            PutInt32(write, EEPROM_OUT_Frequency1, (int32_t) freq);
+            write(EEPROM_OUT_Power1, value);
+            write(EEPROM_OUT_Enable1, 1);
+        }
+    }
+
+    // drive CLK0 CLK1
+    else if (0 == strcmp(name, "drive"))
+    {
+        if ((2 != sscanf(arg, "%d %d", &value, &value1)) || (value < 0) || (value > SETTING_DRIVE_MAX) || (value1 < 0) || (value1 > SETTING_DRIVE_MAX))
+            return SETTING_BAD;
+        write(EEPROM_OUT_Drive0, value);
+        write(EEPROM_OUT_Drive1, value1);
+    }
+
+    // PA SEQUENCER
+    // pa LEAD RAMP HOLD
+    else if (0 == strcmp(name, "pa"))
+    {
+        if ((3 != sscanf(arg, "%d %d %d", &value, &value1, &value2)) || (value < 0) || (value > 2550) || (value1 < 0) || (value1 > 255) ||
+            (value2 < 0) || (value2 > 2550))
+            return SETTING_BAD;
+        write(EEPROM_PA_Lead, (value + 5) / 10);               // Stored in 10 ms
+        write(EEPROM_PA_Ramp, value1);
+        write(EEPROM_PA_Hold, (value2 + 5) / 10);
+    }
+
+    // QRSS
+    // qrss STYLE DOT SHIFT
+    else if (0 == strcmp(name, "qrss"))
+    {
+        if (3 != sscanf(arg, "%d %d %31s", &value, &value1, buf))
+            return SETTING_BAD;
+        int shift = (int) (strtod(buf, NULL) * 10.0 + 0.5);                 // Stored in 0.1 Hz
+        if ((value < 0) || (value >= QRSS_STYLES) || (value1 < 1) || (value1 > 120) || (shift < 1) || (shift > 255))
+            return SETTING_BAD;
+        write(EEPROM_QRSS_Style, value);
+        write(EEPROM_QRSS_Dot, value1);
+        write(EEPROM_QRSS_Shift, shift);
+    }
+
+    // qrssfreq FREQ
+    else if (0 == strcmp(name, "qrssfreq"))
+    {
+        if (1 != sscanf(arg, "%31s", buf))
+            return SETTING_BAD;
+        freq = strtod(buf, NULL);
+        if (!ValidFrequency(freq))
+            return SETTING_FREQUENCY;
+        PutInt32(write, EEPROM_QRSS_Frequency, (int32_t) freq);
+    }
+
+    // qrssslot N
+    else if (0 == strcmp(name, "qrssslot"))
+    {
+        if ((1 != sscanf(arg, "%d", &value)) || (value < 0) || (value > 0xFF))
+            return SETTING_BAD;
+        write(EEPROM_QRSS_Every, value);
+    }
+
+    // TELEMETRY
+    // telem CHANNEL   or   telem off
+    else if (0 == strcmp(name, "telem"))
+    {
+        if (1 != sscanf(arg, "%7s", buf))
+            return SETTING_BAD;
+        if (0 == strcmp(buf, "off"))
+            value = 0xFFFF;                                    // Unwritten EEPROM, telemetry off
+        else if (isdigit((unsigned char) buf[0]) && (atoi(buf) < TELEM_CHANNELS))
+            value = atoi(buf);
+        else
+            return SETTING_BAD;
+        write(EEPROM_TELEM_Channel, value & 0xFF);
+        write(EEPROM_TELEM_Channel + 1, value >> 8);
+    }
+
+    // telemv PIN RATIO
+    else if (0 == strcmp(name, "telemv"))
+    {
+        if ((2 != sscanf(arg, "%d %lf", &value, &freq)) || ((value != -1) && !SettingVoltInput(value)) || (freq < 1.0) || (freq > 25.5))
+            return SETTING_BAD;
+        write(EEPROM_TELEM_VoltPin, (value < 0) ? 0xFF : value);
+        write(EEPROM_TELEM_VoltScale, (uint8_t) lround(freq * 10.0));
+    }
+
+    // MESSAGE TABLE
+    // msg N CALL LOCATOR POWER [FREQ]   or   msg N off
+    else if (0 == strcmp(name, "msg"))
+    {
+        char msgCall[16], msgLocator[9];
+        int items = sscanf(arg, "%d %15s %8s %d %lf", &value, msgCall, msgLocator, &value1, &freq);
+        uint16_t address = EEPROM_MSG_Table + (value - 1) * MSG_ENTRY_SIZE;
+
+        if ((items < 2) || (value < 1) || (value > MSG_MAX))
+            return SETTING_BAD;
+        if ((items == 2) && (0 == strcmp(msgCall, "off")))
+            write(address, 0);                                 // No call, message not in use
+        else if ((items >= 4) && (strlen(msgCall) >= 3) && WsprValidPower(value1) &&
+                 ((items == 4) || (freq == 0.0) || ValidFrequency(freq)))
+        {
+            if (0 == strcmp(msgLocator, "*"))
+                msgLocator[0] = 0;                             // The beacon locator
+            PutString(write, address, msgCall, 16);
+            PutString(write, address + 16, msgLocator, 9);
+            write(address + 25, value1);
+            PutInt32(write, address + 26, (items == 5) ? (uint32_t) freq : 0);
+        }
+        else
+            return SETTING_BAD;
+    }
+
+    // msgpat DIGITS   or   msgpat off
+    else if (0 == strcmp(name, "msgpat"))
+    {
+        if (1 != sscanf(arg, "%15s", buf))
+            return SETTING_BAD;
+        int count = (0 == strcmp(buf, "off")) ? 0 : strlen(buf);
+        if (count > MSG_PATTERN_MAX)
+            return SETTING_BAD;
+        for (int i = 0; i < count; i++)
+            if ((buf[i] < '0') || (buf[i] > '0' + MSG_MAX))
+                return SETTING_BAD;
+        for (int i = 0; i < count; i++)
+            write(EEPROM_MSG_Pattern + i, buf[i] - '0');
+        write(EEPROM_MSG_PatternCount, count);
+    }
+
+    else
+        return SETTING_UNKNOWN;
+    return SETTING_OK;
+}
+
+// CRC-16/CCITT
+static uint16_t Crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    while (len--)
+    {
+        crc ^= (uint16_t) *data++ << 8;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+// Signature of the configuration: a CRC-16 of every field of settingFields but the
+// signature itself, so any setting that changes changes it, see boot.cpp
+uint16_t SettingSignature(SettingReadFunc read)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (int f = 0; f < settingFieldCount; f++)
+    {
+        if (settingFields[f].address == EEPROM_BOOT_Signature)
+            continue;
+        for (int i = 0; i < settingFields[f].size; i++)
+        {
+            uint8_t b = read(settingFields[f].address + i);
+            crc = Crc16(crc, &b, 1);
+        }
+    }
+    return crc;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,42 @@
+#ifndef _SETTINGS_H
+#define _SETTINGS_H
+
+// Plain C++ so the provisioning tool builds its EEPROM images with the same code
+#include <stdint.h>
+
+// SettingApply() results, the comStatus values of ParseCommand()
+#define SETTING_UNKNOWN      0             // Not a setting
+#define SETTING_OK           1
+#define SETTING_BAD          2             // Missing, invalid or out of range argument
+#define SETTING_FREQUENCY    3             // Frequency out of range
+#define SETTING_NEEDS_T1     6             // wr dual while the T1 output uses CLK1
+
+#define SETTING_FREQ_MIN     100000.0      // Hz, range of every frequency setting
+#define SETTING_FREQ_MAX     298765432.0
+#define SETTING_DRIVE_MAX    3             // SI5351_DRIVE_8MA, checked against the RFzero library in config.cpp
+#define SETTING_VOLT_INPUTS  6             // Analog inputs A0 - A5 of wr telemv
+
+// EEPROM access. The sketch passes the 24LC08B, the tools a memory image. Multi byte
+// values are little endian, as the SAMD21 lays them out in memory
+typedef uint8_t (*SettingReadFunc)(const uint16_t address);
+typedef void (*SettingWriteFunc)(const uint16_t address, const uint8_t value);
+
+// A sketch owned configuration field of the EEPROM map
+struct SettingField
+{
+    uint16_t address;
+    uint8_t size;
+};
+
+extern const SettingField settingFields[];
+extern const int settingFieldCount;
+
+// Function prototypes
+int SettingApply(const char *setting, SettingReadFunc read, SettingWriteFunc write);
+uint16_t SettingSignature(SettingReadFunc read);
+uint32_t SettingBandDefault(const int band);
+bool SettingVoltInput(const int input);
+
+#endif // _SETTINGS_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,188 @@
+// Own include
+#include "tasks.h"
+
+// Program includes. Located in the same directory as the .ino file
+#include "i2cbus.h"
+
+// Cooperative foreground scheduler. yield() used to loop over the USB receiver and the
+// GPS parser until USB went quiet, so a paste on the command line starved the GPS and a
+// display refresh could land anywhere. Now every yield() is one pass over a static task
+// table in priority order, and each task that is due runs at most once per pass. A task
+// is due every pass, every period or when signalled, e.g. the display after a GPS
+// sentence. During a frame the TX engine only calls yield() well before the next symbol
+// edge, and a task only starts if its budget fits before that edge, so the symbol timing
+// always comes first. A task that changes what the TX engine sends has a gate that holds
+// it back while TX is active: the calibration, also close to a slot edge, and the command
+// line unless it only reads.
+//
+// Runtime per task is accounted in microseconds, with the runs that took longer than
+// their budget counted as overruns
+
+struct TaskEntry
+{
+    TaskFn fn;                         // 0: not added, e.g. compiled out
+    uint16_t periodMs;
+    uint32_t budgetUs;
+    TaskGate gate;                     // 0: always ready
+    bool signalled;
+    bool running;                      // Not entered again from a yield() within the task
+    unsigned long due;                 // millis() of the next periodic run
+};
+
+static const char* const taskName[TASKS] =
+{
+    "GPS",
+    "Time",
+    "USB",
+    "Command",
+    "LCD",
+    "I2C jobs",
+    "Calibration",
+    "Stats",
+};
+
+static TaskEntry taskTable[TASKS];
+static TaskStat taskStat[TASKS];
+static unsigned long statStart = 0;    // millis() of the last reset
+static unsigned long secondStart = 0;  // micros() the current second started
+static uint32_t secondBusyUs = 0;      // Task runtime in the current second
+static uint32_t peakBusyUs = 0;        // Busiest second since the reset
+
+// Register a task. Call from setup() before anything calls yield()
+void TaskAdd(const uint8_t task, TaskFn fn, const uint16_t periodMs, const uint32_t budgetUs, TaskGate gate)
+{
+    if (task >= TASKS)
+        return;
+
+    TaskEntry *t = &taskTable[task];
+    t->fn = fn;
+    t->periodMs = periodMs;
+    t->budgetUs = budgetUs;
+    t->gate = gate;
+    t->signalled = false;
+    t->running = false;
+    t->due = millis() + ((periodMs == TASK_ON_SIGNAL) ? 0 : periodMs);
+}
+
+// Make a task due in the next pass, the current one if it has not been reached yet
+void TaskSignal(const uint8_t task)
+{
+    if (task < TASKS)
+        taskTable[task].signalled = true;
+}
+
+// One pass over the task table. A task that calls yield(), e.g. the calibration while it
+// counts, gets the others run meanwhile, and its runtime includes theirs
+void TaskRun()
+{
+    for (int i = 0; i < TASKS; i++)
+    {
+        TaskEntry *t = &taskTable[i];
+        TaskStat *stat = &taskStat[i];
+        unsigned long now = millis();
+        bool periodic = (t->periodMs != TASK_ON_SIGNAL) && (t->periodMs != TASK_EVERY_PASS);
+
+        if (!t->fn || t->running)
+            continue;
+        if (!t->signalled && (t->periodMs == TASK_ON_SIGNAL))
+            continue;
+        if (!t->signalled && periodic && ((long) (now - t->due) < 0))
+            continue;
+
+        if ((t->gate && !t->gate()) || !I2cBusFits(t->budgetUs))
+        {
+            stat->deferred++;
+            continue;
+        }
+
+        if (periodic)
+        {
+            if ((long) (now - t->due) > (long) t->periodMs)
+            {
+                stat->late++;
+                t->due = now;          // Do not catch up
+            }
+            t->due += t->periodMs;
+        }
+        t->signalled = false;
+
+        unsigned long start = micros();
+        t->running = true;
+        t->fn();
+        t->running = false;
+        uint32_t used = micros() - start;
+
+        stat->runs++;
+        stat->totalUs += used;
+        if (used > stat->maxUs)
+            stat->maxUs = used;
+        if (used > t->budgetUs)
+            stat->overruns++;
+        secondBusyUs += used;
+    }
+}
+
+// Load accounting, the body of TASK_STATS. Keeps the busiest second
+void TaskStats()
+{
+    unsigned long now = micros();
+
+    if (now - secondStart < 1000000UL)
+        return;
+    if (secondBusyUs > peakBusyUs)
+        peakBusyUs = secondBusyUs;
+    secondBusyUs = 0;
+    secondStart = now;
+}
+
+void TaskReset()
+{
+    memset(taskStat, 0, sizeof(taskStat));
+    statStart = millis();
+    secondStart = micros();
+    secondBusyUs = 0;
+    peakBusyUs = 0;
+}
+
+void TaskDump()
+{
+    char buf[100];
+    uint64_t busy = 0;
+    unsigned long elapsed = millis() - statStart;
+
+    SerialUSB.println("Task         Period ms  Budget us  Runs       Avg us     Max us     Overruns   Deferred   Late");
+    for (int i = 0; i < TASKS; i++)
+    {
+        const TaskEntry *t = &taskTable[i];
+        const TaskStat *stat = &taskStat[i];
+        unsigned long avg = stat->runs ? (unsigned long) (stat->totalUs / stat->runs) : 0;
+
+        if (!t->fn)
+        {
+            sprintf(buf, "%-11s  not in this build", taskName[i]);
+            SerialUSB.println(buf);
+            continue;
+        }
+        if (t->periodMs == TASK_ON_SIGNAL)
+            sprintf(buf, "%-11s  %-9s  ", taskName[i], "signal");
+        else if (t->periodMs == TASK_EVERY_PASS)
+            sprintf(buf, "%-11s  %-9s  ", taskName[i], "pass");
+        else
+            sprintf(buf, "%-11s  %-9u  ", taskName[i], t->periodMs);
+        SerialUSB.print(buf);
+        sprintf(buf, "%-9lu  %-9lu  %-9lu  %-9lu  %-9lu  %-9lu  %lu", (unsigned long) t->budgetUs, (unsigned long) stat->runs,
+                avg, (unsigned long) stat->maxUs, (unsigned long) stat->overruns, (unsigned long) stat->deferred,
+                (unsigned long) stat->late);
+        SerialUSB.println(buf);
+        busy += stat->totalUs;
+    }
+
+    sprintf(buf, "Tasks ran %lu of %lu ms: ", (unsigned long) (busy / 1000), elapsed);
+    SerialUSB.print(buf);
+    SerialUSB.print(elapsed ? busy / 10.0 / elapsed : 0.0, 2);
+    SerialUSB.print(" %, busiest second ");
+    SerialUSB.print(peakBusyUs / 10000.0, 2);
+    SerialUSB.println(" %");
+}
+
+// ----------------- EOF -------------------------------------------------------------------
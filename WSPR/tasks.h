@@ -0,0 +1,48 @@
+#ifndef _TASKS_H
+#define _TASKS_H
+
+// Arduino includes
+#include <Arduino.h>
+
+// Foreground tasks run by yield(), in priority order, highest first. Keep taskName[] in
+// tasks.cpp in the same order
+enum TaskId
+{
+    TASK_GPS = 0,                      // gps.autoParse(), NMEA echo and telemetry
+    TASK_TIME,                         // RTC from GPS and the start up hold off, after every sentence
+    TASK_USB,                          // USB receiver
+    TASK_CMD,                          // Command line, reading commands only while TX is active
+    TASK_LCD,                          // Display refresh, after every sentence
+    TASK_I2C,                          // Queued I2C jobs: commands and display refreshes
+    TASK_CAL,                          // Reference calibration, only while TX is idle and no slot is due
+    TASK_STATS,                        // Once a second load accounting
+    TASKS                              // Number of tasks, must be last
+};
+
+#define TASK_EVERY_PASS   0            // Period of a task that runs in every pass
+#define TASK_ON_SIGNAL    0xFFFF       // Period of a task that only runs when signalled
+
+typedef void (*TaskFn)();
+typedef bool (*TaskGate)();            // False: the due task waits, e.g. while TX is active
+
+struct TaskStat
+{
+    uint32_t runs;
+    uint32_t overruns;                 // Runs longer than the budget
+    uint32_t deferred;                 // Passes a due task waited for a TX symbol edge or its gate
+    uint32_t late;                     // Periodic runs started more than a period late
+    uint64_t totalUs;
+    uint32_t maxUs;
+};
+
+// Function prototypes
+void TaskAdd(const uint8_t task, TaskFn fn, const uint16_t periodMs, const uint32_t budgetUs, TaskGate gate = 0);
+void TaskSignal(const uint8_t task);
+void TaskRun();
+void TaskStats();
+void TaskDump();
+void TaskReset();
+
+#endif // _TASKS_H
+
+// ----------------- EOF -------------------------------------------------------------------
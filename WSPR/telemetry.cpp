@@ -0,0 +1,306 @@
+// Own include
+#include "telemetry.h"
+
+// RFzero includes
+#include <RFzero.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "global.h"
+#include "config.h"
+#include "band.h"
+#include "calib.h"
+#include "settings.h"
+#include "txengine.h"
+#include "wspr.h"
+
+// Analog inputs the supply voltage can be measured on, input n of wr telemv is entry n.
+// Looked up, as the Arduino pin numbers of the analog inputs need not be in sequence
+static const uint8_t voltPins[SETTING_VOLT_INPUTS] = { A0, A1, A2, A3, A4, A5 };
+
+// The Arduino pin of analog input n, -1 if there is none or the rotary encoder uses it
+int TelemetryVoltPin(const int n)
+{
+    return SettingVoltInput(n) ? voltPins[n] : -1;
+}
+
+#if FEATURE_TELEMETRY
+
+// Balloon telemetry in the U4B basic telemetry layout. Every regular WSPR frame is followed
+// in the next slot by a second type 1 frame whose fields carry data instead of a station:
+//   call     channel ID character 1, encoded, channel ID character 2, encoded x 3. The
+//            encoded characters hold the 5th and 6th locator characters and the altitude
+//   locator  4 characters holding temperature, supply voltage, speed and the GPS status
+//   power    the remainder of that number, as one of the 19 power levels
+// The U4B channel, 0 - 599, tells the trackers which frames belong to which balloon. It
+// gives the channel ID, 0, 1 or Q followed by a digit, the minute of every 10 minutes the
+// regular frame starts in and the 40 Hz lane of the WSPR window both frames use:
+//   ID       "01Q"[channel / 200], digit (channel / 20) % 10
+//   lane     (channel / 5) % 4, 1420, 1460, 1540 or 1580 Hz above the dial, the
+//            middle 1480 - 1520 Hz is left to the ground stations
+//   minute   2 x (channel % 5), moved by 2 minutes per band in the order of the hopping
+//            plan so channel 0 of every band starts in that band's hopping slot
+// The scheduler only uses the channel's minute and the lane replaces the slot offset.
+// U4B is a WSPR-2 scheme, in WSPR-15 the channel is kept but telemetry is off.
+// Balloons send on the beacon frequency, which gives the band. With a GPS fix the regular
+// frames also take the locator from the GPS, as many characters as the set one has.
+//
+// Position, altitude and speed come from the GGA and RMC sentences as the GPS library
+// parses them. The frame is encoded right after the regular frame ends, in the 9 s gap
+// before the next slot, so the telemetry slot starts on time like any other
+
+static const uint8_t powerLevel[19] = { 0, 3, 7, 10, 13, 17, 20, 23, 27, 30, 33, 37, 40, 43, 47, 50, 53, 57, 60 };
+
+static const int8_t laneOffset[4] = { -80, -40, 40, 80 };   // Hz from the centre of the WSPR window
+
+static int channelNo = -1;                 // U4B channel, -1: telemetry off
+static char channel[3] = "";               // Channel ID
+static int channelMinute = 0;              // Of every 10 minutes
+static int voltPin = -1;                   // Arduino pin of the supply voltage input, -1: none
+static double voltScale = 1.0;             // Divider ratio in front of the input
+static TelemetryFix fix;
+static bool fixSeen = false;               // A position was received since start up
+static bool ggaFix = false;
+static bool rmcActive = false;
+static char regularGrid[7] = "";           // Locator the regular frames were last encoded with
+
+static char lastCall[7] = "";              // Last telemetry frame, for rd telem
+static char lastGrid[5] = "";
+static int lastPower = 0;
+static double lastVolts = 0.0;
+static int lastTemp = 0;
+
+void TelemetryLoad()
+{
+    channelNo = (eeprom.readByte(EEPROM_TELEM_Channel + 1, 0xFF) << 8) | eeprom.readByte(EEPROM_TELEM_Channel, 0xFF);
+    if (channelNo >= TELEM_CHANNELS)
+        channelNo = -1;
+    else
+    {
+        channel[0] = "01Q"[channelNo / 200];
+        channel[1] = '0' + (channelNo / 20) % 10;
+        channel[2] = 0;
+
+        int band = 0;                      // Not on a band of the plan: no band shift
+        for (int i = 0; i < BANDS_MAX; i++)
+            if (fabs(frequency - SettingBandDefault(i)) < SettingBandDefault(i) * 0.05)
+                band = i;
+        channelMinute = (2 * band + 2 * (channelNo % 5)) % 10;
+    }
+
+    voltPin = TelemetryVoltPin(eeprom.readByte(EEPROM_TELEM_VoltPin, 0xFF));
+    voltScale = eeprom.readByte(EEPROM_TELEM_VoltScale, 10) / 10.0;
+    regularGrid[0] = 0;
+}
+
+bool TelemetryOn()
+{
+    return (channelNo >= 0) && (TxEngineMode() == ModeGet(MODE_WSPR2));
+}
+
+// Minute of every 10 the channel's regular frame starts in, -1 if telemetry is off
+int TelemetryMinute()
+{
+    return TelemetryOn() ? channelMinute : -1;
+}
+
+// Offset of the channel's lane in Hz from the table frequency, the centre of the window
+int TelemetryLane()
+{
+    return TelemetryOn() ? laneOffset[(channelNo / 5) % 4] : 0;
+}
+
+// The n'th comma separated field of a sentence
+static bool Field(const char *frame, int n, char *out, const int size)
+{
+    while (n && *frame)
+        if (*frame++ == ',')
+            n--;
+    if (n)
+        return false;
+
+    int len = 0;
+    while (*frame && (*frame != ',') && (*frame != '*') && (len < size - 1))
+        out[len++] = *frame++;
+    out[len] = 0;
+    return len > 0;
+}
+
+// ddmm.mmmm and the hemisphere to degrees
+static double Degrees(const char *value, const char *hemisphere)
+{
+    double x = atof(value);
+    int deg = (int) (x / 100.0);
+    double r = deg + (x - deg * 100.0) / 60.0;
+
+    return ((*hemisphere == 'S') || (*hemisphere == 'W')) ? -r : r;
+}
+
+// Feed a sentence just parsed by the GPS library
+void TelemetryNmea(const char *frame)
+{
+    char value[16], hemi[2];
+    uint8_t sum = 0;
+    const char *p;
+
+    if (!TelemetryOn() || !frame || (frame[0] != '$') || (strlen(frame) < 7))
+        return;
+    for (p = frame + 1; *p && (*p != '*'); p++)
+        sum ^= *p;
+    if ((*p != '*') || (strtoul(p + 1, NULL, 16) != sum))
+        return;
+
+    if (0 == strncmp(&frame[3], "GGA", 3))
+    {
+        ggaFix = Field(frame, 6, value, sizeof(value)) && (atoi(value) > 0);
+        fix.satellites = Field(frame, 7, value, sizeof(value)) ? atoi(value) : 0;
+        if (ggaFix && Field(frame, 2, value, sizeof(value)) && Field(frame, 3, hemi, sizeof(hemi)))
+        {
+            fix.latitude = Degrees(value, hemi);
+            if (Field(frame, 4, value, sizeof(value)) && Field(frame, 5, hemi, sizeof(hemi)))
+            {
+                fix.longitude = Degrees(value, hemi);
+                fixSeen = true;
+            }
+        }
+        if (ggaFix && Field(frame, 9, value, sizeof(value)))
+            fix.altitude = atof(value);
+    }
+    else if (0 == strncmp(&frame[3], "RMC", 3))
+    {
+        rmcActive = Field(frame, 2, value, sizeof(value)) && (value[0] == 'A');
+        fix.speed = Field(frame, 7, value, sizeof(value)) ? atof(value) : 0.0;
+    }
+    fix.valid = ggaFix && rmcActive;
+}
+
+// Supply voltage from the analog input, 0.0 without one
+static double ReadVolts()
+{
+    if (voltPin < 0)
+        return 0.0;
+    return analogRead(voltPin) * 3.3 / 1023.0 * voltScale;
+}
+
+// 4 or 6 character locator of a position
+static void Locator(const double latitude, const double longitude, const int chars, char *grid)
+{
+    double lon = constrain(longitude + 180.0, 0.0, 359.9999);
+    double lat = constrain(latitude + 90.0, 0.0, 179.9999);
+
+    grid[0] = 'A' + (int) (lon / 20.0);
+    grid[1] = 'A' + (int) (lat / 10.0);
+    grid[2] = '0' + (int) fmod(lon / 2.0, 10.0);
+    grid[3] = '0' + (int) fmod(lat, 10.0);
+    if (chars > 4)
+    {
+        grid[4] = 'A' + (int) (fmod(lon, 2.0) * 12.0);
+        grid[5] = 'A' + (int) (fmod(lat, 1.0) * 24.0);
+    }
+    grid[chars] = 0;
+}
+
+// The telemetry frame fields for a fix, supply voltage and temperature
+bool TelemetryEncode(const TelemetryFix *fix, const double volts, const int tempC, const char *id, char *call, char *grid, int *power)
+{
+    char loc[7];
+    uint32_t val;
+
+    if (!id[0])
+        return false;
+    Locator(fix->latitude, fix->longitude, 6, loc);
+
+    // Call: subsquare and altitude
+    val = ((loc[4] - 'A') * 24 + (loc[5] - 'A')) * 1068UL + (uint32_t) (constrain(fix->altitude, 0.0, (double) TELEM_ALT_MAX) / 20.0);
+    call[0] = id[0];
+    call[2] = id[1];
+    call[5] = 'A' + val % 26;
+    val /= 26;
+    call[4] = 'A' + val % 26;
+    val /= 26;
+    call[3] = 'A' + val % 26;
+    val /= 26;
+    call[1] = (val < 10) ? '0' + val : 'A' + val - 10;
+    call[6] = 0;
+
+    // Locator and power: temperature, voltage, speed and GPS status. The voltage wraps so
+    // 3.00 - 4.95 V all fit in 40 steps
+    int temp = constrain(tempC, -50, 39) + 50;
+    int volt = ((int) lround((constrain(volts, 3.0, 4.95) * 100.0 - 300.0) / 5.0) + 20) % 40;
+    int speed = (int) constrain(fix->speed, 0.0, (double) TELEM_SPEED_MAX) / 2;
+    val = (((temp * 40UL + volt) * 42 + speed) * 2 + (fix->valid ? 1 : 0)) * 2 + (fix->satellites >= TELEM_SATS_OK ? 1 : 0);
+    *power = powerLevel[val % 19];
+    val /= 19;
+    grid[3] = '0' + val % 10;
+    val /= 10;
+    grid[2] = '0' + val % 10;
+    val /= 10;
+    grid[1] = 'A' + val % 18;
+    val /= 18;
+    grid[0] = 'A' + val % 18;
+    grid[4] = 0;
+    return true;
+}
+
+// Encode the telemetry frame for the next slot, and move the regular frames to the GPS
+// locator without restarting their rotation. Call right after a regular frame. False if
+// there is nothing to send
+bool TelemetryPrepare()
+{
+    char grid[7];
+
+    if (!TelemetryOn() || !fixSeen)
+        return false;
+
+    if (fix.valid)
+    {
+        Locator(fix.latitude, fix.longitude, (strlen(locator) >= 6) ? 6 : 4, grid);
+        if (strcmp(grid, regularGrid))
+        {
+            strcpy(regularGrid, grid);
+            TxEngineRelocate(call, regularGrid, wsprPower);
+            TxEngineLoadDual(dualEnable, call, regularGrid, dualPower);
+        }
+    }
+
+    lastVolts = ReadVolts();
+    lastTemp = (int) lround(CalibTemperature() / 10.0);
+    if (!TelemetryEncode(&fix, lastVolts, lastTemp, channel, lastCall, lastGrid, &lastPower))
+        return false;
+    return TxEngineLoadTelemetry(lastCall, lastGrid, lastPower);
+}
+
+void TelemetryDump()
+{
+    char buf[80];
+
+    if (!TelemetryOn())
+    {
+        SerialUSB.println((channelNo >= 0) ? "Telemetry off, U4B needs WSPR-2" : "Telemetry off");
+        return;
+    }
+    sprintf(buf, "Channel %d, ID %s, minute %d, lane %+d Hz", channelNo, channel, channelMinute, TelemetryLane());
+    SerialUSB.println(buf);
+    sprintf(buf, "GPS %s, %d satellites", fix.valid ? "valid" : "no fix", fix.satellites);
+    SerialUSB.println(buf);
+    if (fixSeen)
+    {
+        Locator(fix.latitude, fix.longitude, 6, buf);
+        SerialUSB.print(buf);
+        SerialUSB.print(", altitude m: ");
+        SerialUSB.print(fix.altitude, 0);
+        SerialUSB.print(", speed knots: ");
+        SerialUSB.println(fix.speed, 1);
+    }
+    if (lastCall[0])
+    {
+        sprintf(buf, "Last frame %s %s %d, temperature %d C, supply V: ", lastCall, lastGrid, lastPower, lastTemp);
+        SerialUSB.print(buf);
+        SerialUSB.println(lastVolts, 2);
+    }
+    else
+        SerialUSB.println("No telemetry frame yet");
+}
+
+#endif // FEATURE_TELEMETRY
+
+// ----------------- EOF -------------------------------------------------------------------
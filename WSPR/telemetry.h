@@ -0,0 +1,49 @@
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+// Arduino includes
+#include <Arduino.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "profiles.h"
+
+#define TELEM_ALT_MAX      21340           // m, altitude range of the telemetry frame in 20 m steps
+#define TELEM_SPEED_MAX    82              // knots, in 2 knot steps
+#define TELEM_SATS_OK      8               // Satellites for the GPS status bit
+#define TELEM_CHANNELS     600             // U4B channels, 3 x 10 IDs x 4 lanes x 5 minutes
+
+// Position and motion from the GPS NMEA sentences
+struct TelemetryFix
+{
+    bool valid;                            // GGA fix and RMC status active
+    double latitude;                       // Degrees, north positive
+    double longitude;                      // Degrees, east positive
+    double altitude;                       // m above mean sea level
+    double speed;                          // knots over ground
+    uint8_t satellites;
+};
+
+// Function prototypes
+int TelemetryVoltPin(const int n);
+bool TelemetryEncode(const TelemetryFix *fix, const double volts, const int tempC, const char *id, char *call, char *grid, int *power);
+#if FEATURE_TELEMETRY
+void TelemetryLoad();
+bool TelemetryOn();
+int TelemetryMinute();
+int TelemetryLane();
+void TelemetryNmea(const char *frame);
+bool TelemetryPrepare();
+void TelemetryDump();
+#else
+inline void TelemetryLoad() {}
+inline bool TelemetryOn() { return false; }
+inline int TelemetryMinute() { return -1; }
+inline int TelemetryLane() { return 0; }
+inline void TelemetryNmea(const char *) {}
+inline bool TelemetryPrepare() { return false; }
+inline void TelemetryDump() { SerialUSB.println("Telemetry is not in this build"); }
+#endif
+
+#endif // _TELEMETRY_H
+
+// ----------------- EOF -------------------------------------------------------------------
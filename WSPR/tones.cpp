@@ -0,0 +1,197 @@
+// Own include
+#include "tones.h"
+
+#include <math.h>
+#include <string.h>
+
+// Si5351 fout = fref * (PLL a + b/c) / ((MS a + b/c) * R). Below 100 MHz the PLL runs in
+// integer mode at 32 x fref and the tones are made by the fractional output multisynth.
+// Above, the multisynth must be integer 4 or 6 so the tones are made by the PLL instead.
+// In both cases b/c is the best rational approximation with c <= 2^20 - 1, which keeps the
+// tone error far below 1 mHz
+
+#define PLL_INT_MULT          32           // 32 x 27 MHz = 864 MHz
+#define MS_FRAC_MAX_FREQ 100000000.0       // Highest R-scaled output frequency in fractional MS mode
+#define MS_MIN_FREQ         500000.0       // Lowest R-scaled output frequency before R division is used
+
+// Best rational approximation of x = a + b/c with c <= SI5351_FRAC_MAX, using continued
+// fractions and checking the last semiconvergent
+static void Approximate(const double x, uint32_t *a, uint32_t *b, uint32_t *c)
+{
+    double frac = x - floor(x);
+    uint32_t p0 = 1, q0 = 0, p1 = 0, q1 = 1;    // Convergents h(n-2)/k(n-2) and h(n-1)/k(n-1) of frac
+    double rest = frac;
+
+    *a = (uint32_t) floor(x);
+    *b = 0;
+    *c = 1;
+    if (frac < 1.0e-12)
+        return;
+
+    for (int i = 0; i < 40; i++)
+    {
+        double inv = 1.0 / rest;
+        uint32_t t = (uint32_t) floor(inv);
+
+        if ((uint64_t) t * q1 + q0 > SI5351_FRAC_MAX)
+        {
+            // Denominator limit reached, the largest allowed semiconvergent may still be better
+            uint32_t k = (SI5351_FRAC_MAX - q0) / q1;
+            uint32_t ps = k * p1 + p0, qs = k * q1 + q0;
+            if (fabs(frac - (double) ps / qs) < fabs(frac - (double) p1 / q1))
+            {
+                p1 = ps;
+                q1 = qs;
+            }
+            break;
+        }
+
+        uint32_t p2 = t * p1 + p0, q2 = t * q1 + q0;
+        p0 = p1; q0 = q1;
+        p1 = p2; q1 = q2;
+
+        rest = inv - t;
+        if (rest < 1.0e-12)
+            break;
+    }
+
+    if (p1 >= q1)
+    {   // Rounded up to the next integer
+        (*a)++;
+        p1 = 0;
+        q1 = 1;
+    }
+    *b = p1;
+    *c = q1;
+}
+
+// Encode a + b/c into the 8 register multisynth layout shared by PLL and output multisynths
+static void Encode(const uint32_t a, const uint32_t b, const uint32_t c, const uint8_t rDivLog2, const uint8_t divBy4, uint8_t *regs)
+{
+    uint32_t p1, p2, p3;
+
+    if (divBy4)
+    {
+        p1 = 0;
+        p2 = 0;
+        p3 = 1;
+    }
+    else
+    {
+        uint32_t f = (uint32_t) (((uint64_t) 128 * b) / c);
+        p1 = 128 * a + f - 512;
+        p2 = 128 * b - c * f;
+        p3 = c;
+    }
+
+    regs[0] = (p3 >> 8) & 0xFF;
+    regs[1] = p3 & 0xFF;
+    regs[2] = ((rDivLog2 & 0x07) << 4) | (divBy4 ? 0x0C : 0x00) | ((p1 >> 16) & 0x03);
+    regs[3] = (p1 >> 8) & 0xFF;
+    regs[4] = p1 & 0xFF;
+    regs[5] = ((p3 >> 12) & 0xF0) | ((p2 >> 16) & 0x0F);
+    regs[6] = (p2 >> 8) & 0xFF;
+    regs[7] = p2 & 0xFF;
+}
+
+// The divider a + b/c held by an 8 register multisynth image
+double ToneDivider(const uint8_t *regs)
+{
+    if ((regs[2] & 0x0C) == 0x0C)
+        return 4.0;
+
+    uint32_t p1 = ((uint32_t) (regs[2] & 0x03) << 16) | ((uint32_t) regs[3] << 8) | regs[4];
+    uint32_t p2 = ((uint32_t) (regs[5] & 0x0F) << 16) | ((uint32_t) regs[6] << 8) | regs[7];
+    uint32_t p3 = ((uint32_t) (regs[5] & 0xF0) << 12) | ((uint32_t) regs[0] << 8) | regs[1];
+
+    return (p1 + 512.0 + (double) p2 / p3) / 128.0;
+}
+
+// The output frequency produced by a PLL and an output multisynth image
+double ToneFrequency(const double fref, const uint8_t *pll, const uint8_t *ms)
+{
+    uint8_t rDiv = 1 << ((ms[2] >> 4) & 0x07);
+
+    return fref * ToneDivider(pll) / (ToneDivider(ms) * rDiv);
+}
+
+// Calculate the register images for carrier + n * spacing, n = 0 .. tones - 1
+bool ToneCalculate(const double fref, const double carrier, const double spacing, const uint8_t tones, ToneTable *table)
+{
+    uint32_t a, b, c;
+    uint8_t rDivLog2 = 0;
+
+    if ((tones == 0) || (tones > TONES_MAX) || (carrier <= 0.0) || (fref <= 0.0))
+        return false;
+
+    memset(table, 0, sizeof(ToneTable));
+    table->carrier = carrier;
+    table->spacing = spacing;
+    table->tones = tones;
+
+    while ((carrier * (1 << rDivLog2) < MS_MIN_FREQ) && (rDivLog2 < 7))
+        rDivLog2++;
+    double rDiv = 1 << rDivLog2;
+    double top = (carrier + (tones - 1) * spacing) * rDiv;
+
+    if (top <= MS_FRAC_MAX_FREQ)
+    {
+        // Fixed integer PLL, fractional output multisynth per tone
+        double vco = fref * PLL_INT_MULT;
+        if ((vco < SI5351_VCO_MIN) || (vco > SI5351_VCO_MAX) || (vco / (carrier * rDiv) > 2048.0))
+            return false;
+
+        Encode(PLL_INT_MULT, 0, 1, 0, 0, table->pll);
+        table->toneReg = SI5351_REG_MS0;
+        for (int n = 0; n < tones; n++)
+        {
+            Approximate(vco / ((carrier + n * spacing) * rDiv), &a, &b, &c);
+            Encode(a, b, c, rDivLog2, 0, table->tone[n]);
+        }
+        memcpy(table->ms, table->tone[0], 8);
+    }
+    else
+    {
+        // Fixed integer output multisynth of 6 or 4, fractional PLL per tone
+        uint32_t msDiv = (top <= 150000000.0) ? 6 : 4;
+        if (top * msDiv > SI5351_VCO_MAX)
+            return false;
+
+        table->msInt = 1;
+        table->toneReg = SI5351_REG_PLLA;
+        Encode(msDiv, 0, 1, rDivLog2, msDiv == 4, table->ms);
+        for (int n = 0; n < tones; n++)
+        {
+            Approximate((carrier + n * spacing) * rDiv * msDiv / fref, &a, &b, &c);
+            Encode(a, b, c, 0, 0, table->tone[n]);
+        }
+        memcpy(table->pll, table->tone[0], 8);
+    }
+    return true;
+}
+
+// Move a calculated table by offset Hz. With the tones on the output multisynth the tone
+// images are kept and only the integer PLL is made fractional, scaled by the offset over
+// the centre frequency: one rational approximation instead of one per tone, and the tone
+// spacing changes by less than a ppm of itself. With the tones on the PLL every tone is
+// calculated again
+bool ToneShift(const double fref, const ToneTable *base, const double offset, ToneTable *table)
+{
+    uint32_t a, b, c;
+
+    if (base->toneReg == SI5351_REG_PLLA)
+        return ToneCalculate(fref, base->carrier + offset, base->spacing, base->tones, table);
+
+    double centre = base->carrier + (base->tones - 1) * base->spacing / 2.0;
+    double pll = PLL_INT_MULT * (1.0 + offset / centre);
+    if ((base->tones == 0) || (fref * pll < SI5351_VCO_MIN) || (fref * pll > SI5351_VCO_MAX))
+        return false;
+
+    memcpy(table, base, sizeof(ToneTable));
+    table->carrier = base->carrier + offset;
+    Approximate(pll, &a, &b, &c);
+    Encode(a, b, c, 0, 0, table->pll);
+    return true;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
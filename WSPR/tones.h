@@ -0,0 +1,39 @@
+#ifndef _TONES_H
+#define _TONES_H
+
+// Plain C++ so the tone calculation can also be built on a host
+#include <stdint.h>
+
+#define TONES_MAX              4           // Max number of FSK tones in a table
+
+#define SI5351_REG_PLLA       26           // PLL A feedback multisynth, 8 registers
+#define SI5351_REG_PLLB       34           // PLL B feedback multisynth, 8 registers
+#define SI5351_REG_MS0        42           // Output multisynth 0, 8 registers per output
+
+#define SI5351_VCO_MIN    600000000.0
+#define SI5351_VCO_MAX    900000000.0
+#define SI5351_FRAC_MAX     1048575UL      // Largest multisynth denominator, 2^20 - 1
+
+// Register images for one carrier and its FSK tones. The PLL and the output multisynth are
+// set once per frame and each tone is then a single 8 register write to toneReg
+struct ToneTable
+{
+    double carrier;                        // Tone 0 frequency in Hz
+    double spacing;                        // Tone spacing in Hz
+    uint8_t tones;                         // Number of valid tones
+    uint8_t msInt;                         // 1: output multisynth is in integer mode
+    uint8_t toneReg;                       // SI5351_REG_PLLA if the tones step the PLL, else SI5351_REG_MS0
+    uint8_t pll[8];                        // PLL feedback register image
+    uint8_t ms[8];                         // Output multisynth register image
+    uint8_t tone[TONES_MAX][8];            // Per tone register image for toneReg
+};
+
+// Function prototypes
+bool ToneCalculate(const double fref, const double carrier, const double spacing, const uint8_t tones, ToneTable *table);
+double ToneFrequency(const double fref, const uint8_t *pll, const uint8_t *ms);
+double ToneDivider(const uint8_t *regs);
+bool ToneShift(const double fref, const ToneTable *base, const double offset, ToneTable *table);
+
+#endif // _TONES_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,501 @@
+// Own include
+#include "txengine.h"
+
+// RFzero includes
+#include <RFzero.h>
+#include <Wire.h>
+
+// Program includes. Located in the same directory as the .ino file
+#include "global.h"
+#include "calib.h"
+#include "config.h"
+#include "i2cbus.h"
+#include "txframe.h"
+
+// The WSPR transmitter. All frames of the type 1/2/3 rotation are encoded when the
+// configuration is loaded and the tone registers of every band when a frequency or the
+// reference changes, so sending a frame is nothing but timed register writes and changing
+// band is a pointer switch. Symbol count, timing and tone spacing come from the mode.
+// The messages of the message table have their own rotations, so the message of a slot
+// is picked the same way as the band.
+// QRSS frames are a precompiled keying timeline played through the same tone path.
+// With the second output on, every WSPR frame also goes out on CLK1 on its own frequency.
+// A per slot offset moves a frame within the WSPR window by a delta update of the cached
+// table, see ToneShift().
+//
+// The PA and the RF keying run on the same micros() deadlines as the symbols, counted back
+// from the first symbol. That starts on the slot start, the UTC edge of the GPS anchored
+// clock when that set it, see clock.cpp, so the slot must be found lead + ramp early:
+//   - lead - ramp            PA on
+//   - ramp                   RF on at 2 mA, stepped up to the set drive during ramp
+//   0                        first symbol
+//   end of the last symbol   RF stepped down during ramp and off
+//   + ramp + hold            PA off
+
+static const ModeDesc *txMode = ModeGet(MODE_WSPR2);
+static uint8_t rotation[MSG_COUNT][WSPR_ROTATION_MAX][MODE_SYMBOLS_MAX];  // Symbols of each frame of each message
+static uint8_t rotationType[MSG_COUNT][WSPR_ROTATION_MAX];       // WSPR_TYPE1, 2 or 3
+static int rotationFrames[MSG_COUNT];                            // Number of valid frames, 0: message not in use
+static int rotationNext[MSG_COUNT];                              // Frame to send next
+static int txMessage = 0;                                        // Message of the next frame
+
+static uint8_t dualRotation[WSPR_ROTATION_MAX][MODE_SYMBOLS_MAX]; // CLK1 frames, the power may differ
+static bool dualOn = false;                                      // CLK1 sends with every WSPR frame
+static uint8_t drive[2] = { SI5351_DRIVE_8MA, SI5351_DRIVE_8MA }; // CLK0 and CLK1 drive strength
+
+static int paPin = -1;                                           // -1: no PA control
+static unsigned long paLeadUs = 0;                               // PA on before the RF
+static unsigned long rampUs = 0;                                 // RF ramp up and down, 0: hard keying
+static unsigned long paHoldUs = 0;                               // PA on after the RF
+
+static QrssEvent qrssTimeline[QRSS_EVENTS_MAX];                  // Keying timeline of the QRSS frame
+static int qrssEvents = 0;                                       // Number of valid entries
+static uint32_t qrssUnitUs = 0;                                  // Morse unit (dot) length
+
+static ToneTable toneTables[TX_TABLES];
+static double toneFref[TX_TABLES];                               // Reference used for each table, 0: invalid
+static const ToneTable *txTones = &toneTables[TX_TABLE_BEACON];  // Table of the next frame
+static uint8_t telemetry[MODE_SYMBOLS_MAX];                      // Symbols of the telemetry frame
+static bool telemetryReady = false;                              // Loaded and not yet sent
+static double txOffset = 0.0;                                    // Offset of the next WSPR frame in Hz
+static ToneTable slotTones[2];                                   // CLK0 and CLK1 tables moved by txOffset
+static double lastFrequency = 0.0;                               // Nominal CLK0 frequency of the last frame
+static unsigned long lastStartUs = 0;                            // micros() of the first symbol of the last frame
+static unsigned long slotStartUs = 0;                            // micros() the next frame starts, see TxEngineStartAt()
+static bool slotStartSet = false;
+
+// Si5351 register writes over Wire as the highest priority I2C client
+static void SiWrite(const uint8_t reg, const uint8_t *data, const uint8_t len)
+{
+    I2cBusBegin(I2C_TX);
+    Wire.beginTransmission(SI5351_I2C_ADDR);
+    Wire.write(reg);
+    Wire.write(data, len);
+    Wire.endTransmission();
+    I2cBusEnd(I2C_TX);
+}
+
+// Si5351 register read, for read-modify-write of registers shared with the RFzero library
+static uint8_t SiRead(const uint8_t reg)
+{
+    uint8_t data = 0;
+
+    I2cBusBegin(I2C_TX);
+    Wire.beginTransmission(SI5351_I2C_ADDR);
+    Wire.write(reg);
+    Wire.endTransmission(false);
+    if (Wire.requestFrom(SI5351_I2C_ADDR, 1) && Wire.available())
+        data = Wire.read();
+    I2cBusEnd(I2C_TX);
+    return data;
+}
+
+// Measured reference frequency, or the one predicted from the history until the first measurement
+static double ReferenceFrequency()
+{
+    double fref = freqCount.getReferenceFrequency();
+
+    if (fref <= 0.0)
+        fref = CalibReference();
+    return fref;
+}
+
+// Encode all frames for the mode, call, locator and power. Returns false if nothing can be sent
+bool TxEngineLoad(const int mode, const char *call, const char *locator, const int power)
+{
+    txMode = ModeGet(mode);
+    if (!txMode)
+        txMode = ModeGet(MODE_WSPR2);
+
+    rotationFrames[0] = txMode->encode(call, locator, power, rotation[0], rotationType[0]);
+    rotationNext[0] = 0;
+    return rotationFrames[0] > 0;
+}
+
+// Encode the beacon frames again for a new locator, e.g. the GPS square of a balloon. The
+// rotation carries on where it was unless the number of frames changed, so the type 3
+// frame still gets its turn. TxEngineLoad() must have been called first
+bool TxEngineRelocate(const char *call, const char *locator, const int power)
+{
+    int frames = txMode->encode(call, locator, power, rotation[0], rotationType[0]);
+
+    if (frames != rotationFrames[0])
+        rotationNext[0] = 0;
+    rotationFrames[0] = frames;
+    return frames > 0;
+}
+
+// Encode all frames of a message of the message table in the mode set by TxEngineLoad().
+// No call clears the message
+bool TxEngineLoadMessage(const int msg, const char *call, const char *locator, const int power)
+{
+    if ((msg <= 0) || (msg >= MSG_COUNT))
+        return false;
+
+    rotationFrames[msg] = call ? txMode->encode(call, locator, power, rotation[msg], rotationType[msg]) : 0;
+    rotationNext[msg] = 0;
+    if (txMessage == msg)
+        txMessage = 0;
+    return rotationFrames[msg] > 0;
+}
+
+// Use a message for the next frame
+bool TxEngineMessage(const int msg)
+{
+    if ((msg < 0) || (msg >= MSG_COUNT) || !rotationFrames[msg])
+        return false;
+
+    txMessage = msg;
+    return true;
+}
+
+const ModeDesc *TxEngineMode()
+{
+    return txMode;
+}
+
+// Calculate the tone registers of a table unless carrier, spacing and reference are unchanged
+static bool CalculateTable(const int table, const double carrier, const double spacing, const uint8_t tones)
+{
+    double fref = ReferenceFrequency();
+
+    if ((table < 0) || (table >= TX_TABLES))
+        return false;
+    if ((toneFref[table] == fref) && (toneTables[table].carrier == carrier) && (toneTables[table].spacing == spacing) && (toneTables[table].tones == tones))
+        return true;
+
+    toneFref[table] = ToneCalculate(fref, carrier, spacing, tones, &toneTables[table]) ? fref : 0.0;
+    return toneFref[table] != 0.0;
+}
+
+// Wait for a symbol edge, calling yield() while it is far enough away. The edge is reserved
+// on the I2C bus so jobs queued from yield() only run if they finish before it
+static void WaitUntil(const unsigned long edge)
+{
+    I2cBusReserve(edge);
+    for (;;)
+    {
+        long left = (long) (edge - micros());
+        if (left <= 0)
+            break;
+        if (left > (long) TX_YIELD_GUARD_US)
+            yield();
+    }
+}
+
+// Place the first symbol on the slot start if one is set, and switch the PA on lead + ramp
+// before it. If that is already past, or without a slot start, the PA goes on now and the
+// first symbol follows a whole lead + ramp later. Returns the time of the first symbol
+static unsigned long PaOn(const unsigned long ramp)
+{
+    unsigned long ahead = paLeadUs + ramp;
+    unsigned long edge = micros() + ahead;
+
+    txState = TX_LEAD;                 // Before any yield(), the frame is already picked
+    if (slotStartSet && ((long) (slotStartUs - edge) > 0) && ((long) (slotStartUs - micros()) <= (long) TX_START_AHEAD_US))
+    {
+        edge = slotStartUs;
+        WaitUntil(edge - ahead);
+    }
+    slotStartSet = false;
+
+    if (paPin >= 0)
+        digitalWrite(paPin, HIGH);
+    return edge;
+}
+
+// PA off hold time after the RF went off at edge
+static void PaOff(const unsigned long edge)
+{
+    txState = TX_HOLD;
+    WaitUntil(edge + paHoldUs);
+    if (paPin >= 0)
+        digitalWrite(paPin, LOW);
+    txState = TX_IDLE;
+    I2cBusRelease();
+}
+
+// Step the drive strength between 2 mA and the set drive, starting at edge and spread over
+// the ramp time. Nothing to do without a ramp
+static void Ramp(const ToneTable *a, const ToneTable *b, const unsigned long edge, const bool up)
+{
+    const int steps = max(drive[0], b ? drive[1] : (uint8_t) 0);
+
+    if (!rampUs)
+        return;
+    for (int i = 1; i <= steps; i++)
+    {
+        int level = up ? i : steps - i;
+        WaitUntil(edge + i * rampUs / (steps + 1));
+        TxFrameDrive(a, b, min(level, (int) drive[0]), min(level, (int) drive[1]), SiWrite);
+    }
+}
+
+// Calculate the tone registers of a WSPR table. The nominal frequency is the centre of the
+// tones, which is the frequency WSPR decoders report. TxEngineLoad() must have set the mode
+bool TxEngineTones(const int table, const double frequency)
+{
+    if (table == TX_TABLE_QRSS)
+        return false;
+    return CalculateTable(table, frequency - (txMode->tones - 1) * txMode->spacing / 2.0, txMode->spacing, txMode->tones);
+}
+
+// Encode the CLK1 frames. They follow the CLK0 rotation, so call and locator are the same
+// and only the reported power may differ. TxEngineLoad() must have been called first
+bool TxEngineLoadDual(const bool enable, const char *call, const char *locator, const int power)
+{
+    uint8_t types[WSPR_ROTATION_MAX];
+
+    dualOn = enable && rotationFrames[0] && (txMode->encode(call, locator, power, dualRotation, types) == rotationFrames[0]);
+    return dualOn;
+}
+
+bool TxEngineDual()
+{
+    return dualOn && (toneFref[TX_TABLE_DUAL] != 0.0);
+}
+
+// Drive strength of CLK0 and CLK1, SI5351_DRIVE_2MA .. SI5351_DRIVE_8MA
+void TxEngineDrive(const uint8_t drive0, const uint8_t drive1)
+{
+    drive[0] = drive0;
+    drive[1] = drive1;
+}
+
+// PA control pin, -1 for none
+void TxEnginePaPin(const int pin)
+{
+    paPin = pin;
+    if (paPin >= 0)
+    {
+        pinMode(paPin, OUTPUT);
+        digitalWrite(paPin, LOW);
+    }
+}
+
+// PA lead before the RF, RF ramp and PA hold after the RF
+void TxEngineSequence(const uint32_t leadMs, const uint32_t rampMs, const uint32_t holdMs)
+{
+    paLeadUs = leadMs * 1000UL;
+    rampUs = rampMs * 1000UL;
+    paHoldUs = holdMs * 1000UL;
+}
+
+// Compile the QRSS keying timeline. Returns false if the text cannot be sent
+bool TxEngineLoadQrss(const uint8_t style, const char *text, const uint32_t dotMs)
+{
+    qrssEvents = QrssCompile(text, style, qrssTimeline, QRSS_EVENTS_MAX);
+    qrssUnitUs = dotMs * 1000UL;
+    return qrssEvents > 0;
+}
+
+// Calculate the QRSS tone registers. Tone 0 is on the frequency, tone 1 shift Hz above
+bool TxEngineQrssTones(const double frequency, const double shift)
+{
+    return CalculateTable(TX_TABLE_QRSS, frequency, shift, 2);
+}
+
+// Length of the QRSS frame in s, 0 if there is none
+uint32_t TxEngineQrssLength()
+{
+    return (uint64_t) QrssUnits(qrssTimeline, qrssEvents) * qrssUnitUs / 1000000ULL;
+}
+
+// Use a table for the next frame
+bool TxEngineSelect(const int table)
+{
+    if ((table < 0) || (table >= TX_TABLES) || (toneFref[table] == 0.0))
+        return false;
+
+    txTones = &toneTables[table];
+    return true;
+}
+
+// Move the next WSPR frame, on both outputs, offset Hz from the table frequency
+void TxEngineOffset(const double offset)
+{
+    txOffset = offset;
+}
+
+// A table moved by the frame offset, or the table itself if there is none or it cannot be moved
+static const ToneTable *Offset(const ToneTable *table, ToneTable *moved)
+{
+    if (!table || (txOffset == 0.0) || !ToneShift(toneFref[table - toneTables], table, txOffset, moved))
+        return table;
+    return moved;
+}
+
+// Send a frame on the selected table, and on CLK1 if symbols1 is given. Blocks for the
+// length of the frame, 110.6 s in WSPR-2, but keeps calling yield() whenever the next
+// symbol edge is far enough away
+static bool SendFrame(const uint8_t *symbols, const uint8_t *symbols1)
+{
+    if (toneFref[txTones - toneTables] == 0.0)
+        return false;
+
+    const ToneTable *tones = Offset(txTones, &slotTones[0]);
+    const ToneTable *dual = Offset(symbols1 ? &toneTables[TX_TABLE_DUAL] : 0, &slotTones[1]);
+
+    unsigned long start = PaOn(rampUs);
+    WaitUntil(start - rampUs);
+    uint8_t drive0 = rampUs ? SI5351_DRIVE_2MA : drive[0], drive1 = rampUs ? SI5351_DRIVE_2MA : drive[1];
+    const uint8_t outputs = dual ? SI5351_OEB_CLK0 | SI5351_OEB_CLK1 : SI5351_OEB_CLK0;
+    if (dual)
+        TxFrameStartDual(tones, dual, drive0, drive1, SiWrite);
+    else
+        TxFrameStart(tones, SiWrite, drive0);
+    const uint8_t oeb = SiRead(SI5351_REG_OEB);
+    TxFrameOutputs(oeb, outputs, true, SiWrite);
+    hardware.txLed(ON);
+    txState = TX_ON;
+    Ramp(tones, dual, start - rampUs, true);
+    lastFrequency = tones->carrier + (tones->tones - 1) * tones->spacing / 2.0;
+    lastStartUs = start;
+
+    // Tone 0 is already loaded by TxFrameStart, so every symbol is a step from the last one
+    for (int k = 0; k <= txMode->symbols; k++)
+    {
+        WaitUntil(start + k * txMode->symbolPeriodUs);
+        if (k >= txMode->symbols)
+            break;
+        if (dual)
+            TxFrameStepDual(tones, k ? symbols[k - 1] : 0, symbols[k], dual, k ? symbols1[k - 1] : 0, symbols1[k], SiWrite);
+        else
+            TxFrameStep(tones, k ? symbols[k - 1] : 0, symbols[k], SiWrite);
+    }
+
+    unsigned long end = start + txMode->symbols * txMode->symbolPeriodUs;
+    Ramp(tones, dual, end, false);
+    WaitUntil(end + rampUs);
+    TxFrameOutputs(oeb, outputs, false, SiWrite);
+    if (dual)
+        TxFrameStopDual(SiWrite);
+    hardware.txLed(OFF);
+    PaOff(end + rampUs);
+    return true;
+}
+
+// Send the next frame of the rotation of the selected message. CLK1 only follows the
+// beacon message
+bool TxEngineSend()
+{
+    const int msg = txMessage;
+
+    txMessage = 0;
+    if (!rotationFrames[msg])
+        return false;
+
+    int frame = rotationNext[msg];
+    rotationNext[msg] = (rotationNext[msg] + 1) % rotationFrames[msg];
+    return SendFrame(rotation[msg][frame], (!msg && TxEngineDual()) ? dualRotation[frame] : 0);
+}
+
+// Nominal frequency of the last frame, the centre of the tones, QRSS: tone 0
+double TxEngineFrequency()
+{
+    return lastFrequency;
+}
+
+// micros() when the first symbol of the last frame started
+unsigned long TxEngineStartUs()
+{
+    return lastStartUs;
+}
+
+// Start the first symbol of the next frame at startUs, with the PA and RF sequence ahead of
+// it, instead of right away. Ignored unless it is at most TX_START_AHEAD_US ahead when the
+// frame is sent
+void TxEngineStartAt(const unsigned long startUs)
+{
+    slotStartUs = startUs;
+    slotStartSet = true;
+}
+
+// Encode the telemetry frame, a type 1 message, for the next TxEngineSendTelemetry()
+bool TxEngineLoadTelemetry(const char *call, const char *locator, const int power)
+{
+    telemetryReady = (txMode->symbols == WSPR_SYMBOL_COUNT) && (txMode->tones == WSPR_TONE_COUNT) &&
+                     WsprEncodeType1(call, locator, power, telemetry);
+    return telemetryReady;
+}
+
+// Send the loaded telemetry frame on CLK0, on the table and offset of the last frame
+bool TxEngineSendTelemetry()
+{
+    if (!telemetryReady)
+        return false;
+
+    telemetryReady = false;
+    return SendFrame(telemetry, 0);
+}
+
+// Play the QRSS timeline. Only changes are written: the differing tone registers, the RF
+// output when the timeline switches between key up and key down. The PA lead and hold
+// apply, the RF ramp does not as QRSS keys the RF on every element. Blocks for the whole
+// frame, which with long dots is hours: the WSPR slots it overlaps are not sent
+bool TxEngineSendQrss()
+{
+    const ToneTable *table = &toneTables[TX_TABLE_QRSS];
+    uint8_t tone = 0;
+    bool rf = false;
+
+    if (!qrssEvents || (toneFref[TX_TABLE_QRSS] == 0.0))
+        return false;
+
+    unsigned long edge = PaOn(0);
+    lastFrequency = table->carrier;
+    lastStartUs = edge;
+    TxFrameStart(table, SiWrite, drive[0]);
+    const uint8_t oeb = SiRead(SI5351_REG_OEB);
+    rf = !(oeb & SI5351_OEB_CLK0);                              // So a leading key up disables it
+    hardware.txLed(ON);
+    txState = TX_ON;
+
+    WaitUntil(edge);
+    for (int i = 0; i < qrssEvents; i++)
+    {
+        if (qrssTimeline[i].tone == QRSS_TONE_OFF)
+        {
+            if (rf)
+                TxFrameOutputs(oeb, SI5351_OEB_CLK0, false, SiWrite);
+            rf = false;
+        }
+        else
+        {
+            TxFrameStep(table, tone, qrssTimeline[i].tone, SiWrite);
+            tone = qrssTimeline[i].tone;
+            if (!rf)
+                TxFrameOutputs(oeb, SI5351_OEB_CLK0, true, SiWrite);
+            rf = true;
+        }
+
+        // A unit at a time, a run of up to 255 dots of 120 s is far past what a micros() edge reaches
+        for (int u = 0; u < qrssTimeline[i].units; u++)
+        {
+            edge += qrssUnitUs;
+            WaitUntil(edge);
+        }
+    }
+
+    TxFrameOutputs(oeb, SI5351_OEB_CLK0, false, SiWrite);
+    hardware.txLed(OFF);
+    PaOff(edge);
+    return true;
+}
+
+int TxEngineFrames(const int msg)
+{
+    return ((msg >= 0) && (msg < MSG_COUNT)) ? rotationFrames[msg] : 0;
+}
+
+uint8_t TxEngineType(const int frame, const int msg)
+{
+    return ((frame >= 0) && (frame < TxEngineFrames(msg))) ? rotationType[msg][frame] : 0;
+}
+
+int TxEngineNext(const int msg)
+{
+    return ((msg >= 0) && (msg < MSG_COUNT)) ? rotationNext[msg] : 0;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,60 @@
+#ifndef _TXENGINE_H
+#define _TXENGINE_H
+
+// Arduino includes
+#include <Arduino.h>
+
+#include "band.h"
+#include "message.h"
+#include "mode.h"
+#include "qrss.h"
+#include "wspr.h"
+#include "tones.h"
+
+#define TX_YIELD_GUARD_US  60000UL           // No yield() closer than this to a symbol edge
+#define TX_SEQUENCE_MAX_US (2550000UL + 255000UL)   // Longest PA lead plus RF ramp wr pa accepts
+#define TX_START_AHEAD_US  (TX_SEQUENCE_MAX_US + 100000UL)   // Longest wait for a slot start set by TxEngineStartAt()
+
+#define TX_TABLES          (BANDS_MAX + 3 + MSG_MAX)   // A tone table per band plus the beacon frequency, QRSS, CLK1 and the messages
+#define TX_TABLE_BEACON    BANDS_MAX         // Table of the single beacon frequency
+#define TX_TABLE_QRSS      (BANDS_MAX + 1)   // QRSS/FSKCW/DFCW table, 2 tones
+#define TX_TABLE_DUAL      (BANDS_MAX + 2)   // Second output on CLK1
+#define TX_TABLE_MSG       (BANDS_MAX + 3)   // Message 1 on its own frequency, MSG_MAX tables
+
+// TX state published in txState
+#define TX_IDLE            0                 // PA and RF off
+#define TX_LEAD            1                 // PA on, RF not yet
+#define TX_ON              2                 // RF on, ramping or sending symbols
+#define TX_HOLD            3                 // RF off, PA still on
+
+// Function prototypes
+bool TxEngineLoad(const int mode, const char *call, const char *locator, const int power);
+bool TxEngineRelocate(const char *call, const char *locator, const int power);
+bool TxEngineLoadMessage(const int msg, const char *call, const char *locator, const int power);
+bool TxEngineMessage(const int msg);
+const ModeDesc *TxEngineMode();
+bool TxEngineTones(const int table, const double frequency);
+bool TxEngineSelect(const int table);
+bool TxEngineSend();
+double TxEngineFrequency();
+unsigned long TxEngineStartUs();
+void TxEngineStartAt(const unsigned long startUs);
+void TxEngineOffset(const double offset);
+bool TxEngineLoadTelemetry(const char *call, const char *locator, const int power);
+bool TxEngineSendTelemetry();
+bool TxEngineLoadDual(const bool enable, const char *call, const char *locator, const int power);
+bool TxEngineDual();
+void TxEngineDrive(const uint8_t drive0, const uint8_t drive1);
+void TxEnginePaPin(const int pin);
+void TxEngineSequence(const uint32_t leadMs, const uint32_t rampMs, const uint32_t holdMs);
+bool TxEngineLoadQrss(const uint8_t style, const char *text, const uint32_t dotMs);
+bool TxEngineQrssTones(const double frequency, const double shift);
+uint32_t TxEngineQrssLength();
+bool TxEngineSendQrss();
+int TxEngineFrames(const int msg = 0);
+uint8_t TxEngineType(const int frame, const int msg = 0);
+int TxEngineNext(const int msg = 0);
+
+#endif // _TXENGINE_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,128 @@
+// Own include
+#include "txframe.h"
+
+#include <string.h>
+
+// Register sequence for one transmission on CLK0 from PLL A. Every register the TX
+// path touches goes through the SiWriteFunc, the output enables included, so a trace of
+// it is the full story. The RFzero library's rfOn() and rfOff() are not used while sending.
+// The PLL is reset once, before the first symbol. After that a tone change only rewrites
+// the fractional divider of toneReg, which the Si5351 applies without a phase jump
+
+// Dual output: CLK0 from PLL A as above plus CLK1 from PLL B. Each output has its own PLL,
+// so either one may step its PLL or its multisynth. PLL A, PLL B, MS0 and MS1 are the
+// consecutive registers 26 - 57, which lets a symbol change of both outputs go out as one
+// burst over the registers that differ
+
+#define DUAL_REGS   (SI5351_REG_MS1 + 8 - SI5351_REG_PLLA)
+
+static uint8_t ClockControl(const ToneTable *table, const bool pllB, const uint8_t drive)
+{
+    return (table->msInt ? 0x40 : 0x00) | (pllB ? SI5351_CLK_PLLB : 0x00) | 0x0C | (drive & 0x03);   // MS source
+}
+
+// Register image 26 - 57 of both outputs sending tone a and tone b
+static void DualImage(const ToneTable *a, const uint8_t toneA, const ToneTable *b, const uint8_t toneB, uint8_t *regs)
+{
+    const bool pllA = (a->toneReg == SI5351_REG_PLLA), pllB = (b->toneReg == SI5351_REG_PLLA);
+
+    memcpy(&regs[SI5351_REG_PLLA - SI5351_REG_PLLA], pllA ? a->tone[toneA] : a->pll, 8);
+    memcpy(&regs[SI5351_REG_PLLB - SI5351_REG_PLLA], pllB ? b->tone[toneB] : b->pll, 8);
+    memcpy(&regs[SI5351_REG_MS0 - SI5351_REG_PLLA], pllA ? a->ms : a->tone[toneA], 8);
+    memcpy(&regs[SI5351_REG_MS1 - SI5351_REG_PLLA], pllB ? b->ms : b->tone[toneB], 8);
+}
+
+// Load the PLL and the output multisynth for tone 0 and reset the PLL
+void TxFrameStart(const ToneTable *table, SiWriteFunc write, const uint8_t drive)
+{
+    const uint8_t clkCtrl = ClockControl(table, false, drive);
+    const uint8_t reset = SI5351_PLLA_RESET;
+
+    write(SI5351_REG_PLLA, table->pll, 8);
+    write(SI5351_REG_MS0, table->ms, 8);
+    write(SI5351_REG_CLK0_CTRL, &clkCtrl, 1);
+    write(SI5351_REG_PLL_RESET, &reset, 1);
+}
+
+// Switch to one of the precalculated tones
+void TxFrameTone(const ToneTable *table, const uint8_t tone, SiWriteFunc write)
+{
+    write(table->toneReg, table->tone[tone], 8);
+}
+
+// Switch from one tone to another writing only the registers that differ, as one burst
+// from the first to the last changed register. Nothing is written if the tone is the same
+void TxFrameStep(const ToneTable *table, const uint8_t from, const uint8_t to, SiWriteFunc write)
+{
+    const uint8_t *old = table->tone[from], *tone = table->tone[to];
+    int first = 0, last = 7;
+
+    while ((first < 8) && (old[first] == tone[first]))
+        first++;
+    if (first == 8)
+        return;
+    while (old[last] == tone[last])
+        last--;
+
+    write(table->toneReg + first, &tone[first], last - first + 1);
+}
+
+// Load both PLLs and both output multisynths for tone 0 in one burst and reset the PLLs
+void TxFrameStartDual(const ToneTable *a, const ToneTable *b, const uint8_t driveA, const uint8_t driveB, SiWriteFunc write)
+{
+    uint8_t regs[DUAL_REGS];
+    const uint8_t clkCtrl[2] = { ClockControl(a, false, driveA), ClockControl(b, true, driveB) };
+    const uint8_t reset = SI5351_PLLA_RESET | SI5351_PLLB_RESET;
+
+    DualImage(a, 0, b, 0, regs);
+    write(SI5351_REG_PLLA, regs, DUAL_REGS);
+    write(SI5351_REG_CLK0_CTRL, clkCtrl, 2);
+    write(SI5351_REG_PLL_RESET, &reset, 1);
+}
+
+// Step both outputs with one burst from the first to the last changed register
+void TxFrameStepDual(const ToneTable *a, const uint8_t fromA, const uint8_t toA,
+                     const ToneTable *b, const uint8_t fromB, const uint8_t toB, SiWriteFunc write)
+{
+    uint8_t old[DUAL_REGS], regs[DUAL_REGS];
+    int first = 0, last = DUAL_REGS - 1;
+
+    DualImage(a, fromA, b, fromB, old);
+    DualImage(a, toA, b, toB, regs);
+    while ((first < DUAL_REGS) && (old[first] == regs[first]))
+        first++;
+    if (first == DUAL_REGS)
+        return;
+    while (old[last] == regs[last])
+        last--;
+
+    write(SI5351_REG_PLLA + first, &regs[first], last - first + 1);
+}
+
+// Change the drive strength only, CLK0 and, if b is given, CLK1 in one burst. The Si5351
+// has no other level control, so this is what the sequencer ramps the RF with
+void TxFrameDrive(const ToneTable *a, const ToneTable *b, const uint8_t driveA, const uint8_t driveB, SiWriteFunc write)
+{
+    const uint8_t clkCtrl[2] = { ClockControl(a, false, driveA), b ? ClockControl(b, true, driveB) : (uint8_t) 0 };
+
+    write(SI5351_REG_CLK0_CTRL, clkCtrl, b ? 2 : 1);
+}
+
+// Power down CLK1 after the frame, once TxFrameOutputs() has disabled it
+void TxFrameStopDual(SiWriteFunc write)
+{
+    const uint8_t clkCtrl = SI5351_CLK_PDN;
+
+    write(SI5351_REG_CLK1_CTRL, &clkCtrl, 1);
+}
+
+// Enable or disable the outputs, SI5351_OEB_CLKn, in one write of the output enable
+// control. oeb is the register as read before the frame, the outputs of others are kept
+void TxFrameOutputs(const uint8_t oeb, const uint8_t outputs, const bool on, SiWriteFunc write)
+{
+    const uint8_t value = on ? (oeb & ~outputs) : (oeb | outputs);
+
+    write(SI5351_REG_OEB, &value, 1);
+}
+
+// ----------------- EOF -------------------------------------------------------------------
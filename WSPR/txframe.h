@@ -0,0 +1,45 @@
+#ifndef _TXFRAME_H
+#define _TXFRAME_H
+
+// Plain C++ so the register sequence can also be built on a host
+#include <stdint.h>
+
+#include "tones.h"
+
+#define SI5351_I2C_ADDR     0x60
+#define SI5351_REG_OEB         3
+#define SI5351_REG_CLK0_CTRL  16
+#define SI5351_REG_CLK1_CTRL  17
+#define SI5351_REG_MS1        50
+#define SI5351_REG_PLL_RESET 177
+#define SI5351_PLLA_RESET   0x20
+#define SI5351_PLLB_RESET   0x80
+#define SI5351_CLK_PDN      0x80           // CLKn control: output powered down
+#define SI5351_CLK_PLLB     0x20           // CLKn control: multisynth fed by PLL B
+#define SI5351_OEB_CLK0     0x01           // Output enable control: CLK0 disabled
+#define SI5351_OEB_CLK1     0x02           // Output enable control: CLK1 disabled
+
+// Output drive strength, CLKn control bits 1:0
+#define SI5351_DRIVE_2MA       0
+#define SI5351_DRIVE_4MA       1
+#define SI5351_DRIVE_6MA       2
+#define SI5351_DRIVE_8MA       3
+
+// Writes len consecutive registers starting at reg in one I2C transaction. The sketch
+// writes to the Si5351 over Wire, the host tools to a simulated register file
+typedef void (*SiWriteFunc)(const uint8_t reg, const uint8_t *data, const uint8_t len);
+
+// Function prototypes
+void TxFrameStart(const ToneTable *table, SiWriteFunc write, const uint8_t drive = SI5351_DRIVE_8MA);
+void TxFrameTone(const ToneTable *table, const uint8_t tone, SiWriteFunc write);
+void TxFrameStep(const ToneTable *table, const uint8_t from, const uint8_t to, SiWriteFunc write);
+void TxFrameStartDual(const ToneTable *a, const ToneTable *b, const uint8_t driveA, const uint8_t driveB, SiWriteFunc write);
+void TxFrameStepDual(const ToneTable *a, const uint8_t fromA, const uint8_t toA,
+                     const ToneTable *b, const uint8_t fromB, const uint8_t toB, SiWriteFunc write);
+void TxFrameStopDual(SiWriteFunc write);
+void TxFrameOutputs(const uint8_t oeb, const uint8_t outputs, const bool on, SiWriteFunc write);
+void TxFrameDrive(const ToneTable *a, const ToneTable *b, const uint8_t driveA, const uint8_t driveB, SiWriteFunc write);
+
+#endif // _TXFRAME_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,339 @@
+// Own include
+#include "wspr.h"
+
+#include <string.h>
+
+// WSPR source encoding, K=32 r=1/2 convolutional coding, bit reversal interleaving
+// and sync merging as specified by K1JT for WSJT/WSJT-X
+
+#define WSPR_POLY1 0xF2D05351UL
+#define WSPR_POLY2 0xE4613C47UL
+
+const uint8_t wsprSync[WSPR_SYMBOL_COUNT] =
+{
+    1, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 1,
+    0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 0, 1, 0, 0, 0, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1,
+    0, 0, 1, 0, 1, 1, 0, 0, 0, 1, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1, 1, 0, 1, 1, 0, 0, 1, 1,
+    0, 1, 0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 0, 1, 1, 0, 0, 0, 1, 1, 0,
+    0, 0,
+};
+
+// 0-9: 0-9, A-Z: 10-35, space: 36, anything else: -1
+static int CharCode(const char ch)
+{
+    if ((ch >= '0') && (ch <= '9'))
+        return ch - '0';
+    if ((ch >= 'A') && (ch <= 'Z'))
+        return ch - 'A' + 10;
+    if (ch == ' ')
+        return 36;
+    return -1;
+}
+
+static uint8_t Parity(uint32_t value)
+{
+    value ^= value >> 16;
+    value ^= value >> 8;
+    value ^= value >> 4;
+    value &= 0xF;
+    return (0x6996 >> value) & 1;
+}
+
+static uint8_t BitReverse8(uint8_t value)
+{
+    value = (value & 0xF0) >> 4 | (value & 0x0F) << 4;
+    value = (value & 0xCC) >> 2 | (value & 0x33) << 2;
+    value = (value & 0xAA) >> 1 | (value & 0x55) << 1;
+    return value;
+}
+
+bool WsprValidPower(const int power)
+{
+    return (power >= 0) && (power <= 60) && ((power % 10 == 0) || ((power - 3) % 10 == 0) || ((power - 7) % 10 == 0));
+}
+
+// Pack a standard call sign into 28 bits. The digit must be the third character, so
+// calls like G4ABC are shifted right by one
+static bool PackCall(const char *call, uint32_t *n)
+{
+    char c[6];
+    int len = strlen(call);
+
+    if ((len < 3) || (len > 6))
+        return false;
+
+    int shift = ((call[1] >= '0') && (call[1] <= '9') && !((call[2] >= '0') && (call[2] <= '9'))) ? 1 : 0;
+    if (len + shift > 6)
+        return false;
+
+    for (int i = 0; i < 6; i++)
+    {
+        int j = i - shift;
+        c[i] = ((j >= 0) && (j < len)) ? call[j] : ' ';
+        if ((c[i] >= 'a') && (c[i] <= 'z'))
+            c[i] -= 'a' - 'A';
+    }
+
+    int code[6];
+    for (int i = 0; i < 6; i++)
+        code[i] = CharCode(c[i]);
+
+    if ((code[0] < 0) || (code[1] < 0) || (code[1] == 36) || (code[2] < 0) || (code[2] > 9))
+        return false;
+    for (int i = 3; i < 6; i++)
+        if (code[i] < 10)
+            return false;
+
+    *n = code[0];
+    *n = *n * 36 + code[1];
+    *n = *n * 10 + code[2];
+    *n = *n * 27 + code[3] - 10;
+    *n = *n * 27 + code[4] - 10;
+    *n = *n * 27 + code[5] - 10;
+    return true;
+}
+
+// Pack a 4 character locator into 15 bits. Extra characters, e.g. a sub square, are ignored
+static bool PackLocator(const char *locator, uint32_t *m)
+{
+    char l[4];
+
+    if (strlen(locator) < 4)
+        return false;
+    for (int i = 0; i < 4; i++)
+        l[i] = ((locator[i] >= 'a') && (locator[i] <= 'z')) ? locator[i] - ('a' - 'A') : locator[i];
+
+    if ((l[0] < 'A') || (l[0] > 'R') || (l[1] < 'A') || (l[1] > 'R') || (l[2] < '0') || (l[2] > '9') || (l[3] < '0') || (l[3] > '9'))
+        return false;
+
+    *m = (179 - 10 * (l[0] - 'A') - (l[2] - '0')) * 180 + 10 * (l[1] - 'A') + (l[3] - '0');
+    return true;
+}
+
+// Pack a 6 character locator as a call sign for a type 3 message, JO65AB becomes O65ABJ
+static bool PackLocator6(const char *locator, uint32_t *n)
+{
+    char l[7];
+
+    if (strlen(locator) < 6)
+        return false;
+    for (int i = 0; i < 6; i++)
+        l[i] = ((locator[i] >= 'a') && (locator[i] <= 'z')) ? locator[i] - ('a' - 'A') : locator[i];
+    l[6] = 0;
+
+    uint32_t m;
+    if (!PackLocator(l, &m) || (l[4] < 'A') || (l[4] > 'X') || (l[5] < 'A') || (l[5] > 'X'))
+        return false;
+
+    char c[7] = { l[1], l[2], l[3], l[4], l[5], l[0], 0 };
+    return PackCall(c, n);
+}
+
+// Pack the prefix or suffix of a compound call into 16 bits and the base call into 28 bits.
+// 1 to 3 character prefixes are base 37 numbers below 60000, a one character suffix is
+// 60000 + 0..35 and a two digit suffix 60000 + 26 + 10..99
+static bool PackCompound(const char *call, uint32_t *n, uint32_t *affix)
+{
+    const char *slash = strchr(call, '/');
+    char base[7];
+
+    if (!slash || strchr(slash + 1, '/'))
+        return false;
+
+    int pre = slash - call, post = strlen(slash + 1);
+    if ((pre >= 1) && (pre <= 3) && (post >= 3) && (post <= 6))
+    {   // Prefix
+        *affix = 0;
+        for (int i = pre - 3; i < pre; i++)
+        {
+            int code = (i >= 0) ? CharCode(call[i]) : 36;
+            if ((i >= 0) && ((code < 0) || (code == 36)))
+                return false;
+            *affix = *affix * 37 + code;
+        }
+        return PackCall(slash + 1, n);
+    }
+    if ((pre < 3) || (pre > 6))
+        return false;
+
+    int code1 = CharCode(slash[1]), code2 = CharCode(slash[2]);
+    if ((post == 1) && (code1 >= 0) && (code1 < 36))
+        *affix = 60000 + code1;
+    else if ((post == 2) && (code1 >= 1) && (code1 <= 9) && (code2 >= 0) && (code2 <= 9))
+        *affix = 60000 + 26 + 10 * code1 + code2;
+    else
+        return false;
+
+    memcpy(base, call, pre);
+    base[pre] = 0;
+    return PackCall(base, n);
+}
+
+// Bob Jenkins' lookup3 hashlittle(), byte by byte so it is independent of alignment and endianness
+#define ROT(x, k) (((x) << (k)) | ((x) >> (32 - (k))))
+
+static uint32_t HashLittle(const uint8_t *k, uint32_t length, const uint32_t initval)
+{
+    uint32_t a, b, c;
+
+    a = b = c = 0xDEADBEEF + length + initval;
+    while (length > 12)
+    {
+        a += k[0] | ((uint32_t) k[1] << 8) | ((uint32_t) k[2] << 16) | ((uint32_t) k[3] << 24);
+        b += k[4] | ((uint32_t) k[5] << 8) | ((uint32_t) k[6] << 16) | ((uint32_t) k[7] << 24);
+        c += k[8] | ((uint32_t) k[9] << 8) | ((uint32_t) k[10] << 16) | ((uint32_t) k[11] << 24);
+        a -= c; a ^= ROT(c, 4);  c += b;
+        b -= a; b ^= ROT(a, 6);  a += c;
+        c -= b; c ^= ROT(b, 8);  b += a;
+        a -= c; a ^= ROT(c, 16); c += b;
+        b -= a; b ^= ROT(a, 19); a += c;
+        c -= b; c ^= ROT(b, 4);  b += a;
+        length -= 12;
+        k += 12;
+    }
+    if (length == 0)
+        return c;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        uint32_t v = (uint32_t) k[i] << (8 * (i % 4));
+        if (i < 4)
+            a += v;
+        else if (i < 8)
+            b += v;
+        else
+            c += v;
+    }
+    c ^= b; c -= ROT(b, 14);
+    a ^= c; a -= ROT(c, 11);
+    b ^= a; b -= ROT(a, 25);
+    c ^= b; c -= ROT(b, 16);
+    a ^= c; a -= ROT(c, 4);
+    b ^= a; b -= ROT(a, 14);
+    c ^= b; c -= ROT(b, 24);
+    return c;
+}
+
+// 15 bit hash of the full call sign as used by WSJT-X for type 3 messages
+uint16_t WsprCallHash(const char *call)
+{
+    uint8_t c[16];
+    uint32_t len = 0;
+
+    for (; call[len] && (len < sizeof(c)); len++)
+        c[len] = ((call[len] >= 'a') && (call[len] <= 'z')) ? call[len] - ('a' - 'A') : call[len];
+    return HashLittle(c, len, 146) & 0x7FFF;
+}
+
+// Convolutionally encode the 50 bit message (28 bit N and 22 bit M), interleave and merge with sync
+static void EncodeMessage(const uint32_t n, const uint32_t m, uint8_t *symbols)
+{
+    uint8_t data[11];
+    uint8_t coded[WSPR_SYMBOL_COUNT];
+
+    memset(data, 0, sizeof(data));
+    data[0] = n >> 20;
+    data[1] = n >> 12;
+    data[2] = n >> 4;
+    data[3] = ((n & 0x0F) << 4) | ((m >> 18) & 0x0F);
+    data[4] = m >> 10;
+    data[5] = m >> 2;
+    data[6] = (m & 0x03) << 6;
+
+    uint32_t reg = 0;
+    for (int i = 0; i < WSPR_SYMBOL_COUNT / 2; i++)
+    {
+        reg = (reg << 1) | ((data[i / 8] >> (7 - (i % 8))) & 1);
+        coded[2 * i] = Parity(reg & WSPR_POLY1);
+        coded[2 * i + 1] = Parity(reg & WSPR_POLY2);
+    }
+
+    int p = 0;
+    for (int i = 0; i < 256; i++)
+    {
+        uint8_t j = BitReverse8(i);
+        if (j < WSPR_SYMBOL_COUNT)
+            symbols[j] = wsprSync[j] + 2 * coded[p++];
+    }
+}
+
+// Type 1 message: standard call, 4 character locator and power. Returns false if the message cannot be encoded
+bool WsprEncodeType1(const char *call, const char *locator, const int power, uint8_t *symbols)
+{
+    uint32_t n, m;
+
+    if (!PackCall(call, &n) || !PackLocator(locator, &m) || !WsprValidPower(power))
+        return false;
+
+    EncodeMessage(n, m * 128 + power + 64, symbols);
+    return true;
+}
+
+// Type 2 message: compound call with a prefix or suffix and power, no locator
+bool WsprEncodeType2(const char *call, const int power, uint8_t *symbols)
+{
+    uint32_t n, affix;
+    char c[16];
+
+    if (strlen(call) >= sizeof(c))
+        return false;
+    for (int i = 0; (c[i] = call[i]); i++)
+        if ((c[i] >= 'a') && (c[i] <= 'z'))
+            c[i] -= 'a' - 'A';
+
+    if (!PackCompound(c, &n, &affix) || !WsprValidPower(power))
+        return false;
+
+    // Bit 15 of the affix moves into the power field, which stays a non type 1 level
+    EncodeMessage(n, (affix & 0x7FFF) * 128 + power + 1 + (affix >> 15) + 64, symbols);
+    return true;
+}
+
+// Type 3 message: hashed call, 6 character locator and power
+bool WsprEncodeType3(const char *call, const char *locator, const int power, uint8_t *symbols)
+{
+    uint32_t n;
+
+    if (!*call || !PackLocator6(locator, &n) || !WsprValidPower(power))
+        return false;
+
+    EncodeMessage(n, (uint32_t) WsprCallHash(call) * 128 - (power + 1) + 64, symbols);
+    return true;
+}
+
+// The frames WSJT-X would send for this call, locator and power, in transmission order:
+//     standard call, 4 character locator   type 1
+//     standard call, 6 character locator   type 1, type 3
+//     compound call, 4 character locator   type 2
+//     compound call, 6 character locator   type 2, type 3
+// Returns the number of frames, 0 if the call cannot be sent at all
+int WsprEncodeRotation(const char *call, const char *locator, const int power, uint8_t symbols[][WSPR_SYMBOL_COUNT], uint8_t *types)
+{
+    int frames = 0;
+
+    if (WsprEncodeType1(call, locator, power, symbols[frames]))
+        types[frames++] = WSPR_TYPE1;
+    else if (WsprEncodeType2(call, power, symbols[frames]))
+        types[frames++] = WSPR_TYPE2;
+    else
+        return 0;
+
+    if (WsprEncodeType3(call, locator, power, symbols[frames]))
+        types[frames++] = WSPR_TYPE3;
+    return frames;
+}
+
+// Four 2 bit symbols per byte, first symbol in the most significant bits
+void WsprPackSymbols(const uint8_t *symbols, uint8_t *packed)
+{
+    memset(packed, 0, (WSPR_SYMBOL_COUNT + 3) / 4);
+    for (int i = 0; i < WSPR_SYMBOL_COUNT; i++)
+        packed[i / 4] |= (symbols[i] & 0x03) << (6 - 2 * (i % 4));
+}
+
+void WsprUnpackSymbols(const uint8_t *packed, uint8_t *symbols)
+{
+    for (int i = 0; i < WSPR_SYMBOL_COUNT; i++)
+        symbols[i] = (packed[i / 4] >> (6 - 2 * (i % 4))) & 0x03;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,33 @@
+#ifndef _WSPR_H
+#define _WSPR_H
+
+// Plain C++ so the encoder can also be built on a host
+#include <stdint.h>
+
+#define WSPR_SYMBOL_COUNT    162                 // Channel symbols per WSPR frame
+#define WSPR_TONE_COUNT        4                 // 4-FSK
+#define WSPR_TONE_SPACING    (12000.0 / 8192.0)  // ~1.4648 Hz
+#define WSPR_SYMBOL_PERIOD_US 682667UL           // 8192 / 12000 s
+#define WSPR_ROTATION_MAX      2                 // Max frames in a type 1/2/3 rotation
+
+// Message types
+#define WSPR_TYPE1             1                 // Standard call, 4 character locator, power
+#define WSPR_TYPE2             2                 // Compound call, power
+#define WSPR_TYPE3             3                 // Hashed call, 6 character locator, power
+
+// Sync vector, bit 0 of every channel symbol
+extern const uint8_t wsprSync[WSPR_SYMBOL_COUNT];
+
+// Function prototypes
+bool WsprValidPower(const int power);
+bool WsprEncodeType1(const char *call, const char *locator, const int power, uint8_t *symbols);
+bool WsprEncodeType2(const char *call, const int power, uint8_t *symbols);
+bool WsprEncodeType3(const char *call, const char *locator, const int power, uint8_t *symbols);
+int WsprEncodeRotation(const char *call, const char *locator, const int power, uint8_t symbols[][WSPR_SYMBOL_COUNT], uint8_t *types);
+uint16_t WsprCallHash(const char *call);
+void WsprPackSymbols(const uint8_t *symbols, uint8_t *packed);
+void WsprUnpackSymbols(const uint8_t *packed, uint8_t *symbols);
+
+#endif // _WSPR_H
+
+// ----------------- EOF -------------------------------------------------------------------
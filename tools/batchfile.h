@@ -0,0 +1,59 @@
+#ifndef _BATCHFILE_H
+#define _BATCHFILE_H
+
+#include <stdint.h>
+
+#include "wspr.h"
+#include "tones.h"
+
+// wsprbatch output file. Little endian, a 160 byte header followed by count fixed size
+// records, so the file can be memory mapped and indexed directly
+
+#define BATCH_MAGIC          "RFZW"
+#define BATCH_VERSION        3
+#define BATCH_EEPROM_BASE    0               // EEPROM address of BatchRecord.eeprom[0]
+#define BATCH_EEPROM_SIZE    1024            // The whole 24LC08B. The mask flags the configuration
+                                             // fields, the calibration history and the bytes of
+                                             // the RFzero library are left as they are
+
+// Record status
+#define BATCH_OK             0
+#define BATCH_BAD_MESSAGE    1               // Call, locator or power cannot be encoded
+#define BATCH_BAD_FREQUENCY  2               // Frequency or reference out of range
+#define BATCH_BAD_LINE       3               // CSV line could not be parsed
+#define BATCH_BAD_SETTING    4               // Setting unknown or out of range
+
+struct BatchHeader
+{
+    char magic[4];                           // BATCH_MAGIC, not terminated
+    uint16_t version;                        // BATCH_VERSION
+    uint16_t recordSize;                     // sizeof(BatchRecord)
+    uint32_t count;                          // Number of records
+    uint32_t eepromBase;                     // BATCH_EEPROM_BASE
+    uint8_t eepromMask[BATCH_EEPROM_SIZE / 8]; // Bit n (LSB first) set: eeprom[n] is a sketch field and must be programmed
+    uint8_t reserved[16];
+};
+
+struct BatchRecord
+{
+    uint32_t line;                           // CSV line number, 1 based
+    uint8_t status;                          // BATCH_OK etc.
+    uint8_t toneReg;                         // Si5351 register the tone images go to
+    uint8_t msInt;                           // 1: output multisynth in integer mode
+    uint8_t frames;                          // Frames in the type 1/2/3 rotation, symbols holds the first
+    double frequency;                        // Nominal beacon frequency in Hz
+    double fref;                             // Si5351 reference frequency in Hz
+    uint8_t symbols[(WSPR_SYMBOL_COUNT + 3) / 4]; // First frame of the mode, packed as WsprPackSymbols()
+    uint8_t pad[7];
+    uint8_t pll[8];                          // PLL A register image, from register 26
+    uint8_t ms[8];                           // Output multisynth register image
+    uint8_t tone[WSPR_TONE_COUNT][8];        // Per tone register image for toneReg, the mode's tones centred on frequency
+    uint8_t eeprom[BATCH_EEPROM_SIZE];       // EEPROM image, unowned bytes are 0xFF
+};
+
+static_assert(sizeof(BatchHeader) == 160, "BatchHeader layout");
+static_assert(sizeof(BatchRecord) == 1144, "BatchRecord layout");
+
+#endif // _BATCHFILE_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,31 @@
+#ifndef _ARDUINO_HOST_H
+#define _ARDUINO_HOST_H
+
+// Host build stand-in for the Arduino core, just enough for the sketch's fmt.cpp and
+// selftest.cpp to be built by the host tools with PROFILER_ENABLED 0. SerialUSB is defined
+// by the tool
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+template <class T> static inline T min(const T a, const T b) { return (b < a) ? b : a; }
+template <class T> static inline T max(const T a, const T b) { return (a < b) ? b : a; }
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    size_t print(const char *s) { size_t n = 0; while (*s) n += write((uint8_t) *s++); return n; }
+    size_t println(const char *s) { return print(s) + write('\n'); }
+};
+
+extern Print &SerialUSB;
+
+#endif // _ARDUINO_HOST_H
+
+// ----------------- EOF -------------------------------------------------------------------
@@ -0,0 +1,9 @@
+#ifndef _RFZERO_MODES_HOST_H
+#define _RFZERO_MODES_HOST_H
+
+// Host build stand-in for the RFzero library header so the sketch's config.h
+// (EEPROM map) can be included by the host tools. Nothing from the library is used
+
+#endif // _RFZERO_MODES_HOST_H
+
+// ----------------- EOF -------------------------------------------------------------------
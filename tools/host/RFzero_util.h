@@ -0,0 +1,9 @@
+#ifndef _RFZERO_UTIL_HOST_H
+#define _RFZERO_UTIL_HOST_H
+
+// Host build stand-in for the RFzero library header so the sketch's fmt.cpp can be built
+// by the host tools. Nothing from the library is used with PROFILER_ENABLED 0
+
+#endif // _RFZERO_UTIL_HOST_H
+
+// ----------------- EOF -------------------------------------------------------------------
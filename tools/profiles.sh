@@ -0,0 +1,31 @@
+#!/bin/sh
+# Build the sketch once per build profile of WSPR/profiles.h and report the footprints
+#
+#   tools/profiles.sh FQBN [PROFILE...]
+#
+# FQBN is the board of the RFzero core as arduino-cli lists it. Without profiles all four
+# are built, each to build/<profile>, so the .bin of each one can be uploaded as it is
+
+set -e
+
+if [ -z "$1" ]; then
+    echo "usage: $0 FQBN [full|headless|balloon|lab ...]" >&2
+    exit 1
+fi
+fqbn="$1"; shift
+[ $# -eq 0 ] && set -- full headless balloon lab
+
+cd "$(dirname "$0")/.."
+for profile in "$@"; do
+    case "$profile" in
+        full)     n=0 ;;
+        headless) n=1 ;;
+        balloon)  n=2 ;;
+        lab)      n=3 ;;
+        *)        echo "unknown profile $profile" >&2; exit 1 ;;
+    esac
+    echo "== $profile"
+    arduino-cli compile --fqbn "$fqbn" --output-dir "build/$profile" \
+        --build-property "compiler.cpp.extra_flags=-DWSPR_PROFILE=$n" WSPR \
+        | grep -E "^(Sketch uses|Global variables)"
+done
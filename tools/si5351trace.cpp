@@ -0,0 +1,418 @@
+/*
+    si5351trace
+
+    Rebuilds the Si5351 CLK0 or CLK1 output frequency over time from a register write
+    trace and reports the timing and tone quality of the transmitted frame:
+        symbol period error, tone spacing, drift per tone, PLL resets, transient
+        frequencies inside a register burst and I2C bytes per symbol.
+
+    A PLL reset or a CLKn control write after the first symbol breaks the phase of the
+    output, unless it only changes the drive strength as the sketch's RF ramp does.
+    Such a trace fails the phase continuity check and the exit status is 2.
+
+    The trace is either read from a file or produced by simulating a WSPR frame through
+    the sketch's own tones.cpp and txframe.cpp into a simulated register sink, on CLK0
+    alone or on CLK0 and CLK1 as the sketch's dual output does, output enables included.
+    An output disabled in the output enable control, register 3, counts as off.
+
+    Usage
+        si5351trace [options] TRACE.txt
+        si5351trace [options] -s CALL LOCATOR POWER FREQUENCY
+
+    Options
+        -r FREF     Si5351 reference frequency in Hz, default 27000000
+        -M MODE     mode as "wr mode", 0: WSPR-2 (default), 1: WSPR-15
+        -d FREQ2    simulate the dual output, CLK1 on FREQ2
+        -a OFFSET   simulate a slot offset of OFFSET Hz, as wr offset places the frame
+        -c OUTPUT   output to analyze, 0: CLK0 (default), 1: CLK1
+        -k HZ       simulated I2C clock, default 100000
+        -j US       simulated symbol edge jitter, uniform +/- US microseconds
+        -o FILE     write the simulated trace to FILE
+        -t          print the frequency timeline
+
+    Trace format, one register write transaction per line, # starts a comment
+        TIME_US REG DATA...        REG and DATA in hex, e.g.  682667 2a 00 01 00 0d 80 00 00 00
+        TIME_US end                end of the frame, optional. Unchanged tones are not
+                                   rewritten, so without it trailing repeats are not counted
+*/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mode.h"
+#include "wspr.h"
+#include "tones.h"
+#include "txframe.h"
+
+#define BURST_GAP_US     5000            // Writes closer than this belong to the same symbol change
+#define LEVEL_TOLERANCE  0.1             // Hz, steady frequencies closer than this are the same tone
+
+struct TraceWrite
+{
+    uint64_t t;                          // Microseconds
+    uint8_t reg;
+    uint8_t len;
+    uint8_t data[32];
+};
+
+struct Burst
+{
+    uint64_t t;                          // Start of the first write
+    double freq;                         // Steady frequency after the burst
+    int transients;                      // Intermediate frequencies seen inside the burst
+};
+
+static const ModeDesc *mode = ModeGet(MODE_WSPR2);
+static int clkOutput = 0;                  // Analyzed output, 0: CLK0, 1: CLK1
+
+// Simulated register sink
+static std::vector<TraceWrite> trace;
+static uint64_t frameEnd;                // 0: not in the trace
+static uint64_t simTime;
+static double i2cClock = 100000.0;
+
+static void SinkWrite(const uint8_t reg, const uint8_t *data, const uint8_t len)
+{
+    TraceWrite w;
+
+    w.t = simTime;
+    w.reg = reg;
+    w.len = std::min<uint8_t>(len, sizeof(w.data));
+    memcpy(w.data, data, w.len);
+    trace.push_back(w);
+
+    // 9 bit times per byte for device address, register and data
+    simTime += (uint64_t) ((len + 2) * 9 * 1.0e6 / i2cClock + 0.5);
+}
+
+// The first frame of the rotation, tones centred on freq as the sketch's TX engine does.
+// With freq2 the same frame also goes out on CLK1
+static bool Simulate(const char *call, const char *locator, const int power, const double freq, const double freq2,
+                     const double fref, const double jitter, const double offset)
+{
+    uint8_t rotation[WSPR_ROTATION_MAX][MODE_SYMBOLS_MAX], types[WSPR_ROTATION_MAX];
+    const uint8_t *symbols = rotation[0];
+    ToneTable table, table2;
+
+    if (!mode->encode(call, locator, power, rotation, types))
+    {
+        fprintf(stderr, "cannot encode %s %s %d in %s\n", call, locator, power, mode->name);
+        return false;
+    }
+    if (!ToneCalculate(fref, freq - (mode->tones - 1) * mode->spacing / 2.0, mode->spacing, mode->tones, &table))
+    {
+        fprintf(stderr, "cannot calculate tones for %.0f Hz\n", freq);
+        return false;
+    }
+    if (freq2 && !ToneCalculate(fref, freq2 - (mode->tones - 1) * mode->spacing / 2.0, mode->spacing, mode->tones, &table2))
+    {
+        fprintf(stderr, "cannot calculate tones for %.0f Hz\n", freq2);
+        return false;
+    }
+    if (offset != 0.0)
+    {
+        // The slot offset as the TX engine applies it, moved from the cached tables
+        ToneTable base = table, base2 = table2;
+        if (!ToneShift(fref, &base, offset, &table) || (freq2 && !ToneShift(fref, &base2, offset, &table2)))
+        {
+            fprintf(stderr, "cannot move the tones by %.1f Hz\n", offset);
+            return false;
+        }
+    }
+
+    // Both outputs disabled before the frame, as the sketch leaves them
+    const uint8_t outputs = freq2 ? SI5351_OEB_CLK0 | SI5351_OEB_CLK1 : SI5351_OEB_CLK0;
+    simTime = 0;
+    if (freq2)
+        TxFrameStartDual(&table, &table2, SI5351_DRIVE_8MA, SI5351_DRIVE_8MA, SinkWrite);
+    else
+        TxFrameStart(&table, SinkWrite);
+    TxFrameOutputs(0xFF, outputs, true, SinkWrite);
+    for (int k = 0; k < mode->symbols; k++)
+    {
+        uint64_t edge = (uint64_t) k * mode->symbolPeriodUs;
+        if (jitter > 0.0)
+            edge += (int64_t) ((2.0 * rand() / RAND_MAX - 1.0) * jitter);
+        simTime = std::max(simTime, edge);
+        if (freq2)
+            TxFrameStepDual(&table, k ? symbols[k - 1] : 0, symbols[k], &table2, k ? symbols[k - 1] : 0, symbols[k], SinkWrite);
+        else
+            TxFrameStep(&table, k ? symbols[k - 1] : 0, symbols[k], SinkWrite);
+    }
+    frameEnd = (uint64_t) mode->symbols * mode->symbolPeriodUs;
+    simTime = frameEnd;
+    TxFrameOutputs(0xFF, outputs, false, SinkWrite);
+    if (freq2)
+        TxFrameStopDual(SinkWrite);
+    return true;
+}
+
+static bool ReadTrace(const char *name)
+{
+    FILE *f = fopen(name, "r");
+    char line[256];
+
+    if (!f)
+    {
+        perror(name);
+        return false;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        char *p = line;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if ((*p == '#') || (*p == '\n') || (*p == '\r') || !*p)
+            continue;
+
+        TraceWrite w;
+        char *end;
+        w.t = strtoull(p, &end, 10);
+        while (*end == ' ' || *end == '\t')
+            end++;
+        if (0 == strncmp(end, "end", 3))
+        {
+            frameEnd = w.t;
+            continue;
+        }
+        w.reg = strtoul(end, &end, 16);
+        w.len = 0;
+        for (;;)
+        {
+            char *next;
+            unsigned long v = strtoul(end, &next, 16);
+            if ((next == end) || (w.len == sizeof(w.data)))
+                break;
+            w.data[w.len++] = v;
+            end = next;
+        }
+        trace.push_back(w);
+    }
+    fclose(f);
+    return true;
+}
+
+static void WriteTrace(const char *name)
+{
+    FILE *f = fopen(name, "w");
+
+    if (!f)
+    {
+        perror(name);
+        return;
+    }
+    fprintf(f, "# Si5351 register trace: time in us, register and data in hex\n");
+    for (const TraceWrite &w : trace)
+    {
+        fprintf(f, "%llu %02x", (unsigned long long) w.t, w.reg);
+        for (int i = 0; i < w.len; i++)
+            fprintf(f, " %02x", w.data[i]);
+        fprintf(f, "\n");
+    }
+    if (frameEnd)
+        fprintf(f, "%llu end\n", (unsigned long long) frameEnd);
+    fclose(f);
+}
+
+static double OutputFrequency(const uint8_t *regs, const double fref)
+{
+    const uint8_t ctrl = regs[SI5351_REG_CLK0_CTRL + clkOutput];
+    const uint8_t *pll = &regs[(ctrl & SI5351_CLK_PLLB) ? SI5351_REG_PLLB : SI5351_REG_PLLA];
+    const uint8_t *ms = &regs[SI5351_REG_MS0 + 8 * clkOutput];
+
+    // An unprogrammed multisynth reads back as P3 = 0
+    if ((ctrl & SI5351_CLK_PDN) || (regs[SI5351_REG_OEB] & (SI5351_OEB_CLK0 << clkOutput)))
+        return 0.0;
+    if (!(pll[0] | pll[1] | (pll[5] & 0xF0)))
+        return 0.0;
+    if (!(ms[0] | ms[1] | (ms[5] & 0xF0) | (ms[2] & 0x0C)))
+        return 0.0;
+    return ToneFrequency(fref, pll, ms);
+}
+
+// Returns false if the phase continuity check fails
+static bool Analyze(const double fref, const bool timeline)
+{
+    uint8_t regs[256];
+    std::vector<Burst> bursts;
+    unsigned long bytes = 0;
+    int pllResets = 0, lateResets = 0, lateCtrl = 0;
+    double steady = 0.0;
+
+    memset(regs, 0, sizeof(regs));
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        const TraceWrite &w = trace[i];
+
+        if (frameEnd && (w.t >= frameEnd))
+            break;                                             // Switching off after the frame
+        if (bursts.empty() || (w.t - trace[i - 1].t > BURST_GAP_US))
+        {
+            if (!bursts.empty())
+                steady = bursts.back().freq;
+            bursts.push_back({ w.t, 0.0, 0 });
+        }
+
+        for (int n = 0; n < w.len; n++)
+        {
+            uint8_t reg = w.reg + n;
+            uint8_t old = regs[reg];
+            regs[reg] = w.data[n];
+            if ((reg == SI5351_REG_PLL_RESET) && (w.data[n] & (SI5351_PLLA_RESET | SI5351_PLLB_RESET)))
+            {
+                pllResets++;
+                if (bursts.size() > 1)
+                    lateResets++;
+            }
+            if (((reg == SI5351_REG_CLK0_CTRL) || (reg == SI5351_REG_CLK1_CTRL)) && (bursts.size() > 1) && ((old ^ w.data[n]) & ~0x03))
+                lateCtrl++;
+        }
+        bytes += w.len + 2;
+
+        double f = OutputFrequency(regs, fref);
+        bool last = (i + 1 == trace.size()) || (trace[i + 1].t - w.t > BURST_GAP_US) || (frameEnd && (trace[i + 1].t >= frameEnd));
+        if (!last && (f != 0.0) && (fabs(f - steady) > LEVEL_TOLERANCE) && (bursts.size() > 1))
+            bursts.back().transients++;                        // Neither the old nor yet the new tone
+        bursts.back().freq = f;
+
+        if (timeline)
+            printf("%12llu us  %16.4f Hz\n", (unsigned long long) w.t, f);
+    }
+
+    if (bursts.empty())
+    {
+        printf("Empty trace\n");
+        return true;
+    }
+
+    // Symbol timing. A burst may span several symbols if unchanged tones are not rewritten
+    const double period = mode->symbolPeriodUs;
+    double errSum = 0.0, errSq = 0.0, errMax = 0.0;
+    int symbols = 1, transients = 0;
+    for (size_t i = 1; i < bursts.size(); i++)
+    {
+        double dt = (double) (bursts[i].t - bursts[i - 1].t);
+        int m = std::max(1, (int) lround(dt / period));
+        double err = dt - m * period;
+        errSum += err;
+        errSq += err * err;
+        errMax = std::max(errMax, fabs(err));
+        symbols += m;
+    }
+    if (frameEnd > bursts.back().t)
+        symbols += std::max(1, (int) lround((frameEnd - bursts.back().t) / period)) - 1;   // Repeats of the last tone
+    for (const Burst &b : bursts)
+        transients += b.transients;
+    int gaps = bursts.size() - 1;
+
+    // Tone levels from the steady frequencies
+    std::vector<double> levels, lo, hi;
+    for (const Burst &b : bursts)
+    {
+        if (b.freq == 0.0)
+            continue;
+        size_t j = 0;
+        while ((j < levels.size()) && (fabs(levels[j] - b.freq) > LEVEL_TOLERANCE))
+            j++;
+        if (j == levels.size())
+        {
+            levels.push_back(b.freq);
+            lo.push_back(b.freq);
+            hi.push_back(b.freq);
+        }
+        lo[j] = std::min(lo[j], b.freq);
+        hi[j] = std::max(hi[j], b.freq);
+    }
+    std::vector<size_t> order(levels.size());
+    for (size_t j = 0; j < order.size(); j++)
+        order[j] = j;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return levels[a] < levels[b]; });
+
+    printf("Register writes          : %zu\n", trace.size());
+    printf("Symbol changes (bursts)  : %zu\n", bursts.size());
+    printf("Mode                     : %s, CLK%d\n", mode->name, clkOutput);
+    printf("Symbols                  : %d (expected %d)\n", symbols, mode->symbols);
+    printf("Frame length             : %.3f s (expected %.3f s)\n",
+           ((frameEnd ? frameEnd : bursts.back().t + period) - bursts.front().t) / 1.0e6, mode->symbols * period / 1.0e6);
+    printf("Symbol period error      : mean %.1f us, rms %.1f us, max %.1f us\n",
+           gaps ? errSum / gaps : 0.0, gaps ? sqrt(errSq / gaps) : 0.0, errMax);
+
+    printf("Tone levels              : %zu\n", levels.size());
+    for (size_t j = 0; j < order.size(); j++)
+    {
+        size_t k = order[j];
+        printf("  tone %zu                 : %.4f Hz, drift %.1f mHz", j, levels[k], (hi[k] - lo[k]) * 1000.0);
+        if (j)
+            printf(", spacing %.4f Hz (expected %.4f)", levels[k] - levels[order[j - 1]], mode->spacing);
+        printf("\n");
+    }
+
+    printf("PLL resets               : %d (%d after frame start)\n", pllResets, lateResets);
+    printf("Transient frequencies    : %d\n", transients);
+    printf("I2C bytes                : %lu, %.1f per symbol\n", bytes, (double) bytes / symbols);
+    printf("Phase continuity         : %s (%d PLL resets, %d CLK control writes after frame start)\n",
+           (lateResets || lateCtrl) ? "FAILED" : "OK", lateResets, lateCtrl);
+    return !lateResets && !lateCtrl;
+}
+
+int main(int argc, char *argv[])
+{
+    double fref = 27000000.0, jitter = 0.0, freq2 = 0.0, offset = 0.0;
+    const char *output = NULL;
+    bool simulate = false, timeline = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:M:d:a:c:k:j:o:st")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': fref = strtod(optarg, NULL); break;
+            case 'M':
+                if (!(mode = ModeGet(atoi(optarg))))
+                {
+                    fprintf(stderr, "unknown mode %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'd': freq2 = strtod(optarg, NULL); break;
+            case 'a': offset = strtod(optarg, NULL); break;
+            case 'c': clkOutput = atoi(optarg) ? 1 : 0; break;
+            case 'k': i2cClock = strtod(optarg, NULL); break;
+            case 'j': jitter = strtod(optarg, NULL); break;
+            case 'o': output = optarg; break;
+            case 's': simulate = true; break;
+            case 't': timeline = true; break;
+            default: return 1;
+        }
+    }
+
+    if (simulate && (argc - optind == 4))
+    {
+        if (!Simulate(argv[optind], argv[optind + 1], atoi(argv[optind + 2]), strtod(argv[optind + 3], NULL), freq2, fref, jitter, offset))
+            return 1;
+        if (output)
+            WriteTrace(output);
+    }
+    else if (!simulate && (argc - optind == 1))
+    {
+        if (!ReadTrace(argv[optind]))
+            return 1;
+    }
+    else
+    {
+        fprintf(stderr, "usage: si5351trace [-r FREF] [-M MODE] [-d FREQ2] [-a OFFSET] [-c OUTPUT] [-k HZ] [-j US] [-o FILE] [-t] -s CALL LOCATOR POWER FREQUENCY\n"
+                        "       si5351trace [-r FREF] [-M MODE] [-c OUTPUT] [-t] TRACE.txt\n");
+        return 1;
+    }
+
+    return Analyze(fref, timeline) ? 0 : 2;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
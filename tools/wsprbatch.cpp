@@ -0,0 +1,359 @@
+/*
+    wsprbatch
+
+    Host batch encoder for beacon provisioning. Reads a CSV of
+        call,locator,power,frequency[,reference frequency[,setting,...]]
+    and writes one fixed size record per row with the WSPR symbols, the Si5351 tone
+    register images and an EEPROM configuration image, using the sketch's own
+    settings.cpp, wspr.cpp, mode.cpp and tones.cpp. Rows are encoded in parallel on
+    all cores straight into a memory mapped output file, see batchfile.h for the layout.
+
+    The image is the "wr defaults" one with the row applied as wr bcn, loc, pwr, freq
+    and frst, then the settings in order. A setting is any sketch "wr" command that
+    only writes the EEPROM, without the "wr", e.g. "hop 2" or "telem 123". The sketch's
+    settings.cpp parses it, so the arguments and limits are the sketch's. The record
+    is encoded from the finished image, as LoadConfiguration() would.
+
+    Usage
+        wsprbatch [-j THREADS] INPUT.csv OUTPUT.bin
+        wsprbatch -d OUTPUT.bin           dump a batch file as CSV
+
+    Lines that are empty or start with # are skipped, as is a first line starting with "call".
+    A missing reference frequency defaults to 27 MHz, an empty field is skipped. Quote
+    nothing, a setting never holds a comma.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "batchfile.h"
+#include "config.h"
+#include "mode.h"
+#include "settings.h"
+#include "tones.h"
+#include "wspr.h"
+
+#define CHUNK_LINES 1024                  // Lines handed to a worker at a time
+#define FIELDS_MAX  32                    // CSV fields per line, 5 plus the settings
+
+struct Line
+{
+    const char *start;
+    size_t length;
+    uint32_t number;
+};
+
+// Split a CSV line into at most max trimmed fields, returns the number of fields
+static int SplitFields(const char *start, size_t length, std::string *fields, int max)
+{
+    int n = 0;
+    size_t i = 0;
+
+    while ((i <= length) && (n < max))
+    {
+        size_t j = i;
+        while ((j < length) && (start[j] != ','))
+            j++;
+
+        size_t a = i, b = j;
+        while ((a < b) && isspace((unsigned char) start[a]))
+            a++;
+        while ((b > a) && isspace((unsigned char) start[b - 1]))
+            b--;
+        fields[n++].assign(start + a, b - a);
+        i = j + 1;
+    }
+    return n;
+}
+
+// The image a worker thread builds, reached by the settings through ImageRead() and ImageWrite()
+static thread_local uint8_t *image;
+
+static uint8_t ImageRead(const uint16_t address)
+{
+    return image[address - BATCH_EEPROM_BASE];
+}
+
+static void ImageWrite(const uint16_t address, const uint8_t value)
+{
+    image[address - BATCH_EEPROM_BASE] = value;
+}
+
+// Apply a setting to the image, printf style
+static int Apply(const char *format, ...)
+{
+    char setting[64];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(setting, sizeof(setting), format, args);
+    va_end(args);
+    return SettingApply(setting, ImageRead, ImageWrite);
+}
+
+static void EncodeLine(const Line &line, BatchRecord *rec)
+{
+    std::string f[FIELDS_MAX];
+    uint8_t rotation[WSPR_ROTATION_MAX][WSPR_SYMBOL_COUNT], types[WSPR_ROTATION_MAX];
+    ToneTable table;
+
+    memset(rec, 0, sizeof(BatchRecord));
+    rec->line = line.number;
+
+    int n = SplitFields(line.start, line.length, f, FIELDS_MAX);
+    if ((n < 4) || f[0].empty() || f[1].empty())
+    {
+        rec->status = BATCH_BAD_LINE;
+        return;
+    }
+
+    // The "wr defaults" image with the row applied as the commands an operator would type
+    image = rec->eeprom;
+    memset(image, 0xFF, BATCH_EEPROM_SIZE);
+    Apply("defaults");
+    if (((n > 4) && !f[4].empty() && (SETTING_OK != Apply("frst %s", f[4].c_str()))) || (SETTING_OK != Apply("freq %s", f[3].c_str())))
+    {
+        rec->status = BATCH_BAD_FREQUENCY;
+        return;
+    }
+    if ((SETTING_OK != Apply("bcn %s", f[0].c_str())) || (SETTING_OK != Apply("loc %s", f[1].c_str())) || (SETTING_OK != Apply("pwr %s", f[2].c_str())))
+    {
+        rec->status = BATCH_BAD_MESSAGE;
+        return;
+    }
+    for (int i = 5; i < n; i++)
+    {
+        if (!f[i].empty() && (SETTING_OK != Apply("%s", f[i].c_str())))
+        {
+            rec->status = BATCH_BAD_SETTING;
+            return;
+        }
+    }
+
+    // The record is what LoadConfiguration() makes of the image
+    char call[16], locator[9];
+    int32_t fref;
+    memcpy(call, &image[EEPROM_BEACON_Call - BATCH_EEPROM_BASE], sizeof(call));
+    memcpy(locator, &image[EEPROM_COMMON_Locator - BATCH_EEPROM_BASE], sizeof(locator));
+    memcpy(&rec->frequency, &image[EEPROM_BEACON_Frequency - BATCH_EEPROM_BASE], sizeof(rec->frequency));
+    memcpy(&fref, &image[EEPROM_HW_RefStartFreq - BATCH_EEPROM_BASE], sizeof(fref));
+    rec->fref = fref;
+    const ModeDesc *mode = ModeGet(ImageRead(EEPROM_BEACON_Mode));
+
+    rec->frames = mode->encode(call, locator, ImageRead(EEPROM_BEACON_WSPRPower), rotation, types);
+    if (!rec->frames)
+    {
+        rec->status = BATCH_BAD_MESSAGE;
+        return;
+    }
+    WsprPackSymbols(rotation[0], rec->symbols);
+
+    // Same limits as LoadConfiguration() and "wr frst", the tones of the mode
+    if ((rec->frequency < 100000.0) || (rec->frequency > 298765432.0) || (rec->fref < 26990000.0) || (rec->fref > 27010000.0) ||
+        !ToneCalculate(rec->fref, rec->frequency - (mode->tones - 1) * mode->spacing / 2.0, mode->spacing, mode->tones, &table))
+    {
+        rec->status = BATCH_BAD_FREQUENCY;
+        return;
+    }
+    rec->toneReg = table.toneReg;
+    rec->msInt = table.msInt;
+    memcpy(rec->pll, table.pll, sizeof(rec->pll));
+    memcpy(rec->ms, table.ms, sizeof(rec->ms));
+    memcpy(rec->tone, table.tone, sizeof(rec->tone));
+
+    uint16_t signature = SettingSignature(ImageRead);          // So the first warm reset after provisioning can resume
+    ImageWrite(EEPROM_BOOT_Signature, signature & 0xFF);
+    ImageWrite(EEPROM_BOOT_Signature + 1, signature >> 8);
+}
+
+static int Encode(const char *input, const char *output, unsigned threads)
+{
+    int in = open(input, O_RDONLY);
+    struct stat st;
+    if ((in < 0) || fstat(in, &st))
+    {
+        perror(input);
+        return 1;
+    }
+
+    const char *text = NULL;
+    if (st.st_size)
+    {
+        text = (const char *) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, in, 0);
+        if (text == MAP_FAILED)
+        {
+            perror(input);
+            return 1;
+        }
+    }
+
+    // Index the lines, single threaded memchr is far faster than the encoding
+    std::vector<Line> lines;
+    const char *p = text, *end = text + st.st_size;
+    uint32_t number = 0;
+    while (p < end)
+    {
+        const char *nl = (const char *) memchr(p, '\n', end - p);
+        size_t len = (nl ? nl : end) - p;
+        number++;
+        if (len && (p[len - 1] == '\r'))
+            len--;
+
+        const char *q = p;
+        while ((q < p + len) && isspace((unsigned char) *q))
+            q++;
+        bool skip = (q == p + len) || (*q == '#') || ((number == 1) && (0 == strncasecmp(q, "call", 4)));
+        if (!skip)
+            lines.push_back({ p, len, number });
+        p = nl ? nl + 1 : end;
+    }
+
+    // Size and map the output so the workers write their records in place
+    size_t size = sizeof(BatchHeader) + lines.size() * sizeof(BatchRecord);
+    int out = open(output, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ((out < 0) || ftruncate(out, size))
+    {
+        perror(output);
+        return 1;
+    }
+    uint8_t *map = (uint8_t *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+    if (map == MAP_FAILED)
+    {
+        perror(output);
+        return 1;
+    }
+
+    BatchHeader *header = (BatchHeader *) map;
+    BatchRecord *records = (BatchRecord *) (map + sizeof(BatchHeader));
+    memset(header, 0, sizeof(BatchHeader));
+    memcpy(header->magic, BATCH_MAGIC, 4);
+    header->version = BATCH_VERSION;
+    header->recordSize = sizeof(BatchRecord);
+    header->count = lines.size();
+    header->eepromBase = BATCH_EEPROM_BASE;
+    for (int f = 0; f < settingFieldCount; f++)
+        for (int i = 0; i < settingFields[f].size; i++)
+            header->eepromMask[(settingFields[f].address + i) / 8] |= 1 << ((settingFields[f].address + i) % 8);
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        pool.emplace_back([&]()
+        {
+            size_t first;
+            while ((first = next.fetch_add(CHUNK_LINES)) < lines.size())
+            {
+                size_t last = std::min(first + CHUNK_LINES, lines.size());
+                for (size_t i = first; i < last; i++)
+                    EncodeLine(lines[i], &records[i]);
+            }
+        });
+    }
+    for (std::thread &worker : pool)
+        worker.join();
+
+    size_t failed = 0;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        if (records[i].status != BATCH_OK)
+        {
+            fprintf(stderr, "%s:%u: %s\n", input, records[i].line,
+                    records[i].status == BATCH_BAD_LINE ? "cannot parse line" :
+                    records[i].status == BATCH_BAD_MESSAGE ? "message cannot be encoded" :
+                    records[i].status == BATCH_BAD_SETTING ? "setting unknown or out of range" : "frequency out of range");
+            failed++;
+        }
+    }
+    fprintf(stderr, "%zu records, %zu failed, %u threads\n", lines.size(), failed, threads);
+
+    munmap(map, size);
+    close(out);
+    if (text)
+        munmap((void *) text, st.st_size);
+    close(in);
+    return failed ? 2 : 0;
+}
+
+static int Dump(const char *input)
+{
+    FILE *f = fopen(input, "rb");
+    BatchHeader header;
+    BatchRecord rec;
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+
+    if (!f || (1 != fread(&header, sizeof(header), 1, f)) || memcmp(header.magic, BATCH_MAGIC, 4) ||
+        (header.version != BATCH_VERSION) || (header.recordSize != sizeof(BatchRecord)))
+    {
+        fprintf(stderr, "%s: not a version %d batch file\n", input, BATCH_VERSION);
+        return 1;
+    }
+
+    printf("line,status,call,locator,power,frequency,fref,frames,symbols,tonereg,tones\n");
+    for (uint32_t n = 0; n < header.count; n++)
+    {
+        if (1 != fread(&rec, sizeof(rec), 1, f))
+            return 1;
+
+        const char *call = (const char *) &rec.eeprom[EEPROM_BEACON_Call - BATCH_EEPROM_BASE];
+        const char *locator = (const char *) &rec.eeprom[EEPROM_COMMON_Locator - BATCH_EEPROM_BASE];
+        int power = rec.eeprom[EEPROM_BEACON_WSPRPower - BATCH_EEPROM_BASE];
+
+        printf("%u,%u,%.15s,%.8s,%d,%.0f,%.0f,%u,", rec.line, rec.status, rec.status ? "" : call, rec.status ? "" : locator,
+               rec.status ? 0 : power, rec.frequency, rec.fref, rec.frames);
+        WsprUnpackSymbols(rec.symbols, symbols);
+        for (int i = 0; i < WSPR_SYMBOL_COUNT; i++)
+            putchar('0' + symbols[i]);
+        printf(",%u,", rec.toneReg);
+        for (int t = 0; t < WSPR_TONE_COUNT; t++)
+            for (int i = 0; i < 8; i++)
+                printf("%02X", rec.tone[t][i]);
+        putchar('\n');
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    int opt;
+    bool dump = false;
+
+    while ((opt = getopt(argc, argv, "j:d")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j': threads = atoi(optarg); break;
+            case 'd': dump = true; break;
+            default: argc = 0; break;
+        }
+    }
+    if (threads < 1)
+        threads = 1;
+
+    if (dump && (argc - optind == 1))
+        return Dump(argv[optind]);
+    if (!dump && (argc - optind == 2))
+        return Encode(argv[optind], argv[optind + 1], threads);
+
+    fprintf(stderr, "usage: wsprbatch [-j THREADS] INPUT.csv OUTPUT.bin\n"
+                    "       wsprbatch -d OUTPUT.bin\n");
+    return 1;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
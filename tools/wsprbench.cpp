@@ -0,0 +1,482 @@
+/*
+    wsprbench
+
+    Microbenchmarks of the sketch's hardware independent hot paths, built from the same
+    sources as the firmware: WSPR encoding of each message type and the call hash, the
+    Si5351 tone register calculation below and above 100 MHz and the per slot shift, the
+    TX register sequence of a whole frame, the rotary encoder state tables and the display
+    formatting next to the sprintf() calls it replaced.
+
+    Usage
+        wsprbench [options] [FILTER]                  run the benchmarks whose name contains FILTER
+
+    Options
+        -m MS       minimum time per repetition, default 200
+        -r N        repetitions, the median is reported, default 5
+        -o FILE     also write the results to FILE
+        -c FILE     compare with a baseline written by -o
+        -t PCT      regression threshold for -c, default 10
+        -l          list the benchmarks
+
+    Results file: a "# wsprbench 1" line, then a "NAME ITERATIONS NS_PER_OP" line per
+    benchmark. With -c, a benchmark slower than the baseline by more than PCT percent is
+    a regression and the exit status is 2. Host times only rank the kernels against each
+    other, the cycles on the SAMD21 come from rd bench and rd prof on the RFzero.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "encoder.h"
+#include "fmt.h"
+#include "tones.h"
+#include "txframe.h"
+#include "wspr.h"
+
+#define RESULTS_VERSION  1
+#define REF_FREQUENCY    27000000.0
+
+typedef void (*BenchFunc)(uint64_t iterations);
+
+struct Bench
+{
+    const char *name;
+    BenchFunc fn;
+};
+
+struct Result
+{
+    std::string name;
+    uint64_t iterations;
+    double ns;
+};
+
+// fmt.cpp prints through SerialUSB, only from FmtBench() which is not run here
+class StdoutPrint : public Print
+{
+public:
+    size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+static StdoutPrint stdoutPrint;
+Print &SerialUSB = stdoutPrint;
+
+// Keeps a result alive so the compiler cannot drop the work, as benchmark::DoNotOptimize
+template <class T> static inline void Keep(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static inline void Clobber()
+{
+    asm volatile("" : : : "memory");
+}
+
+// Inputs behind volatile so they are not constant folded
+static const char *volatile benchCall = "K1ABC";
+static const char *volatile benchCompound = "PJ4/K1ABC";
+static const char *volatile benchLocator = "FN42";
+static const char *volatile benchLocator6 = "FN42AX";
+static volatile int benchPower = 37;
+static volatile double benchCarrier = 14097100.0;
+static volatile double benchCarrierVhf = 144489000.0;
+static volatile int benchHours = 12, benchMinutes = 34, benchSeconds = 56, benchSats = 9, benchSeq = 42;
+
+// WSPR ------------------------------------------------------------------------------------
+
+static void BenchEncodeType1(uint64_t n)
+{
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+
+    while (n--)
+    {
+        Keep(WsprEncodeType1(benchCall, benchLocator, benchPower, symbols));
+        Clobber();
+    }
+}
+
+static void BenchEncodeType2(uint64_t n)
+{
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+
+    while (n--)
+    {
+        Keep(WsprEncodeType2(benchCompound, benchPower, symbols));
+        Clobber();
+    }
+}
+
+static void BenchEncodeType3(uint64_t n)
+{
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+
+    while (n--)
+    {
+        Keep(WsprEncodeType3(benchCall, benchLocator6, benchPower, symbols));
+        Clobber();
+    }
+}
+
+static void BenchEncodeRotation(uint64_t n)
+{
+    uint8_t symbols[WSPR_ROTATION_MAX][WSPR_SYMBOL_COUNT], types[WSPR_ROTATION_MAX];
+
+    while (n--)
+    {
+        Keep(WsprEncodeRotation(benchCompound, benchLocator6, benchPower, symbols, types));
+        Clobber();
+    }
+}
+
+static void BenchCallHash(uint64_t n)
+{
+    while (n--)
+        Keep(WsprCallHash(benchCompound));
+}
+
+static void BenchPackSymbols(uint64_t n)
+{
+    uint8_t symbols[WSPR_SYMBOL_COUNT], packed[(WSPR_SYMBOL_COUNT + 3) / 4];
+
+    WsprEncodeType1("K1ABC", "FN42", 37, symbols);
+    while (n--)
+    {
+        WsprPackSymbols(symbols, packed);
+        Clobber();
+    }
+}
+
+// Si5351 tones ----------------------------------------------------------------------------
+
+static void BenchToneCalculate(uint64_t n)
+{
+    ToneTable table;
+
+    while (n--)
+    {
+        Keep(ToneCalculate(REF_FREQUENCY, benchCarrier, WSPR_TONE_SPACING, WSPR_TONE_COUNT, &table));
+        Clobber();
+    }
+}
+
+static void BenchToneCalculateVhf(uint64_t n)
+{
+    ToneTable table;
+
+    while (n--)
+    {
+        Keep(ToneCalculate(REF_FREQUENCY, benchCarrierVhf, WSPR_TONE_SPACING, WSPR_TONE_COUNT, &table));
+        Clobber();
+    }
+}
+
+static void BenchToneShift(uint64_t n)
+{
+    ToneTable base, moved;
+
+    ToneCalculate(REF_FREQUENCY, 14097100.0, WSPR_TONE_SPACING, WSPR_TONE_COUNT, &base);
+    while (n--)
+    {
+        Keep(ToneShift(REF_FREQUENCY, &base, 37.0, &moved));
+        Clobber();
+    }
+}
+
+// Register writes of a whole frame, counted instead of sent
+static uint32_t registerBytes = 0;
+
+static void CountWrite(const uint8_t reg, const uint8_t *data, const uint8_t len)
+{
+    registerBytes += len;
+    Keep(reg);
+    Keep(data);
+}
+
+static void BenchFrameSteps(uint64_t n)
+{
+    ToneTable table;
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+
+    ToneCalculate(REF_FREQUENCY, 14097100.0, WSPR_TONE_SPACING, WSPR_TONE_COUNT, &table);
+    WsprEncodeType1("K1ABC", "FN42", 37, symbols);
+    while (n--)
+    {
+        TxFrameStart(&table, CountWrite);
+        for (int k = 0; k < WSPR_SYMBOL_COUNT; k++)
+            TxFrameStep(&table, k ? symbols[k - 1] : 0, symbols[k], CountWrite);
+        Clobber();
+    }
+    Keep(registerBytes);
+}
+
+// Rotary encoder, one operation is a full detent of 4 transitions ---------------------------
+
+static const uint8_t encSequence[8] = { 1, 3, 2, 0, 2, 3, 1, 0 };     // (B << 1) | A, right then left
+
+static void BenchEncoderFullStep(uint64_t n)
+{
+    uint8_t state = 0;
+    uint32_t steps = 0;
+
+    while (n--)
+        for (int i = 0; i < 4; i++)
+        {
+            state = encTableFullStep[state & 0x0F][encSequence[(n & 1) * 4 + i]];
+            steps += (state & ENC_DIRECTION) != 0;
+        }
+    Keep(steps);
+}
+
+static void BenchEncoderHalfStep(uint64_t n)
+{
+    uint8_t state = 0;
+    uint32_t steps = 0;
+
+    while (n--)
+        for (int i = 0; i < 4; i++)
+        {
+            state = encTableHalfStep[state & 0x0F][encSequence[(n & 1) * 4 + i]];
+            steps += (state & ENC_DIRECTION) != 0;
+        }
+    Keep(steps);
+}
+
+// Display formatting, the formatter next to the sprintf() calls it replaced ------------------
+
+static void BenchSprintfTime(uint64_t n)
+{
+    char out[32];
+
+    while (n--)
+    {
+        sprintf(out, "%02d:%02d:%02d", benchHours, benchMinutes, benchSeconds);
+        Clobber();
+    }
+}
+
+static void BenchFmtTime(uint64_t n)
+{
+    char out[32];
+
+    while (n--)
+    {
+        FmtTime(out, benchHours, benchMinutes, benchSeconds);
+        Clobber();
+    }
+}
+
+static void BenchSprintfKhz(uint64_t n)
+{
+    char out[32];
+
+    while (n--)
+    {
+        sprintf(out, "%.2f kHz", benchCarrier / 1000.0);
+        Clobber();
+    }
+}
+
+static void BenchFmtKhz(uint64_t n)
+{
+    char out[32];
+
+    while (n--)
+    {
+        FmtStr(FmtKhz(out, (uint32_t) benchCarrier, 2), " kHz");
+        Clobber();
+    }
+}
+
+static void BenchSprintfGps(uint64_t n)
+{
+    char out[32];
+
+    while (n--)
+    {
+        sprintf(out, "GPS:OK,SAT:%02d,SEQ:%02d", benchSats, benchSeq);
+        Clobber();
+    }
+}
+
+static void BenchFmtGps(uint64_t n)
+{
+    char out[32];
+
+    while (n--)
+    {
+        char *p = FmtUint(FmtStr(out, "GPS:OK,SAT:"), benchSats, 2, '0');
+        FmtUint(FmtStr(p, ",SEQ:"), benchSeq, 2, '0');
+        Clobber();
+    }
+}
+
+static const Bench benchTable[] =
+{
+    { "wspr/encode_type1",       BenchEncodeType1 },
+    { "wspr/encode_type2",       BenchEncodeType2 },
+    { "wspr/encode_type3",       BenchEncodeType3 },
+    { "wspr/encode_rotation",    BenchEncodeRotation },
+    { "wspr/call_hash",          BenchCallHash },
+    { "wspr/pack_symbols",       BenchPackSymbols },
+    { "tones/calculate_hf",      BenchToneCalculate },
+    { "tones/calculate_vhf",     BenchToneCalculateVhf },
+    { "tones/shift",             BenchToneShift },
+    { "txframe/wspr_frame",      BenchFrameSteps },
+    { "encoder/full_step",       BenchEncoderFullStep },
+    { "encoder/half_step",       BenchEncoderHalfStep },
+    { "display/sprintf_time",    BenchSprintfTime },
+    { "display/fmt_time",        BenchFmtTime },
+    { "display/sprintf_khz",     BenchSprintfKhz },
+    { "display/fmt_khz",         BenchFmtKhz },
+    { "display/sprintf_gps",     BenchSprintfGps },
+    { "display/fmt_gps",         BenchFmtGps },
+};
+
+static double Seconds(BenchFunc fn, const uint64_t iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn(iterations);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Scale the iterations up until a run takes the minimum time, then report the median of
+// the repetitions
+static Result Run(const Bench &bench, const double minSeconds, const int reps)
+{
+    uint64_t iterations = 1;
+    double t;
+
+    while ((t = Seconds(bench.fn, iterations)) < minSeconds)
+    {
+        double scale = (t > 0.0) ? 1.4 * minSeconds / t : 10.0;
+        iterations = std::max(iterations + 1, (uint64_t) (iterations * std::min(scale, 10.0)));
+    }
+
+    std::vector<double> ns;
+    for (int r = 0; r < reps; r++)
+        ns.push_back(1e9 * Seconds(bench.fn, iterations) / iterations);
+    std::sort(ns.begin(), ns.end());
+
+    Result result = { bench.name, iterations, ns[ns.size() / 2] };
+    return result;
+}
+
+static bool ReadResults(const char *path, std::map<std::string, double> &results)
+{
+    FILE *f = fopen(path, "r");
+    char line[256], name[128];
+    unsigned long long iterations;
+    double ns;
+    int version = 0;
+
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "# wsprbench %d", &version) == 1)
+            continue;
+        if (sscanf(line, "%127s %llu %lf", name, &iterations, &ns) == 3)
+            results[name] = ns;
+    }
+    fclose(f);
+    if (version != RESULTS_VERSION)
+    {
+        fprintf(stderr, "%s: not a wsprbench %d results file\n", path, RESULTS_VERSION);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *outFile = NULL, *baseFile = NULL, *filter = NULL;
+    double minSeconds = 0.2, threshold = 10.0;
+    int reps = 5, opt;
+    std::map<std::string, double> baseline;
+
+    while ((opt = getopt(argc, argv, "m:r:o:c:t:l")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm': minSeconds = std::max(1.0, strtod(optarg, NULL)) / 1000.0; break;
+            case 'r': reps = std::max(1, atoi(optarg)); break;
+            case 'o': outFile = optarg; break;
+            case 'c': baseFile = optarg; break;
+            case 't': threshold = strtod(optarg, NULL); break;
+            case 'l':
+                for (const Bench &bench : benchTable)
+                    printf("%s\n", bench.name);
+                return 0;
+            default: return 1;
+        }
+    }
+    if (argc - optind > 1)
+    {
+        fprintf(stderr, "usage: wsprbench [-m MS] [-r N] [-o FILE] [-c FILE] [-t PCT] [-l] [FILTER]\n");
+        return 1;
+    }
+    if (argc > optind)
+        filter = argv[optind];
+    if (baseFile && !ReadResults(baseFile, baseline))
+        return 1;
+
+    FILE *out = NULL;
+    if (outFile && !(out = fopen(outFile, "w")))
+    {
+        perror(outFile);
+        return 1;
+    }
+    if (out)
+        fprintf(out, "# wsprbench %d\n", RESULTS_VERSION);
+
+    int regressions = 0;
+    printf("%-24s  %12s  %10s", "Benchmark", "Iterations", "ns/op");
+    if (baseFile)
+        printf("  %10s  %8s", "Baseline", "Change");
+    printf("\n");
+
+    for (const Bench &bench : benchTable)
+    {
+        if (filter && !strstr(bench.name, filter))
+            continue;
+
+        Result r = Run(bench, minSeconds, reps);
+        printf("%-24s  %12llu  %10.1f", r.name.c_str(), (unsigned long long) r.iterations, r.ns);
+        if (out)
+            fprintf(out, "%s %llu %.3f\n", r.name.c_str(), (unsigned long long) r.iterations, r.ns);
+
+        auto base = baseline.find(r.name);
+        if (base != baseline.end())
+        {
+            double change = 100.0 * (r.ns - base->second) / base->second;
+            bool regressed = change > threshold;
+            printf("  %10.1f  %+7.1f%%%s", base->second, change, regressed ? "  REGRESSION" : "");
+            regressions += regressed;
+        }
+        else if (baseFile)
+            printf("  %10s", "new");
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if (out)
+        fclose(out);
+    if (regressions)
+    {
+        fprintf(stderr, "%d benchmark%s more than %.1f%% slower than %s\n", regressions, (regressions == 1) ? "" : "s", threshold, baseFile);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+    wsprcheck
+
+    Host run of the sketch's self test, the same golden vectors and tone sets as rd selftest
+    on the RFzero, followed by a bulk corpus of vectors from an independent encoder, see
+    wsprvectors.py. Built from the same sources as the firmware, so "make check" catches an
+    encoder or tone calculation change before it reaches a board.
+
+    Usage
+        wsprcheck [VECTORS]
+
+    Vector file: one "TYPE CALL LOCATOR POWER SYMBOLS" line per message, the locator "-"
+    for type 2 and the 162 channel symbols as digits. Lines starting with # are skipped.
+    Prints every mismatch and a summary, the exit status is 1 if anything failed.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "selftest.h"
+#include "wspr.h"
+
+// selftest.cpp reports through SerialUSB
+class StdoutPrint : public Print
+{
+public:
+    size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+static StdoutPrint stdoutPrint;
+Print &SerialUSB = stdoutPrint;
+
+// Check every vector of the file, returns the number of failures or -1 if it cannot be read
+static int CheckCorpus(const char *name)
+{
+    FILE *f = fopen(name, "r");
+    char line[512], call[32], locator[16], digits[256];
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+    int type, power, count = 0, failed = 0, number = 0;
+
+    if (!f)
+    {
+        perror(name);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        number++;
+        if ((line[0] == '#') || (line[0] == '\n'))
+            continue;
+
+        bool ok = (5 == sscanf(line, "%d %31s %15s %d %255s", &type, call, locator, &power, digits)) &&
+                  (strlen(digits) == WSPR_SYMBOL_COUNT);
+        if (ok && (type == WSPR_TYPE1))
+            ok = WsprEncodeType1(call, locator, power, symbols);
+        else if (ok && (type == WSPR_TYPE2))
+            ok = WsprEncodeType2(call, power, symbols);
+        else if (ok && (type == WSPR_TYPE3))
+            ok = WsprEncodeType3(call, locator, power, symbols);
+        else
+            ok = false;
+
+        for (int i = 0; ok && (i < WSPR_SYMBOL_COUNT); i++)
+            ok = (symbols[i] == digits[i] - '0');
+        if (!ok)
+        {
+            printf("FAIL  %s:%d: type %d %s %s %d\n", name, number, type, call, locator, power);
+            failed++;
+        }
+        count++;
+    }
+    fclose(f);
+
+    printf("%d corpus vectors: %s\n", count, failed ? "FAILED" : "PASSED");
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2)
+    {
+        fprintf(stderr, "usage: wsprcheck [VECTORS]\n");
+        return 1;
+    }
+
+    int failed = SelfTest(0.0);
+    if (argc > 1)
+    {
+        int corpus = CheckCorpus(argv[1]);
+        failed += (corpus < 0) ? 1 : corpus;
+    }
+    return failed ? 1 : 0;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
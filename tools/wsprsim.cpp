@@ -0,0 +1,935 @@
+/*
+    wsprsim
+
+    Loopback check of the WSPR TX path. Synthesizes the symbol stream from the sketch's
+    own encoder as 12 kHz audio or IQ with a given SNR, frequency offset, drift and symbol
+    timing error, then demodulates and Fano decodes it and checks the message comes back.
+
+    Usage
+        wsprsim [options] CALL LOCATOR POWER          synthesize, optionally save, decode
+        wsprsim -S FROM:TO:STEP [options] CALL LOCATOR POWER
+                                                      decode rate versus SNR (and drift)
+        wsprsim -D FILE.wav                           decode a 12 kHz mono 16 bit WAV
+
+    Options
+        -s DB       SNR in 2500 Hz, default -20
+        -f HZ       offset from 1500 Hz, default 0
+        -d HZ       linear drift over the frame, default 0
+        -e PPM      symbol clock error, default 0
+        -j US       symbol edge jitter, uniform +/- US microseconds, default 0
+        -t S        frame start in the 2 min period, default 1.0
+        -m N        frame of the type 1/2/3 rotation to send, default 0
+        -w FILE     write 12 kHz 16 bit mono WAV
+        -q FILE     write 12 kHz complex float32 IQ, signal at 1500 Hz + offset, the analytic
+                    signal of the same noisy audio as the WAV and the decoder
+        -S F:T:S    sweep SNR in dB
+        -R F:T:S    also sweep drift in Hz
+        -n N        trials per sweep point, default 20
+        -x SEED     random seed, default 1
+
+    SNR follows the WSJT convention: signal power over noise power in 2500 Hz of the real
+    audio channel. Sweeps synthesize straight at the 375 Hz decoder rate with the equivalent
+    noise density and run on all cores.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wspr.h"
+
+typedef std::complex<float> cfloat;
+
+#define AUDIO_RATE       12000.0
+#define BASE_RATE        375.0                    // 12000 / 32, one tone spacing = one bin of 256
+#define DECIMATION       32
+#define SYMBOL_SAMPLES   256                      // At BASE_RATE
+#define CENTER_FREQ      1500.0
+#define PERIOD_S         114.0                    // Samples kept per 2 min period, as wsprd
+
+#define FANO_DELTA       60
+#define FANO_MAX_CYCLES  10000
+#define FANO_BIAS        0.45
+
+#define POLY1 0xF2D05351UL
+#define POLY2 0xE4613C47UL
+
+struct SimParams
+{
+    double snr = -20.0;
+    double offset = 0.0;
+    double drift = 0.0;
+    double clockPpm = 0.0;
+    double jitterUs = 0.0;
+    double start = 1.0;
+};
+
+struct DecodeResult
+{
+    bool ok;
+    char call[20];                                // Room for a bracketed type 3 call
+    char locator[8];
+    int power;
+    double freq;                                  // Offset from 1500 Hz
+    double start;                                 // Seconds
+    unsigned cycles;                              // Fano cycles per bit
+};
+
+// xorshift128+ and Box-Muller, one generator per thread
+struct Random
+{
+    uint64_t s[2];
+
+    Random(uint64_t seed) { s[0] = seed * 0x9E3779B97F4A7C15ULL + 1; s[1] = seed ^ 0xD1B54A32D192ED03ULL; for (int i = 0; i < 8; i++) Next(); }
+
+    uint64_t Next()
+    {
+        uint64_t x = s[0], y = s[1];
+        s[0] = y;
+        x ^= x << 23;
+        s[1] = x ^ y ^ (x >> 17) ^ (y >> 26);
+        return s[1] + y;
+    }
+
+    double Uniform() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // Fill with complex Gaussian noise of total variance sigma2
+    void Gaussian(cfloat *out, size_t n, double sigma2)
+    {
+        const float scale = sqrt(sigma2 / 2.0);
+        for (size_t i = 0; i < n; i++)
+        {
+            float r = sqrtf(-2.0f * logf((float) (1.0 - Uniform())));
+            float phi = 2.0f * (float) M_PI * (float) Uniform();
+            out[i] = cfloat(scale * r * cosf(phi), scale * r * sinf(phi));
+        }
+    }
+};
+
+static uint8_t Parity(uint32_t v)
+{
+    v ^= v >> 16;
+    v ^= v >> 8;
+    v ^= v >> 4;
+    return (0x6996 >> (v & 0xF)) & 1;
+}
+
+static uint8_t BitReverse8(uint8_t v)
+{
+    v = (v & 0xF0) >> 4 | (v & 0x0F) << 4;
+    v = (v & 0xCC) >> 2 | (v & 0x33) << 2;
+    v = (v & 0xAA) >> 1 | (v & 0x55) << 1;
+    return v;
+}
+
+// ---- Synthesis --------------------------------------------------------------------------
+
+// Unit amplitude 4-FSK at rate, tone 0 at freq Hz. Each symbol is phase * rot[n], where
+// rot[] is the per sample rotation table, so the inner loop has no carried dependency and
+// vectorizes. Phase is continuous across symbol edges
+static void Synthesize(const uint8_t *symbols, const SimParams &p, const double rate, const double freq, Random &rng, std::vector<cfloat> &out)
+{
+    const double period = 8192.0 / 12000.0 * (1.0 + p.clockPpm * 1.0e-6);
+    std::vector<cfloat> rot;
+    double phase = 0.0;
+
+    for (int k = 0; k < WSPR_SYMBOL_COUNT; k++)
+    {
+        double t0 = p.start + k * period, t1 = p.start + (k + 1) * period;
+        if (p.jitterUs > 0.0)
+        {
+            if (k)
+                t0 += (2.0 * rng.Uniform() - 1.0) * p.jitterUs * 1.0e-6;
+            t1 += (2.0 * rng.Uniform() - 1.0) * p.jitterUs * 1.0e-6;
+        }
+        size_t n0 = std::max(0L, lround(t0 * rate)), n1 = std::min((long) out.size(), lround(t1 * rate));
+        if (n1 <= n0)
+            continue;
+
+        double f = freq + symbols[k] * WSPR_TONE_SPACING + p.drift * ((k + 0.5) / WSPR_SYMBOL_COUNT - 0.5);
+        double w = 2.0 * M_PI * f / rate;
+        size_t len = n1 - n0;
+
+        rot.resize(len);
+        for (size_t n = 0; n < len; n++)
+            rot[n] = cfloat(cos(w * n), sin(w * n));
+
+        cfloat z((float) cos(phase), (float) sin(phase));
+        cfloat *o = &out[n0];
+        for (size_t n = 0; n < len; n++)
+            o[n] += z * rot[n];
+
+        phase = fmod(phase + w * len, 2.0 * M_PI);
+    }
+}
+
+// Complex signal plus noise. realChannel selects the noise for a real audio channel at the
+// given SNR, else for a complex (IQ) channel
+static void Channel(const uint8_t *symbols, const SimParams &p, const double rate, const double freq, const bool realChannel, Random &rng,
+                    std::vector<cfloat> &out)
+{
+    double snr = pow(10.0, p.snr / 10.0);
+    double sigma2 = rate / (2500.0 * snr) / (realChannel ? 2.0 : 1.0);
+
+    out.assign((size_t) (PERIOD_S * rate), cfloat(0.0f, 0.0f));
+    rng.Gaussian(out.data(), out.size(), sigma2);
+    Synthesize(symbols, p, rate, freq, rng, out);
+}
+
+static bool WriteWav(const char *name, const std::vector<cfloat> &x)
+{
+    FILE *f = fopen(name, "wb");
+    if (!f)
+    {
+        perror(name);
+        return false;
+    }
+
+    double sum = 0.0;
+    for (const cfloat &v : x)
+        sum += v.real() * v.real();
+    const float scale = 3000.0 / sqrt(sum / x.size());     // RMS at about -21 dBFS
+
+    uint32_t dataSize = x.size() * 2, riffSize = 36 + dataSize, fmtSize = 16, rate = AUDIO_RATE, byteRate = AUDIO_RATE * 2;
+    uint16_t format = 1, channels = 1, align = 2, bits = 16;
+    fwrite("RIFF", 1, 4, f); fwrite(&riffSize, 4, 1, f); fwrite("WAVEfmt ", 1, 8, f);
+    fwrite(&fmtSize, 4, 1, f); fwrite(&format, 2, 1, f); fwrite(&channels, 2, 1, f);
+    fwrite(&rate, 4, 1, f); fwrite(&byteRate, 4, 1, f); fwrite(&align, 2, 1, f); fwrite(&bits, 2, 1, f);
+    fwrite("data", 1, 4, f); fwrite(&dataSize, 4, 1, f);
+    for (const cfloat &v : x)
+    {
+        int16_t s = (int16_t) std::max(-32767.0f, std::min(32767.0f, v.real() * scale));
+        fwrite(&s, 2, 1, f);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool ReadWav(const char *name, std::vector<float> &x)
+{
+    FILE *f = fopen(name, "rb");
+    char id[4];
+    uint32_t size, rate = 0;
+    uint16_t format = 0, channels = 0, bits = 0;
+
+    if (!f || (fread(id, 1, 4, f) != 4) || memcmp(id, "RIFF", 4) || (fread(&size, 4, 1, f) != 1) || (fread(id, 1, 4, f) != 4) || memcmp(id, "WAVE", 4))
+    {
+        fprintf(stderr, "%s: not a WAV file\n", name);
+        return false;
+    }
+    while ((fread(id, 1, 4, f) == 4) && (fread(&size, 4, 1, f) == 1))
+    {
+        if (!memcmp(id, "fmt ", 4))
+        {
+            uint8_t fmt[40];
+            if ((size > sizeof(fmt)) || (fread(fmt, 1, size, f) != size))
+                break;
+            memcpy(&format, fmt, 2); memcpy(&channels, fmt + 2, 2); memcpy(&rate, fmt + 4, 4); memcpy(&bits, fmt + 14, 2);
+        }
+        else if (!memcmp(id, "data", 4))
+        {
+            if ((format != 1) || (channels != 1) || (bits != 16) || (rate != AUDIO_RATE))
+                break;
+            std::vector<int16_t> s(size / 2);
+            size_t n = fread(s.data(), 2, s.size(), f);
+            x.assign(s.begin(), s.begin() + n);
+            fclose(f);
+            return true;
+        }
+        else
+            fseek(f, size + (size & 1), SEEK_CUR);
+    }
+    fprintf(stderr, "%s: need 12 kHz mono 16 bit PCM\n", name);
+    fclose(f);
+    return false;
+}
+
+// 12 kHz real audio to 375 Hz complex baseband around 1500 Hz, Blackman windowed sinc low pass
+static void Downconvert(const std::vector<float> &audio, std::vector<cfloat> &base)
+{
+    const int taps = 8 * DECIMATION + 1;
+    const double cutoff = 170.0 / AUDIO_RATE;
+    std::vector<float> h(taps);
+
+    for (int i = 0; i < taps; i++)
+    {
+        double m = i - (taps - 1) / 2.0;
+        double sinc = (m == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * m) / (M_PI * m);
+        double win = 0.42 - 0.5 * cos(2.0 * M_PI * i / (taps - 1)) + 0.08 * cos(4.0 * M_PI * i / (taps - 1));
+        h[i] = sinc * win;
+    }
+
+    std::vector<cfloat> mixed(audio.size());
+    for (size_t n = 0; n < audio.size(); n++)
+    {
+        double w = -2.0 * M_PI * CENTER_FREQ * (n % 8) / AUDIO_RATE;   // 1500 Hz repeats every 8 samples
+        mixed[n] = audio[n] * cfloat(cos(w), sin(w));
+    }
+
+    base.assign(std::min((size_t) (PERIOD_S * BASE_RATE), audio.size() / DECIMATION), cfloat(0.0f, 0.0f));
+    for (size_t k = 0; k < base.size(); k++)
+    {
+        cfloat acc(0.0f, 0.0f);
+        long c = (long) k * DECIMATION - (taps - 1) / 2;
+        for (int i = 0; i < taps; i++)
+            if ((c + i >= 0) && (c + i < (long) mixed.size()))
+                acc += h[i] * mixed[c + i];
+        base[k] = acc;
+    }
+}
+
+// ---- Demodulation -----------------------------------------------------------------------
+
+// In place radix 2 FFT with a per thread twiddle table for the last used length
+static void Fft(cfloat *x, const int n)
+{
+    static thread_local std::vector<cfloat> twiddle;
+    if ((int) twiddle.size() != n / 2)
+    {
+        twiddle.resize(n / 2);
+        for (int i = 0; i < n / 2; i++)
+            twiddle[i] = cfloat(cos(-2.0 * M_PI * i / n), sin(-2.0 * M_PI * i / n));
+    }
+
+    for (int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(x[i], x[j]);
+    }
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        const int stride = n / len;
+        for (int i = 0; i < n; i += len)
+        {
+            for (int j = 0; j < len / 2; j++)
+            {
+                cfloat u = x[i + j], v = x[i + j + len / 2] * twiddle[j * stride];
+                x[i + j] = u + v;
+                x[i + j + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+// Analytic signal of real audio, the IQ of the same samples: negative frequencies removed
+// and positive ones doubled, so a real tone of amplitude 1 becomes a complex one
+static void Analytic(const std::vector<float> &audio, std::vector<cfloat> &iq)
+{
+    int n = 1;
+    while (n < (int) audio.size())
+        n <<= 1;
+
+    std::vector<cfloat> x(n, cfloat(0.0f, 0.0f));
+    for (size_t i = 0; i < audio.size(); i++)
+        x[i] = audio[i];
+    Fft(x.data(), n);
+    for (int k = 1; k < n / 2; k++)
+        x[k] *= 2.0f;
+    for (int k = n / 2 + 1; k < n; k++)
+        x[k] = 0.0f;
+
+    // Inverse as the conjugate of the forward transform of the conjugate
+    for (cfloat &v : x)
+        v = std::conj(v);
+    Fft(x.data(), n);
+    iq.resize(audio.size());
+    for (size_t i = 0; i < audio.size(); i++)
+        iq[i] = std::conj(x[i]) / (float) n;
+}
+
+// Tone amplitudes of every symbol for a frame starting at sample start, tone 0 at freq Hz.
+// Real and imaginary parts are kept apart so the inner loops vectorize
+static void ToneAmplitudes(const std::vector<cfloat> &base, const long start, const double freq, float amp[][4])
+{
+    static thread_local float twr[4][SYMBOL_SAMPLES], twi[4][SYMBOL_SAMPLES];
+    static thread_local bool init = false;
+    if (!init)
+    {
+        for (int t = 0; t < 4; t++)
+            for (int n = 0; n < SYMBOL_SAMPLES; n++)
+            {
+                twr[t][n] = cos(-2.0 * M_PI * t * n / SYMBOL_SAMPLES);
+                twi[t][n] = sin(-2.0 * M_PI * t * n / SYMBOL_SAMPLES);
+            }
+        init = true;
+    }
+
+    const double w = -2.0 * M_PI * freq / BASE_RATE;
+    float rotr[SYMBOL_SAMPLES], roti[SYMBOL_SAMPLES];
+    for (int n = 0; n < SYMBOL_SAMPLES; n++)
+    {
+        rotr[n] = cos(w * n);
+        roti[n] = sin(w * n);
+    }
+
+    for (int k = 0; k < WSPR_SYMBOL_COUNT; k++)
+    {
+        long n0 = start + (long) k * SYMBOL_SAMPLES;
+        float sr[SYMBOL_SAMPLES], si[SYMBOL_SAMPLES];
+        float zr = cos(w * n0), zi = sin(w * n0);
+
+        for (int n = 0; n < SYMBOL_SAMPLES; n++)
+        {
+            cfloat x = ((n0 + n >= 0) && (n0 + n < (long) base.size())) ? base[n0 + n] : cfloat(0.0f, 0.0f);
+            float mr = zr * rotr[n] - zi * roti[n], mi = zr * roti[n] + zi * rotr[n];
+            sr[n] = x.real() * mr - x.imag() * mi;
+            si[n] = x.real() * mi + x.imag() * mr;
+        }
+
+        for (int t = 0; t < 4; t++)
+        {
+            float accr = 0.0f, acci = 0.0f;
+            for (int n = 0; n < SYMBOL_SAMPLES; n++)
+            {
+                accr += sr[n] * twr[t][n] - si[n] * twi[t][n];
+                acci += sr[n] * twi[t][n] + si[n] * twr[t][n];
+            }
+            amp[k][t] = sqrtf(accr * accr + acci * acci);
+        }
+    }
+}
+
+static double SyncMetric(const float amp[][4], const uint8_t *sync)
+{
+    double m = 0.0;
+    for (int k = 0; k < WSPR_SYMBOL_COUNT; k++)
+    {
+        double odd = amp[k][1] + amp[k][3], even = amp[k][0] + amp[k][2];
+        m += sync[k] ? odd - even : even - odd;
+    }
+    return m;
+}
+
+// Karn's Fano sequential decoder for the K=32 r=1/2 code. soft[] holds 0..255 per coded bit,
+// 255 a certain one. Returns false if it does not converge within FANO_MAX_CYCLES per bit
+struct FanoNode
+{
+    uint32_t encstate;
+    int gamma;
+    int metrics[4];
+    int tm[2];
+    int i;
+};
+
+static bool Fano(const uint8_t *soft, const int nbits, const int mettab[2][256], uint8_t *bits, unsigned *cycles)
+{
+    std::vector<FanoNode> nodes(nbits + 1);
+    FanoNode *np, *lastnode = &nodes[nbits], *tail = &nodes[nbits - 31];
+    long i, maxcycles = (long) FANO_MAX_CYCLES * nbits;
+    int t, m0, m1, ngamma;
+    uint32_t lsym;
+
+    for (int n = 0; n < nbits; n++)
+    {
+        uint8_t s0 = soft[2 * n], s1 = soft[2 * n + 1];
+        nodes[n].metrics[0] = mettab[0][s0] + mettab[0][s1];
+        nodes[n].metrics[1] = mettab[0][s0] + mettab[1][s1];
+        nodes[n].metrics[2] = mettab[1][s0] + mettab[0][s1];
+        nodes[n].metrics[3] = mettab[1][s0] + mettab[1][s1];
+    }
+
+    np = &nodes[0];
+    np->encstate = 0;
+    lsym = (Parity(np->encstate & POLY1) << 1) | Parity(np->encstate & POLY2);
+    m0 = np->metrics[lsym];
+    m1 = np->metrics[3 ^ lsym];
+    if (m0 > m1)
+    {
+        np->tm[0] = m0;
+        np->tm[1] = m1;
+    }
+    else
+    {
+        np->tm[0] = m1;
+        np->tm[1] = m0;
+        np->encstate++;
+    }
+    np->i = 0;
+    np->gamma = t = 0;
+
+    for (i = 1; i <= maxcycles; i++)
+    {
+        ngamma = np->gamma + np->tm[np->i];
+        if (ngamma >= t)
+        {
+            if (np->gamma < t + FANO_DELTA)                    // First visit, tighten the threshold
+                while (ngamma >= t + FANO_DELTA)
+                    t += FANO_DELTA;
+
+            np[1].gamma = ngamma;
+            np[1].encstate = np->encstate << 1;
+            if (++np == lastnode)
+                break;
+
+            lsym = (Parity(np->encstate & POLY1) << 1) | Parity(np->encstate & POLY2);
+            if (np >= tail)
+            {                                                  // Tail bits are always zero
+                np->tm[0] = np->metrics[lsym];
+            }
+            else
+            {
+                m0 = np->metrics[lsym];
+                m1 = np->metrics[3 ^ lsym];
+                if (m0 > m1)
+                {
+                    np->tm[0] = m0;
+                    np->tm[1] = m1;
+                }
+                else
+                {
+                    np->tm[0] = m1;
+                    np->tm[1] = m0;
+                    np->encstate++;
+                }
+            }
+            np->i = 0;
+            continue;
+        }
+
+        // Threshold violated, look back
+        for (;;)
+        {
+            if ((np == &nodes[0]) || (np[-1].gamma < t))
+            {                                                  // Cannot back up, loosen the threshold
+                t -= FANO_DELTA;
+                if (np->i != 0)
+                {
+                    np->i = 0;
+                    np->encstate ^= 1;
+                }
+                break;
+            }
+            if ((--np < tail) && (np->i != 1))
+            {                                                  // Try the other branch
+                np->i++;
+                np->encstate ^= 1;
+                break;
+            }
+        }
+    }
+
+    *cycles = i / nbits;
+    if (i > maxcycles)
+        return false;
+    for (int n = 0; n < nbits; n++)
+        bits[n] = nodes[n].encstate & 1;
+    return true;
+}
+
+static void BuildMetricTable(int mettab[2][256])
+{
+    // Gaussian soft symbol model, mean +/-40 and sigma 40 around 128, in units of 0.1 bit
+    for (int s = 0; s < 256; s++)
+    {
+        double x = s - 128.0;
+        double p1 = exp(-(x - 40.0) * (x - 40.0) / (2.0 * 40.0 * 40.0));
+        double p0 = exp(-(x + 40.0) * (x + 40.0) / (2.0 * 40.0 * 40.0));
+        mettab[1][s] = lround(10.0 * (log2(2.0 * p1 / (p0 + p1) + 1.0e-12) - FANO_BIAS));
+        mettab[0][s] = lround(10.0 * (log2(2.0 * p0 / (p0 + p1) + 1.0e-12) - FANO_BIAS));
+    }
+}
+
+// Call sign known to the decoder, so type 3 hashes can be resolved like wsprd's hash table
+static char knownCall[16];
+
+static void UnpackCall(uint32_t n, char *call)
+{
+    static const char alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+    char c[7];
+
+    c[5] = alnum[n % 27 + 10]; n /= 27;
+    c[4] = alnum[n % 27 + 10]; n /= 27;
+    c[3] = alnum[n % 27 + 10]; n /= 27;
+    c[2] = alnum[n % 10]; n /= 10;
+    c[1] = alnum[n % 36]; n /= 36;
+    c[0] = alnum[std::min<uint32_t>(n, 36)];
+    c[6] = 0;
+
+    const char *p = c;
+    while (*p == ' ')
+        p++;
+    strcpy(call, p);
+    for (int i = strlen(call) - 1; (i >= 0) && (call[i] == ' '); i--)
+        call[i] = 0;
+}
+
+// Prefix (below 60000) or suffix of a type 2 compound call
+static void UnpackAffix(const uint32_t n3, const char *base, char *call)
+{
+    static const char alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+
+    if (n3 < 60000)
+    {
+        char pfx[4] = { alnum[n3 / 1369 % 37], alnum[n3 / 37 % 37], alnum[n3 % 37], 0 };
+        const char *p = pfx;
+        while (*p == ' ')
+            p++;
+        sprintf(call, "%s/%s", p, base);
+    }
+    else if (n3 - 60000 < 36)
+        sprintf(call, "%s/%c", base, alnum[n3 - 60000]);
+    else
+        sprintf(call, "%s/%02u", base, n3 - 60000 - 26);
+}
+
+// Message types as wsprd tells them apart, by the power field
+static bool Unpack(const uint8_t *bits, DecodeResult *r)
+{
+    uint32_t n = 0, m = 0;
+    char c[16];
+    for (int i = 0; i < 28; i++)
+        n = (n << 1) | bits[i];
+    for (int i = 28; i < 50; i++)
+        m = (m << 1) | bits[i];
+
+    int ntype = (int) (m & 0x7F) - 64;
+    uint32_t loc = m >> 7;
+    if (ntype > 62)
+        return false;
+
+    UnpackCall(n, c);
+    if (ntype < 0)
+    {   // Type 3: the call field holds the rotated 6 character locator
+        if ((strlen(c) != 6) || (c[3] > 'X') || (c[4] > 'X') || (c[5] > 'R'))
+            return false;
+        sprintf(r->locator, "%c%.5s", c[5], c);
+        if (*knownCall && (WsprCallHash(knownCall) == loc))
+            snprintf(r->call, sizeof(r->call), "<%s>", knownCall);
+        else
+            strcpy(r->call, "<...>");
+        r->power = -(ntype + 1);
+        return true;
+    }
+
+    int nu = ntype % 10;
+    if ((nu == 0) || (nu == 3) || (nu == 7))
+    {   // Type 1
+        if (loc >= 180 * 180)
+            return false;
+        strcpy(r->call, c);
+        int lon = loc / 180, lat = loc % 180;                  // lon = 179 - 10 * field - square
+        lon = 179 - lon;
+        r->locator[0] = 'A' + lon / 10;
+        r->locator[1] = 'A' + lat / 10;
+        r->locator[2] = '0' + lon % 10;
+        r->locator[3] = '0' + lat % 10;
+        r->locator[4] = 0;
+        r->power = ntype;
+        return true;
+    }
+
+    // Type 2: one or two added to the power level carry bit 15 of the prefix or suffix
+    int nadd = (nu > 7) ? nu - 7 : (nu > 3) ? nu - 3 : nu;
+    uint32_t n3 = loc + 32768 * (nadd - 1);
+    if ((nadd > 2) || (n3 > 60000 + 26 + 99))
+        return false;
+    UnpackAffix(n3, c, r->call);
+    r->locator[0] = 0;
+    r->power = ntype - nadd;
+    return true;
+}
+
+// Find the frame, make soft decisions and decode
+static DecodeResult Decode(const std::vector<cfloat> &base)
+{
+    static uint8_t sync[WSPR_SYMBOL_COUNT];
+    static int mettab[2][256];
+    static bool init = false;
+    DecodeResult r;
+    memset(&r, 0, sizeof(r));
+
+    if (!init)
+    {   // The sync vector is bit 0 of any encoded frame
+        uint8_t symbols[WSPR_SYMBOL_COUNT];
+        WsprEncodeType1("K1ABC", "FN42", 37, symbols);
+        for (int k = 0; k < WSPR_SYMBOL_COUNT; k++)
+            sync[k] = symbols[k] & 1;
+        BuildMetricTable(mettab);
+        init = true;
+    }
+
+    // Coarse search on half symbol step, half bin spectra: start in 0 .. 2.5 s, tone 0 within +/- 150 Hz
+    const int fftLen = 2 * SYMBOL_SAMPLES, step = SYMBOL_SAMPLES / 2;
+    const double binHz = BASE_RATE / fftLen;
+    const int windows = base.size() >= SYMBOL_SAMPLES ? (base.size() - SYMBOL_SAMPLES) / step + 1 : 0;
+    static thread_local std::vector<float> spectra;
+    spectra.resize((size_t) windows * fftLen);
+    for (int w = 0; w < windows; w++)
+    {
+        cfloat x[fftLen];
+        for (int n = 0; n < fftLen; n++)
+            x[n] = (n < SYMBOL_SAMPLES) ? base[w * step + n] : cfloat(0.0f, 0.0f);
+        Fft(x, fftLen);
+        for (int b = 0; b < fftLen; b++)                      // Stored with 0 Hz in the middle
+            spectra[(size_t) w * fftLen + (b + fftLen / 2) % fftLen] = sqrtf(std::norm(x[b]));
+    }
+
+    const int maxBin = (int) (150.0 / binHz);
+    double best = -1.0e30, freq = 0.0;
+    long start = 0;
+    for (int w0 = 0; (w0 * step <= 2.5 * BASE_RATE) && (w0 + 2 * (WSPR_SYMBOL_COUNT - 1) < windows); w0++)
+    {
+        for (int b = -maxBin; b <= maxBin; b++)
+        {
+            double m = 0.0;
+            for (int k = 0; k < WSPR_SYMBOL_COUNT; k++)
+            {
+                const float *bins = &spectra[(size_t) (w0 + 2 * k) * fftLen + fftLen / 2 + b];
+                double even = bins[0] + bins[4];
+                double odd = bins[2] + bins[6];
+                m += sync[k] ? odd - even : even - odd;
+            }
+            if (m > best)
+            {
+                best = m;
+                start = (long) w0 * step;
+                freq = b * binHz;
+            }
+        }
+    }
+
+    // Refine time then frequency with direct tone DFTs, the sync peak is separable enough
+    static thread_local float amp[WSPR_SYMBOL_COUNT][4];
+    best = -1.0e30;
+    long coarse = start;
+    for (long s = coarse - step / 2; s <= coarse + step / 2; s += 16)
+    {
+        ToneAmplitudes(base, s, freq, amp);
+        double m = SyncMetric(amp, sync);
+        if (m > best)
+        {
+            best = m;
+            start = s;
+        }
+    }
+    double coarseFreq = freq;
+    for (double f = coarseFreq - 0.45; f <= coarseFreq + 0.46; f += 0.15)
+    {
+        ToneAmplitudes(base, start, f, amp);
+        double m = SyncMetric(amp, sync);
+        if (m > best)
+        {
+            best = m;
+            freq = f;
+        }
+    }
+
+    // Soft decisions: data bit is tone 2/3 versus 0/1 of the sync selected pair
+    ToneAmplitudes(base, start, freq, amp);
+    double soft[WSPR_SYMBOL_COUNT], sq = 0.0;
+    for (int k = 0; k < WSPR_SYMBOL_COUNT; k++)
+    {
+        soft[k] = sync[k] ? amp[k][3] - amp[k][1] : amp[k][2] - amp[k][0];
+        sq += soft[k] * soft[k];
+    }
+    double norm = 50.0 / sqrt(sq / WSPR_SYMBOL_COUNT + 1.0e-30);
+
+    // Undo the interleaving
+    uint8_t coded[WSPR_SYMBOL_COUNT];
+    for (int i = 0, p = 0; i < 256; i++)
+    {
+        uint8_t j = BitReverse8(i);
+        if (j < WSPR_SYMBOL_COUNT)
+            coded[p++] = (uint8_t) std::max(0.0, std::min(255.0, 128.0 + soft[j] * norm));
+    }
+
+    uint8_t bits[WSPR_SYMBOL_COUNT / 2];
+    r.freq = freq;
+    r.start = start / BASE_RATE;
+    r.ok = Fano(coded, WSPR_SYMBOL_COUNT / 2, mettab, bits, &r.cycles) && Unpack(bits, &r);
+    return r;
+}
+
+// ---- Driver -----------------------------------------------------------------------------
+
+static bool ParseRange(const char *s, double *from, double *to, double *step)
+{
+    return (3 == sscanf(s, "%lf:%lf:%lf", from, to, step)) && (*step > 0.0) && (*to >= *from);
+}
+
+// What a decoder should print for a frame of the given type
+static DecodeResult Expected(const uint8_t type, const char *call, const char *locator, const int power)
+{
+    DecodeResult e = DecodeResult();
+
+    e.ok = true;
+    snprintf(e.call, sizeof(e.call), (type == WSPR_TYPE3) ? "<%s>" : "%s", call);
+    snprintf(e.locator, sizeof(e.locator), "%.*s", (type == WSPR_TYPE1) ? 4 : (type == WSPR_TYPE3) ? 6 : 0, locator);
+    e.power = power;
+    return e;
+}
+
+static bool Matches(const DecodeResult &r, const DecodeResult &e)
+{
+    return r.ok && !strcasecmp(r.call, e.call) && !strcasecmp(r.locator, e.locator) && (r.power == e.power);
+}
+
+static int Sweep(const uint8_t *symbols, const DecodeResult &expected, SimParams p,
+                 const char *snrRange, const char *driftRange, const int trials, const uint64_t seed)
+{
+    double s0, s1, ss, d0 = p.drift, d1 = p.drift, ds = 1.0;
+    if (!ParseRange(snrRange, &s0, &s1, &ss) || (driftRange && !ParseRange(driftRange, &d0, &d1, &ds)))
+    {
+        fprintf(stderr, "ranges are FROM:TO:STEP\n");
+        return 1;
+    }
+
+    std::vector<SimParams> points;
+    for (double d = d0; d <= d1 + 1.0e-9; d += ds)
+        for (double s = s0; s <= s1 + 1.0e-9; s += ss)
+        {
+            p.drift = d;
+            p.snr = s;
+            points.push_back(p);
+        }
+
+    std::vector<int> decoded(points.size(), 0);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < threads; t++)
+    {
+        pool.emplace_back([&]()
+        {
+            size_t job;
+            std::vector<cfloat> base;
+            while ((job = next.fetch_add(1)) < points.size() * trials)
+            {
+                size_t pt = job / trials;
+                Random rng(seed + job * 7919);
+                Channel(symbols, points[pt], BASE_RATE, points[pt].offset, false, rng, base);
+                if (Matches(Decode(base), expected))
+                    __atomic_fetch_add(&decoded[pt], 1, __ATOMIC_RELAXED);
+            }
+        });
+    }
+    for (std::thread &worker : pool)
+        worker.join();
+
+    printf("snr_db,drift_hz,trials,decoded,rate\n");
+    for (size_t i = 0; i < points.size(); i++)
+        printf("%.1f,%.2f,%d,%d,%.3f\n", points[i].snr, points[i].drift, trials, decoded[i], (double) decoded[i] / trials);
+    return 0;
+}
+
+static void Print(const DecodeResult &r)
+{
+    if (r.ok)
+        printf("Decoded %s %s %d at %+.2f Hz, start %.2f s, %u Fano cycles per bit\n", r.call, r.locator, r.power, r.freq, r.start, r.cycles);
+    else
+        printf("No decode (best sync at %+.2f Hz, start %.2f s)\n", r.freq, r.start);
+}
+
+int main(int argc, char *argv[])
+{
+    SimParams p;
+    const char *wav = NULL, *iq = NULL, *snrRange = NULL, *driftRange = NULL, *decodeFile = NULL;
+    int trials = 20, frame = 0, opt;
+    uint64_t seed = 1;
+
+    while ((opt = getopt(argc, argv, "s:f:d:e:j:t:m:w:q:S:R:n:x:D:")) != -1)
+    {
+        switch (opt)
+        {
+            case 's': p.snr = strtod(optarg, NULL); break;
+            case 'f': p.offset = strtod(optarg, NULL); break;
+            case 'd': p.drift = strtod(optarg, NULL); break;
+            case 'e': p.clockPpm = strtod(optarg, NULL); break;
+            case 'j': p.jitterUs = strtod(optarg, NULL); break;
+            case 't': p.start = strtod(optarg, NULL); break;
+            case 'm': frame = atoi(optarg); break;
+            case 'w': wav = optarg; break;
+            case 'q': iq = optarg; break;
+            case 'S': snrRange = optarg; break;
+            case 'R': driftRange = optarg; break;
+            case 'n': trials = std::max(1, atoi(optarg)); break;
+            case 'x': seed = strtoull(optarg, NULL, 10); break;
+            case 'D': decodeFile = optarg; break;
+            default: return 1;
+        }
+    }
+
+    if (decodeFile && (argc == optind))
+    {
+        std::vector<float> audio;
+        std::vector<cfloat> base;
+        if (!ReadWav(decodeFile, audio))
+            return 1;
+        Downconvert(audio, base);
+        DecodeResult r = Decode(base);
+        Print(r);
+        return r.ok ? 0 : 2;
+    }
+
+    if (argc - optind != 3)
+    {
+        fprintf(stderr, "usage: wsprsim [-s DB] [-f HZ] [-d HZ] [-e PPM] [-j US] [-t S] [-m N] [-w FILE.wav] [-q FILE.iq] CALL LOCATOR POWER\n"
+                        "       wsprsim -S FROM:TO:STEP [-R FROM:TO:STEP] [-n TRIALS] [options] CALL LOCATOR POWER\n"
+                        "       wsprsim -D FILE.wav\n");
+        return 1;
+    }
+
+    const char *call = argv[optind], *locator = argv[optind + 1];
+    int power = atoi(argv[optind + 2]);
+    uint8_t rotation[WSPR_ROTATION_MAX][WSPR_SYMBOL_COUNT], types[WSPR_ROTATION_MAX];
+    int frames = WsprEncodeRotation(call, locator, power, rotation, types);
+    if ((frame < 0) || (frame >= frames))
+    {
+        fprintf(stderr, "cannot encode frame %d of %s %s %d (%d frames)\n", frame, call, locator, power, frames);
+        return 1;
+    }
+    const uint8_t *symbols = rotation[frame];
+    DecodeResult expected = Expected(types[frame], call, locator, power);
+    snprintf(knownCall, sizeof(knownCall), "%s", call);
+    for (char *c = knownCall; *c; c++)
+        *c = toupper(*c);
+
+    if (snrRange)
+        return Sweep(symbols, expected, p, snrRange, driftRange, trials, seed);
+
+    // Full loopback: 12 kHz real audio, optional files, downconversion and decode
+    Random rng(seed);
+    std::vector<cfloat> audio;
+    Channel(symbols, p, AUDIO_RATE, CENTER_FREQ + p.offset, true, rng, audio);
+    if (wav && !WriteWav(wav, audio))
+        return 1;
+
+    std::vector<float> real(audio.size());
+    for (size_t n = 0; n < audio.size(); n++)
+        real[n] = audio[n].real();
+    if (iq)
+    {   // The same noisy samples as the WAV and the decoder
+        std::vector<cfloat> x;
+        Analytic(real, x);
+        FILE *f = fopen(iq, "wb");
+        if (!f || (fwrite(x.data(), sizeof(cfloat), x.size(), f) != x.size()))
+        {
+            perror(iq);
+            return 1;
+        }
+        fclose(f);
+    }
+
+    std::vector<cfloat> base;
+    Downconvert(real, base);
+    DecodeResult r = Decode(base);
+    Print(r);
+    return Matches(r, expected) ? 0 : 2;
+}
+
+// ----------------- EOF -------------------------------------------------------------------
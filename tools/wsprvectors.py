@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+"""
+    wsprvectors
+
+    Independent WSPR encoder for the host check corpus. Written from the WSPR protocol
+    description, not from the sketch's wspr.cpp, so "make check" compares two separate
+    implementations. Prints one vector per line:
+        TYPE CALL LOCATOR POWER SYMBOLS
+    with the locator "-" for type 2 and the 162 channel symbols as digits.
+
+    Usage
+        wsprvectors.py [-n COUNT] [-s SEED] > vectors.txt
+
+    The corpus is COUNT random type 1 messages over every call sign shape, locator and
+    power level, plus random type 2 and type 3 messages, always from the same seed so
+    the output is repeatable.
+"""
+
+import argparse
+import random
+import sys
+
+POWERS = [0, 3, 7, 10, 13, 17, 20, 23, 27, 30, 33, 37, 40, 43, 47, 50, 53, 57, 60]
+
+SYNC = [int(c) for c in
+        "11000000100011100010010111100000001001010000001011001101000110100001"
+        "10101010100100101100011010100010000010010011101100110100011100000101"
+        "00110000000110101100011000"]
+assert len(SYNC) == 162
+
+POLY = (0xF2D05351, 0xE4613C47)
+
+
+def char37(c):
+    """Call sign character: digits 0 - 9, letters 10 - 35, space 36"""
+    if c.isdigit():
+        return ord(c) - ord('0')
+    if 'A' <= c <= 'Z':
+        return ord(c) - ord('A') + 10
+    if c == ' ':
+        return 36
+    raise ValueError(c)
+
+
+def pack_call(call):
+    """28 bit value of a standard call of up to 6 characters, the digit third"""
+    call = call.upper()
+    if (len(call) < 3) or (len(call) > 6):
+        raise ValueError(call)
+    if not call[2].isdigit():
+        if (len(call) > 5) or not call[1].isdigit():
+            raise ValueError(call)
+        call = ' ' + call
+    call = call.ljust(6)
+    suffix = call[3:].rstrip(' ')
+    if not call[1].isalnum() or not call[2].isdigit() or (suffix and not suffix.isalpha()):
+        raise ValueError(call)
+    n = char37(call[0])
+    n = n * 36 + char37(call[1])
+    n = n * 10 + char37(call[2])
+    for c in call[3:]:
+        n = n * 27 + (26 if c == ' ' else char37(c) - 10)
+    return n
+
+
+def pack_grid(locator, power):
+    loc = locator.upper()
+    if len(loc) != 4 or not ('A' <= loc[0] <= 'R') or not ('A' <= loc[1] <= 'R') or not loc[2:].isdigit():
+        raise ValueError(locator)
+    m = (179 - 10 * (ord(loc[0]) - ord('A')) - int(loc[2])) * 180 + 10 * (ord(loc[1]) - ord('A')) + int(loc[3])
+    return m * 128 + power + 64
+
+
+def rot(x, k):
+    return ((x << k) | (x >> (32 - k))) & 0xFFFFFFFF
+
+
+def lookup3(data, initval):
+    """Bob Jenkins' hashlittle()"""
+    a = b = c = (0xDEADBEEF + len(data) + initval) & 0xFFFFFFFF
+    k = list(data)
+    n = len(k)
+    i = 0
+
+    def mix(a, b, c):
+        a = (a - c) & 0xFFFFFFFF; a ^= rot(c, 4); c = (c + b) & 0xFFFFFFFF
+        b = (b - a) & 0xFFFFFFFF; b ^= rot(a, 6); a = (a + c) & 0xFFFFFFFF
+        c = (c - b) & 0xFFFFFFFF; c ^= rot(b, 8); b = (b + a) & 0xFFFFFFFF
+        a = (a - c) & 0xFFFFFFFF; a ^= rot(c, 16); c = (c + b) & 0xFFFFFFFF
+        b = (b - a) & 0xFFFFFFFF; b ^= rot(a, 19); a = (a + c) & 0xFFFFFFFF
+        c = (c - b) & 0xFFFFFFFF; c ^= rot(b, 4); b = (b + a) & 0xFFFFFFFF
+        return a, b, c
+
+    def final(a, b, c):
+        c ^= b; c = (c - rot(b, 14)) & 0xFFFFFFFF
+        a ^= c; a = (a - rot(c, 11)) & 0xFFFFFFFF
+        b ^= a; b = (b - rot(a, 25)) & 0xFFFFFFFF
+        c ^= b; c = (c - rot(b, 16)) & 0xFFFFFFFF
+        a ^= c; a = (a - rot(c, 4)) & 0xFFFFFFFF
+        b ^= a; b = (b - rot(a, 14)) & 0xFFFFFFFF
+        c ^= b; c = (c - rot(b, 24)) & 0xFFFFFFFF
+        return a, b, c
+
+    def word(j, count):
+        return sum(k[j + x] << (8 * x) for x in range(count))
+
+    while n > 12:
+        a = (a + word(i, 4)) & 0xFFFFFFFF
+        b = (b + word(i + 4, 4)) & 0xFFFFFFFF
+        c = (c + word(i + 8, 4)) & 0xFFFFFFFF
+        a, b, c = mix(a, b, c)
+        i += 12
+        n -= 12
+    if n == 0:
+        return c
+    a = (a + word(i, min(n, 4))) & 0xFFFFFFFF
+    if n > 4:
+        b = (b + word(i + 4, min(n - 4, 4))) & 0xFFFFFFFF
+    if n > 8:
+        c = (c + word(i + 8, n - 8)) & 0xFFFFFFFF
+    a, b, c = final(a, b, c)
+    return c
+
+
+def call_hash(call):
+    return lookup3(call.upper().encode(), 146) & 0x7FFF
+
+
+def pack_compound(call, power):
+    """Type 2: base call and the 16 bit prefix or suffix value"""
+    call = call.upper()
+    if call.count('/') != 1:
+        raise ValueError(call)
+    left, right = call.split('/')
+    if len(right) == 1 and right.isalnum():
+        n1 = pack_call(left)
+        ng = 60000 - 32768 + char37(right)
+        nadd = 1
+    elif len(right) == 2 and right.isdigit() and right[0] != '0':   # /00 - /09 would alias /Q - /Z
+        n1 = pack_call(left)
+        ng = 60000 + 26 + int(right)
+        nadd = 1
+    elif 1 <= len(left) <= 3 and left.isalnum():
+        n1 = pack_call(right)
+        ng = 0
+        for c in left.rjust(3):
+            ng = 37 * ng + char37(c)
+        nadd = 0
+        if ng >= 32768:
+            ng -= 32768
+            nadd = 1
+    else:
+        raise ValueError(call)
+    return n1, 128 * ng + power + 1 + nadd + 64
+
+
+def encode_bits(n1, n2):
+    """The 50 bit message, 28 bits of n1 and the low 22 bits of n2, two digit suffixes overflow"""
+    value = (n1 << 22) | (n2 & 0x3FFFFF)
+    bits = [(value >> (49 - i)) & 1 for i in range(50)] + [0] * 31
+    reg = 0
+    out = []
+    for bit in bits:
+        reg = ((reg << 1) | bit) & 0xFFFFFFFF
+        for poly in POLY:
+            out.append(bin(reg & poly).count('1') & 1)
+    data = [0] * 162
+    p = 0
+    for i in range(256):
+        j = int('{:08b}'.format(i)[::-1], 2)
+        if j < 162:
+            data[j] = out[p]
+            p += 1
+    return [SYNC[i] + 2 * data[i] for i in range(162)]
+
+
+def encode(kind, call, locator, power):
+    if power not in POWERS:
+        raise ValueError(power)
+    if kind == 1:
+        return encode_bits(pack_call(call), pack_grid(locator, power))
+    if kind == 2:
+        n1, n2 = pack_compound(call, power)
+        return encode_bits(n1, n2)
+    if kind == 3:
+        loc = locator.upper()
+        if len(loc) != 6:
+            raise ValueError(locator)
+        n1 = pack_call(loc[1:] + loc[0])
+        return encode_bits(n1, 128 * call_hash(call) - (power + 1) + 64)
+    raise ValueError(kind)
+
+
+LETTERS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+ALNUM = LETTERS + "0123456789"
+
+
+def random_call(rng):
+    """A type 1 call: 1 or 2 character prefix, one digit, 1 to 3 letter suffix"""
+    while True:
+        prefix = rng.choice([rng.choice(LETTERS), rng.choice(LETTERS) + rng.choice(ALNUM), rng.choice("0123456789") + rng.choice(LETTERS)])
+        call = prefix + rng.choice("0123456789") + "".join(rng.choice(LETTERS) for _ in range(rng.randint(1, 3)))
+        try:
+            pack_call(call)
+            return call
+        except ValueError:
+            pass
+
+
+def random_locator(rng, chars):
+    loc = rng.choice(LETTERS[:18]) + rng.choice(LETTERS[:18]) + rng.choice("0123456789") + rng.choice("0123456789")
+    if chars == 6:
+        loc += rng.choice(LETTERS[:24]) + rng.choice(LETTERS[:24])
+    return loc
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Independent WSPR vectors for the host check")
+    parser.add_argument("-n", type=int, default=500, help="type 1 vectors")
+    parser.add_argument("-s", type=int, default=1, help="random seed")
+    args = parser.parse_args()
+    rng = random.Random(args.s)
+
+    out = sys.stdout
+    out.write("# wsprvectors.py -n %d -s %d\n" % (args.n, args.s))
+    for i in range(args.n):
+        call, loc, power = random_call(rng), random_locator(rng, 4), POWERS[i % len(POWERS)]
+        out.write("1 %s %s %d %s\n" % (call, loc, power, "".join(map(str, encode(1, call, loc, power)))))
+    for i in range(args.n // 10):
+        base = random_call(rng)
+        call = rng.choice([rng.choice(ALNUM) + "/" + base,
+                           "".join(rng.choice(ALNUM) for _ in range(rng.randint(2, 3))) + "/" + base,
+                           base + "/" + rng.choice(ALNUM),
+                           base + "/%02d" % rng.randint(10, 99)])
+        power = rng.choice(POWERS)
+        out.write("2 %s - %d %s\n" % (call, power, "".join(map(str, encode(2, call, None, power)))))
+    for i in range(args.n // 10):
+        call, loc, power = random_call(rng), random_locator(rng, 6), rng.choice(POWERS)
+        out.write("3 %s %s %d %s\n" % (call, loc, power, "".join(map(str, encode(3, call, loc, power)))))
+
+
+if __name__ == "__main__":
+    main()